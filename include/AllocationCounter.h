@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Allocation Counter
+//
+//  The global operator new is replaced (AllocationCounter.cpp) to count
+//  the heap allocations of each thread, so a piece of code can check it
+//  didn't allocate:
+//
+//      const uint64_t allocations = AllocationCounter::getThreadAllocationCount();
+//      m_VulkanManager->drawFrame();
+//      if (AllocationCounter::getThreadAllocationCount() != allocations) ...
+//
+//  All the C++ allocations go through it (containers, strings, the
+//  std::function captures...), those of the libraries included when they
+//  are written in C++ (i.e. the validation layers). On glibc, malloc,
+//  calloc and realloc are replaced as well, so the C libraries' (GLFW,
+//  the Vulkan loader, stb) are counted too; elsewhere, and under the
+//  sanitizers, only operator new is. The drivers' go through HostAllocator.
+//
+//  The count is per thread: counting costs a thread local increment, and
+//  the allocations of the workers don't show up in the main thread's.
+// ---------------------------------------------------------------------
+
+class AllocationCounter
+{
+public:
+    // operator new calls made by the calling thread so far
+    static uint64_t getThreadAllocationCount();
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Benchmark
+//
+//  A small harness for the CPU hot paths (see BenchmarkMain.cpp, built
+//  as Hello_Vulkan_bench). A case runs the code it measures for the given
+//  number of iterations, its setup stays out of it:
+//
+//      std::vector<SortedDraw> draws = ...;
+//      runner.add("drawSort/radix/4096", [&](uint64_t iterations) {
+//          for (uint64_t i = 0; i < iterations; ++i)
+//          {
+//              radixSortDraws(draws, scratch);
+//              doNotOptimize(draws.data());
+//          }
+//      });
+//
+//  The iteration count is doubled until a sample takes at least
+//  BENCHMARK_MIN_SAMPLE_NS (which also warms up the caches), then
+//  BENCHMARK_SAMPLES samples are timed. The median time per iteration is
+//  reported along with the fastest sample and the median absolute
+//  deviation: the median and the deviation are not thrown off by the odd
+//  interrupted sample, so runs on the same machine are comparable.
+// ---------------------------------------------------------------------
+
+#define BENCHMARK_MIN_SAMPLE_NS     10000000ull     // 10 ms
+#define BENCHMARK_SAMPLES           15
+
+// keeps the compiler from optimizing the computation of value away
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+#endif
+}
+
+// same, and the compiler has to assume value was changed: an input passed
+// through it every iteration is not hoisted out of the loop
+template<typename T>
+inline void doNotOptimize(T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+m"(value) : : "memory");
+#else
+    volatile char* sink = reinterpret_cast<volatile char*>(&value);
+    *sink = *sink;
+#endif
+}
+
+struct BenchmarkResult
+{
+    std::string name;
+    uint64_t    iterations;     // per sample
+    double      medianNs;       // per iteration
+    double      minNs;
+    double      deviationNs;    // median absolute deviation
+};
+
+class BenchmarkRunner
+{
+public:
+    using Function = std::function<void(uint64_t iterations)>;
+
+    void    add(const std::string& name, Function function);
+
+    // runs the cases whose name contains filter (all if empty), in the
+    // order they were added, printing each result as it is done
+    std::vector<BenchmarkResult>    run(const std::string& filter) const;
+
+    static bool     writeCsv(const std::string& path, const std::vector<BenchmarkResult>& results);
+
+private:
+    struct Case
+    {
+        std::string name;
+        Function    function;
+    };
+
+    static BenchmarkResult  measure(const Case& benchmark);
+
+    std::vector<Case>   m_cases;
+};
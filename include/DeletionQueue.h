@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <mutex>
+
+class MemoryTracker;
+
+// ---------------------------------------------------------------------
+//  Deletion Queue
+//
+//  Defers the destruction of the resources that may still be in use by
+//  the GPU. A resource is released with the number of the last frame that
+//  may use it (see the frame timeline in VulkanManager), and destroyed by
+//  flush() once that frame is complete. Resources can then be replaced
+//  at runtime without waiting for the device to be idle.
+//
+//  Frames complete in order, so the entries are kept in release order
+//  and flushed from the front.
+// ---------------------------------------------------------------------
+
+class DeletionQueue
+{
+public:
+    DeletionQueue();
+
+    void    init(VkDevice device, MemoryTracker* memoryTracker);
+
+    void    releaseBuffer(uint64_t frameNumber, VkBuffer buffer, VkDeviceMemory memory);
+    void    releaseImage(uint64_t frameNumber, VkImage image, VkDeviceMemory memory);
+    void    releaseImageView(uint64_t frameNumber, VkImageView imageView);
+    void    releaseFramebuffer(uint64_t frameNumber, VkFramebuffer framebuffer);
+    void    releasePipeline(uint64_t frameNumber, VkPipeline pipeline);
+    void    releaseCommandBuffer(uint64_t frameNumber, VkCommandPool commandPool, VkCommandBuffer commandBuffer);
+    void    releaseDescriptorPool(uint64_t frameNumber, VkDescriptorPool descriptorPool);
+    void    releaseRenderPass(uint64_t frameNumber, VkRenderPass renderPass);
+    void    releaseSwapchain(uint64_t frameNumber, VkSwapchainKHR swapchain);
+
+    // destroys the resources released up to completedFrame (included)
+    void    flush(uint64_t completedFrame);
+    // destroys everything, the device must be idle
+    void    flushAll();
+
+private:
+    enum class ResourceType
+    {
+        Buffer,
+        Image,
+        ImageView,
+        Framebuffer,
+        Pipeline,
+        CommandBuffer,
+        DescriptorPool,
+        RenderPass,
+        Swapchain,
+    };
+
+    struct Entry
+    {
+        uint64_t        frameNumber;
+        ResourceType    type;
+        union
+        {
+            struct { VkBuffer buffer; VkDeviceMemory memory; }                  buffer;
+            struct { VkImage image; VkDeviceMemory memory; }                    image;
+            VkImageView                                                         imageView;
+            VkFramebuffer                                                       framebuffer;
+            VkPipeline                                                          pipeline;
+            struct { VkCommandPool pool; VkCommandBuffer commandBuffer; }       commandBuffer;
+            VkDescriptorPool                                                    descriptorPool;
+            VkRenderPass                                                        renderPass;
+            VkSwapchainKHR                                                      swapchain;
+        };
+    };
+
+    void    push(const Entry& entry);
+    void    destroy(const Entry& entry);
+
+    VkDevice            m_device;
+    MemoryTracker*      m_memoryTracker;
+
+    std::vector<Entry>  m_entries;  // in release order
+    std::mutex          m_mutex;    // resources may be released by jobs (i.e. init uploads)
+};
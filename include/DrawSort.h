@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Draw Sort
+//
+//  Every draw carries a 64-bit key packing the state it needs, most
+//  expensive to change first:
+//
+//      63      60      48              32      20                 0
+//      | pass  | pipeline | material   | mesh  |       depth       |
+//      |  4    |    12    |    16      |  12   |        20         |
+//
+//  Sorting the keys groups the draws by pass, then pipeline, material
+//  (descriptor set) and mesh (vertex/index buffers), so consecutive draws
+//  share as much state as possible and the redundant binds can be skipped
+//  when recording. Within the same state, draws are front-to-back.
+//
+//  The keys are sorted with an LSD radix sort over a flat array: linear
+//  in the number of draws, no comparisons, and the byte passes shared by
+//  all the keys (i.e. a single pass or pipeline) are skipped.
+// ---------------------------------------------------------------------
+
+#define DRAW_KEY_PASS_BITS          4
+#define DRAW_KEY_PIPELINE_BITS      12
+#define DRAW_KEY_MATERIAL_BITS      16
+#define DRAW_KEY_MESH_BITS          12
+#define DRAW_KEY_DEPTH_BITS         20
+
+struct DrawKeyFields
+{
+    uint32_t    pass;
+    uint32_t    pipeline;
+    uint32_t    material;
+    uint32_t    mesh;
+};
+
+// the key of a draw, sorted by the view depth last (closest first).
+// Fields wider than their bits are truncated.
+uint64_t        makeDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDepth);
+DrawKeyFields   getDrawKeyFields(uint64_t key);
+
+struct SortedDraw
+{
+    uint64_t    key;
+    uint32_t    drawIndex;  // in the draw list the keys were made from
+};
+
+// sorts count draws by key, stable. 'scratch' holds count draws too.
+// Returns where the sorted draws are, draws or scratch.
+SortedDraw* radixSortDraws(SortedDraw* draws, SortedDraw* scratch, size_t count);
+
+// same, the sorted draws end up in 'draws'. 'scratch' is resized to the size
+// of 'draws', keep it around between frames (or in the frame's arena, see
+// LinearArena.h) so sorting doesn't allocate.
+template<typename Allocator>
+void    radixSortDraws(std::vector<SortedDraw, Allocator>& draws, std::vector<SortedDraw, Allocator>& scratch)
+{
+    scratch.resize(draws.size());
+    if (radixSortDraws(draws.data(), scratch.data(), draws.size()) != draws.data())
+        draws.swap(scratch);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  GPU Stats
+//
+//  GPU counters of the frames, gathered with query pools:
+//
+//   - pipeline statistics per pass (vertices, vertex shader invocations,
+//     primitives in/out of the clipper, fragment shader invocations), to
+//     tell whether a frame is vertex bound or overdraw bound
+//   - samples passed per draw group (occlusion queries), optional
+//
+//  Each frame in flight has its own range of queries, reset at the start
+//  of its command buffer. The results are read once the frame is complete,
+//  when its slot is reused (see collect), so reading never waits on the GPU.
+//
+//      gpuStats.beginFrame(cmd, frameIndex, frameNumber);
+//      gpuStats.beginPass(cmd, "main");
+//      ...     gpuStats.beginOcclusion(cmd, "opaque"); draws; gpuStats.endOcclusion(cmd);
+//      gpuStats.endPass(cmd);
+//
+//  Names must be string literals (only the pointer is stored).
+// ---------------------------------------------------------------------
+
+#define GPU_STATS_MAX_PASSES            8   // per frame
+#define GPU_STATS_MAX_OCCLUSION_GROUPS  16
+
+struct PipelineStatistics
+{
+    uint64_t    inputAssemblyVertices;
+    uint64_t    inputAssemblyPrimitives;
+    uint64_t    vertexShaderInvocations;
+    uint64_t    clippingInvocations;        // primitives into the clipper
+    uint64_t    clippingPrimitives;         // out of it, to the rasterizer
+    uint64_t    fragmentShaderInvocations;
+};
+
+struct GpuPassStats
+{
+    const char*         name;
+    PipelineStatistics  statistics;
+};
+
+struct GpuOcclusionStats
+{
+    const char*         name;
+    uint64_t            samplesPassed;      // exact if occlusionQueryPrecise is supported, non-zero otherwise
+};
+
+struct GpuFrameStats
+{
+    uint64_t                        frameNumber;    // 0 until a frame has been collected
+    std::vector<GpuPassStats>       passes;
+    std::vector<GpuOcclusionStats>  occlusionGroups;
+};
+
+class GpuStats
+{
+public:
+    GpuStats();
+
+    // isPipelineStatisticsEnabled: the pipelineStatisticsQuery feature is enabled
+    // isOcclusionEnabled: occlusion queries are recorded (isOcclusionPrecise: occlusionQueryPrecise is enabled)
+    void    init(VkDevice device, uint32_t framesInFlight, bool isPipelineStatisticsEnabled,
+                 bool isOcclusionEnabled, bool isOcclusionPrecise);
+    void    clean();
+
+    // << Recording >> outside of a render pass, except the occlusion queries.
+    // A pass can't be nested in another one, nor an occlusion group.
+    void    beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+    void    beginPass(VkCommandBuffer commandBuffer, const char* name);
+    void    endPass(VkCommandBuffer commandBuffer);
+    void    beginOcclusion(VkCommandBuffer commandBuffer, const char* name);
+    void    endOcclusion(VkCommandBuffer commandBuffer);
+
+    // << Results >> the frame that last used the slot must be complete
+    void                    collect(uint32_t frameIndex);
+    const GpuFrameStats&    getLatestStats() const { return m_latestStats; }
+    // pixelCount: of the frame, for the overdraw (fragment shader invocations per pixel)
+    void                    printReport(uint64_t pixelCount) const;
+
+private:
+    // the queries recorded in the slot of a frame in flight
+    struct FrameQueries
+    {
+        uint64_t                    frameNumber;        // 0 if none recorded
+        std::vector<const char*>    passNames;
+        std::vector<const char*>    occlusionNames;
+    };
+
+    VkDevice                    m_device;
+    VkQueryPool                 m_statisticsPool;       // GPU_STATS_MAX_PASSES per slot
+    VkQueryPool                 m_occlusionPool;        // GPU_STATS_MAX_OCCLUSION_GROUPS per slot
+    VkQueryControlFlags         m_occlusionFlags;
+    std::vector<FrameQueries>   m_frames;
+    uint32_t                    m_recordingFrame;       // slot being recorded
+    bool                        m_isPassActive;
+    bool                        m_isOcclusionActive;
+
+    GpuFrameStats               m_latestStats;
+    GpuFrameStats               m_collectedStats;       // filled by collect(), swapped with m_latestStats
+    std::vector<uint64_t>       m_results;              // reused by collect()
+};
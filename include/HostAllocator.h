@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Host Allocator
+//
+//  The VkAllocationCallbacks passed to every vkCreate* / vkDestroy* /
+//  vkAllocateMemory / vkFreeMemory, so the host memory the driver
+//  allocates for us is no longer invisible:
+//
+//      vkCreateSampler(m_device, &samplerCreateInfo, HostAllocator::getCallbacks(), &m_textureSampler);
+//
+//  Allocations are counted per VkSystemAllocationScope (count, bytes
+//  alive, peak), along with the memory the driver only reports to us
+//  (pfnInternalAllocation, e.g. executable code).
+//
+//  Command scope allocations only live for the duration of the Vulkan
+//  command that made them (command recording, pipeline creation...), so
+//  they come from a bump allocator owned by the calling thread: no heap
+//  allocation, and the arena is rewound once all of them are freed. The
+//  rest goes to the heap. The same callbacks must be used to create and
+//  to destroy an object, so there is a single, process wide, instance.
+//
+//  Define DISABLE_HOST_ALLOCATOR to give the drivers their own allocator
+//  back (getCallbacks() returns nullptr, nothing is counted).
+// ---------------------------------------------------------------------
+
+#define HOST_COMMAND_ARENA_SIZE     (256 * 1024)    // per thread, bigger allocations go to the heap
+
+struct HostAllocationStats
+{
+    uint64_t    allocationCount;    // pfnAllocation, and pfnReallocation to a non zero size
+    uint64_t    arenaCount;         // of allocationCount, served by the command arena (no heap allocation)
+    uint64_t    freeCount;
+    uint64_t    liveBytes;
+    uint64_t    peakBytes;
+    uint64_t    totalBytes;         // allocated so far
+    uint64_t    internalBytes;      // alive, allocated by the driver itself
+};
+
+class HostAllocator
+{
+public:
+    static const VkAllocationCallbacks* getCallbacks();
+
+    // << Stats >>
+    static HostAllocationStats  getStats(VkSystemAllocationScope scope);
+    static uint64_t             getHeapAllocationCount();   // all scopes, to diff e.g. around a frame
+
+    static void     printReport();
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// ---------------------------------------------------------------------
+//  Image Compare
+//
+//  Compares a rendered image against a reference (golden) image, for the
+//  rendering regression runs (see MyApp, --golden).
+//
+//  The difference is perceptual rather than exact: the pixels are
+//  compared in CIELAB, where a distance (delta E) of about 2.3 is the
+//  smallest difference an observer notices. Pixels above the threshold
+//  are counted as different, and the images match when the fraction of
+//  such pixels stays within the tolerance. Rasterization or filtering
+//  differences between drivers (i.e. a software driver in CI) then pass,
+//  while actual regressions don't.
+// ---------------------------------------------------------------------
+
+struct ImageCompareSettings
+{
+    float   deltaEThreshold     = 2.3f;     // per pixel, just noticeable difference
+    float   maxDifferentRatio   = 0.001f;   // of the pixels above the threshold
+};
+
+struct ImageCompareResult
+{
+    bool        isMatching;
+    uint32_t    width;
+    uint32_t    height;
+    uint64_t    differentPixelCount;
+    float       differentRatio;
+    float       meanDeltaE;
+    float       maxDeltaE;
+    std::string error;          // images could not be compared (missing, size mismatch)
+};
+
+// both images are loaded from files (PNG, JPG, ... see stb_image)
+ImageCompareResult  compareImages(const char* imagePath, const char* referencePath,
+                                  const ImageCompareSettings& settings = ImageCompareSettings());
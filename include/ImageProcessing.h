@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Image Processing
+//
+//  Chains of image operations run on the GPU (see VulkanManager::
+//  processImage and shaders/image_ops.comp), i.e. to preprocess the
+//  textures once they are uploaded:
+//
+//      ImageOperationChain chain = {
+//          ImageOperation::resize(512, 512),
+//          ImageOperation::blur(2.0f),
+//          ImageOperation::saturation(1.2f),
+//          ImageOperation::gamma(1.1f),
+//      };
+//
+//  Each dispatch of the compute shader does one spatial operation (that
+//  reads neighboring pixels: resize, blur, sharpen), followed by up to
+//  IMAGE_MAX_FUSED_OPS per-pixel operations (color conversions) applied to
+//  its result in registers. planImageDispatches() fuses the per-pixel
+//  operations into the previous dispatch, so a chain costs one dispatch
+//  per spatial operation (two for a blur, which is separable), and the
+//  intermediate results ping-pong between two storage images.
+// ---------------------------------------------------------------------
+
+#define IMAGE_MAX_FUSED_OPS     4
+#define IMAGE_DISPATCH_GROUP    8   // local size (x and y) of image_ops.comp
+
+enum class ImageOperationType : uint32_t
+{
+    // << Spatial >>
+    Resize,         // bilinear, to width x height
+    Blur,           // gaussian, amount: standard deviation in pixels
+    Sharpen,        // unsharp mask, amount: strength
+    // << Per Pixel >>
+    Grayscale,      // amount: 0 (color) to 1 (gray)
+    Brightness,     // amount: added
+    Contrast,       // amount: scale around mid-gray
+    Saturation,     // amount: 0 (gray), 1 (unchanged)
+    Gamma,          // amount: gamma, applied as pow(color, 1 / gamma)
+};
+
+struct ImageOperation
+{
+    ImageOperationType  type;
+    float               amount;
+    uint32_t            width;      // Resize only
+    uint32_t            height;
+
+    static ImageOperation resize(uint32_t width, uint32_t height) { return {ImageOperationType::Resize, 0.0f, width, height}; }
+    static ImageOperation blur(float sigma)             { return {ImageOperationType::Blur, sigma, 0, 0}; }
+    static ImageOperation sharpen(float strength)       { return {ImageOperationType::Sharpen, strength, 0, 0}; }
+    static ImageOperation grayscale(float amount = 1.0f){ return {ImageOperationType::Grayscale, amount, 0, 0}; }
+    static ImageOperation brightness(float offset)      { return {ImageOperationType::Brightness, offset, 0, 0}; }
+    static ImageOperation contrast(float scale)         { return {ImageOperationType::Contrast, scale, 0, 0}; }
+    static ImageOperation saturation(float scale)       { return {ImageOperationType::Saturation, scale, 0, 0}; }
+    static ImageOperation gamma(float gamma)            { return {ImageOperationType::Gamma, gamma, 0, 0}; }
+
+    bool    isPerPixel() const { return type >= ImageOperationType::Grayscale; }
+};
+
+using ImageOperationChain = std::vector<ImageOperation>;
+
+// the push constants of image_ops.comp, std430 layout
+enum class ImageSpatialOp : uint32_t
+{
+    Copy,           // bilinear resample, to the output size
+    BlurHorizontal,
+    BlurVertical,
+    Sharpen,
+};
+
+struct ImageDispatchConstants
+{
+    uint32_t    inputSize[2];
+    uint32_t    outputSize[2];
+    uint32_t    spatialOp;                          // ImageSpatialOp
+    float       spatialAmount;
+    uint32_t    pointOpCount;
+    uint32_t    padding;
+    uint32_t    pointOps[IMAGE_MAX_FUSED_OPS];      // ImageOperationType
+    float       pointAmounts[IMAGE_MAX_FUSED_OPS];
+};
+
+struct ImageDispatch
+{
+    ImageDispatchConstants  constants;
+    uint32_t                width;      // output
+    uint32_t                height;
+};
+
+// the dispatches running the chain on an image of the given size, in order
+// (empty for an empty chain). The last one's size is the result's.
+std::vector<ImageDispatch>  planImageDispatches(const ImageOperationChain& chain, uint32_t width, uint32_t height);
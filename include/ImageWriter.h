@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Image Writer
+//
+//  Writes 8-bit RGBA pixels to a PNG file. Meant for captures (see
+//  VulkanManager::captureFrame), so it favors speed over size: the image
+//  data is stored without compression (deflate "stored" blocks), which is
+//  still a valid PNG for any reader.
+//
+//  The pixels can be read straight from a mapped readback buffer: rows
+//  may be padded (rowPitch) and in BGRA order (the usual swapchain format).
+// ---------------------------------------------------------------------
+
+struct ImageWriteDesc
+{
+    uint32_t        width;
+    uint32_t        height;
+    uint32_t        rowPitch;   // bytes between two rows, at least width * 4
+    bool            isBgra;     // swizzled to RGBA when written
+    const uint8_t*  pixels;
+};
+
+bool    writePng(const char* path, const ImageWriteDesc& image);
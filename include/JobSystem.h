@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Job System
+//
+//  Work-stealing job scheduler shared by the engine. Each worker owns a
+//  deque: it pushes and pops its own jobs at the bottom (LIFO, cache
+//  friendly), and steals from the top of the others when it runs dry.
+//  Threads that are not workers (i.e. the main thread) share an extra
+//  deque, and help executing jobs while they wait.
+//
+//  Completion is tracked with counters: a job increments its counter
+//  when scheduled and decrements it when finished. A job can depend on
+//  counters, and only runs once all of them reached zero.
+//
+//  Jobs and their functions live in a fixed pool, so scheduling never
+//  touches the heap.
+// ---------------------------------------------------------------------
+
+class JobSystem;
+struct WaiterNode;
+
+class JobCounter
+{
+public:
+    JobCounter() : m_value(0), m_waiters(nullptr) {}
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const { return m_value.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t>   m_value;
+    std::mutex              m_mutex;    // guards m_waiters
+    WaiterNode*             m_waiters;  // jobs that depend on this counter
+};
+
+class JobSystem
+{
+public:
+    static constexpr size_t     k_maxJobs           = 4096;
+    static constexpr size_t     k_maxDependencies   = 4;
+    static constexpr size_t     k_jobStorageSize    = 64;   // bytes available for the captured function
+
+    explicit JobSystem(uint32_t workerCount = 0);   // 0: one worker per core, minus the main thread
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Runs function() on any thread once all the dependencies are done.
+    // signalCounter (optional) is decremented when the function returns.
+    template <typename Function>
+    void        schedule(Function&& function,
+                         JobCounter* signalCounter = nullptr,
+                         std::initializer_list<JobCounter*> dependencies = {});
+
+    // Executes jobs on the calling thread until the counter reaches zero.
+    void        wait(JobCounter& counter);
+
+    // Splits [0, count) into batches of batchSize, calls function(begin, end)
+    // in parallel and waits for all of them.
+    template <typename Function>
+    void        parallelFor(size_t count, size_t batchSize, const Function& function);
+
+    uint32_t    getWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    friend struct WaiterNode;
+    struct Job;
+
+    // fixed-capacity deque, guarded by a mutex
+    struct WorkQueue
+    {
+        std::mutex  mutex;
+        Job*        jobs[k_maxJobs];
+        size_t      top     = 0;    // steal from here
+        size_t      bottom  = 0;    // owner pushes/pops here
+    };
+
+    Job*        allocateJob();
+    void        freeJob(Job*);
+    void        submit(Job*, JobCounter* signalCounter, std::initializer_list<JobCounter*> dependencies);
+    void        enqueue(Job*);
+    void        execute(Job*);
+    void        decrement(JobCounter*);
+    bool        runOneJob();
+    Job*        findJob(size_t queueIndex);
+    void        workerLoop(size_t queueIndex);
+    size_t      getQueueIndex() const;
+
+    // << Job Pool >>
+    Job*                        m_jobPool;
+    Job*                        m_freeJobs;
+    std::mutex                  m_freeJobsMutex;
+
+    // << Queues >> index 0 is shared by non-worker threads, then one per worker
+    std::vector<WorkQueue*>     m_queues;
+    std::atomic<uint32_t>       m_queuedJobs;
+
+    // << Workers >>
+    std::vector<std::thread>    m_workers;
+    std::atomic<bool>           m_isRunning;
+    std::mutex                  m_sleepMutex;
+    std::condition_variable     m_sleepCondition;
+};
+
+
+// ------------------------------< Internal >------------------------------
+
+struct WaiterNode
+{
+    JobSystem::Job*         job;
+    WaiterNode*             next;
+};
+
+struct JobSystem::Job
+{
+    void        (*invoke)(void* storage);
+    void        (*destroy)(void* storage);
+    alignas(std::max_align_t) unsigned char storage[k_jobStorageSize];
+
+    JobCounter*             signalCounter;
+    std::atomic<uint32_t>   pendingDependencies;
+    WaiterNode              waiters[k_maxDependencies];     // one node per dependency
+    Job*                    nextFree;
+};
+
+template <typename Function>
+void JobSystem::schedule(Function&& function, JobCounter* signalCounter, std::initializer_list<JobCounter*> dependencies)
+{
+    using FunctionType = typename std::decay<Function>::type;
+    static_assert(sizeof(FunctionType) <= k_jobStorageSize,
+                  "job function is too large, capture by reference or pointer");
+    static_assert(alignof(FunctionType) <= alignof(std::max_align_t),
+                  "job function is over-aligned");
+
+    Job* job = allocateJob();
+    new (job->storage) FunctionType(std::forward<Function>(function));
+    job->invoke  = [](void* storage) { (*static_cast<FunctionType*>(storage))(); };
+    job->destroy = [](void* storage) { static_cast<FunctionType*>(storage)->~FunctionType(); };
+
+    submit(job, signalCounter, dependencies);
+}
+
+template <typename Function>
+void JobSystem::parallelFor(size_t count, size_t batchSize, const Function& function)
+{
+    if (count == 0)
+        return;
+    if (batchSize == 0)
+        batchSize = 1;
+
+    JobCounter counter;
+    for (size_t begin = 0; begin < count; begin += batchSize)
+    {
+        const size_t end = begin + batchSize < count ? begin + batchSize : count;
+        schedule([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+    wait(counter);
+}
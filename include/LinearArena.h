@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Linear Arena
+//
+//  A bump allocator for the transient CPU data of a frame: allocating is
+//  an aligned pointer increment, nothing is freed individually, and
+//  reset() releases everything at once. Each frame in flight has its own,
+//  reset when its slot is reused (see VulkanManager::drawFrame), so what
+//  a frame allocates stays valid until the frame is recorded.
+//
+//      FrameVector<SortedDraw> draws{ ArenaAllocator<SortedDraw>(frameArena) };
+//      draws.reserve(drawCount);
+//
+//  An arena that runs out of room takes the rest of the frame from the
+//  heap, then grows to the peak on the next reset(): after the first few
+//  frames, a steady frame doesn't allocate from the heap at all.
+//
+//  Not thread safe, an arena belongs to the thread recording the frame.
+// ---------------------------------------------------------------------
+
+class LinearArena
+{
+public:
+    explicit LinearArena(size_t capacity = 0);
+
+    void*   allocate(size_t size, size_t alignment);
+    template<typename T>
+    T*      allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+    // everything allocated so far is released
+    void    reset();
+
+    size_t  getCapacity() const { return m_capacity; }
+    size_t  getUsedBytes() const { return m_usedBytes; }
+    size_t  getPeakBytes() const { return m_peakBytes; }     // over all the resets
+    size_t  getOverflowCount() const { return m_overflowBlocks.size(); }   // heap allocations since the last reset
+
+private:
+    std::unique_ptr<uint8_t[]>                  m_memory;
+    size_t                                      m_capacity;
+    size_t                                      m_offset;
+    size_t                                      m_usedBytes;        // overflow included
+    size_t                                      m_peakBytes;
+    std::vector<std::unique_ptr<uint8_t[]>>     m_overflowBlocks;   // since the last reset, when out of room
+};
+
+// STL allocator on a LinearArena, deallocate() is a no-op. Containers
+// using it must not outlive the arena's next reset().
+template<typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    // the arena goes along with the contents
+    using propagate_on_container_copy_assignment    = std::true_type;
+    using propagate_on_container_move_assignment    = std::true_type;
+    using propagate_on_container_swap               = std::true_type;
+
+    ArenaAllocator() : m_arena(nullptr) {}     // for empty containers only
+    explicit ArenaAllocator(LinearArena& arena) : m_arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.getArena()) {}
+
+    T* allocate(size_t count)
+    {
+        if (!m_arena)
+            throw std::bad_alloc();
+        return m_arena->allocate<T>(count);
+    }
+    void deallocate(T*, size_t) {}
+
+    LinearArena*    getArena() const { return m_arena; }
+
+private:
+    LinearArena*    m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.getArena() == b.getArena(); }
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.getArena() != b.getArena(); }
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+// ---------------------------------------------------------------------
+//  Memory Tracker
+//
+//  Accounting layer over vkAllocateMemory / vkFreeMemory. Every device
+//  allocation is tagged with a category, and the usage is tracked per
+//  category and per heap. When VK_EXT_memory_budget is enabled, the
+//  driver's view of each heap (usage by the whole process, and the budget
+//  left to us by the OS/other apps) is queried as well.
+//
+//  Allocations may come from several threads (e.g. init jobs).
+// ---------------------------------------------------------------------
+
+enum class MemoryCategory : uint32_t
+{
+    Vertex,
+    Index,
+    Uniform,
+    Texture,
+    Staging,
+    Attachment,
+    Readback,
+    Transient,      // see TransientBuffer
+
+    Count
+};
+
+const char* getMemoryCategoryName(MemoryCategory category);
+
+struct MemoryHeapBudget
+{
+    VkDeviceSize    size;           // heap size
+    VkDeviceSize    budget;         // how much the process can use (heap size without VK_EXT_memory_budget)
+    VkDeviceSize    usage;          // used by the process (tracked usage without VK_EXT_memory_budget)
+    VkDeviceSize    trackedUsage;   // allocated through this tracker
+    bool            isDeviceLocal;
+};
+
+using MemoryHeapBudgets = std::array<MemoryHeapBudget, VK_MAX_MEMORY_HEAPS>;
+
+class MemoryTracker
+{
+public:
+    MemoryTracker();
+
+    // isMemoryBudgetEnabled: VK_EXT_memory_budget is enabled on the device
+    void        init(VkPhysicalDevice physicalDevice, bool isMemoryBudgetEnabled);
+
+    VkResult    allocate(VkDevice device, const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category, VkDeviceMemory* outMemory);
+    void        free(VkDevice device, VkDeviceMemory memory);
+
+    // << Queries >>
+    // returns the number of heaps written into outBudgets
+    uint32_t        getHeapBudgets(MemoryHeapBudgets& outBudgets) const;
+    VkDeviceSize    getCategoryUsage(MemoryCategory category) const;
+    uint32_t        getCategoryAllocationCount(MemoryCategory category) const;
+
+    void        printReport() const;
+
+private:
+    struct Allocation
+    {
+        VkDeviceSize    size;
+        MemoryCategory  category;
+        uint32_t        heapIndex;
+    };
+
+    static constexpr size_t k_categoryCount = static_cast<size_t>(MemoryCategory::Count);
+
+    VkPhysicalDevice                    m_physicalDevice;
+    VkPhysicalDeviceMemoryProperties    m_memoryProperties;
+    bool                                m_isMemoryBudgetEnabled;
+
+    std::unordered_map<VkDeviceMemory, Allocation>  m_allocations;
+    std::array<VkDeviceSize, k_categoryCount>       m_categoryUsage;
+    std::array<uint32_t, k_categoryCount>           m_categoryAllocationCount;
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS>   m_heapUsage;
+    mutable std::mutex                              m_mutex;
+};
@@ -3,9 +3,23 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <string>
 
 // forward declaration
 class VulkanManager;
+struct ImageCompareResult;
+
+// what the app renders, see setScene()
+enum class AppScene : uint32_t
+{
+    Quads,              // the textured quads, animated (default)
+    QuadsNoMsaa,        // the same, without multisampling
+    Sprites,            // the quads, under a grid of sprites
+    ProcessedTexture,   // the quads, their texture processed on the GPU (see ImageProcessing.h)
+    ResizedTexture,     // the same, resized up then down twice (the steps in the corner of the ping-pong images)
+
+    Count
+};
 
 class MyApp
 {
@@ -13,12 +27,40 @@ public:
     MyApp();
     virtual ~MyApp();
 
-    void run();
+    int  run();     // exit code
+
+    // << Golden Image >> instead of the main loop, renders a fixed frame and
+    // compares it against the reference (or writes it, isUpdate) then exits
+    void setGoldenImage(const std::string& referencePath, bool isUpdate);
+    void setGoldenOutput(const std::string& outputPath);
+    void setGoldenResults(const std::string& csvPath);     // appends the result and the frame time of the run
+
+    // << Scene >> by name (see AppScene), false if there is no such scene.
+    // The golden image tests render each of them.
+    bool setScene(const std::string& name);
+
+    // << Frame Limit >> the main loop exits after frameCount frames, then
+    // prints the CPU frame time. 0: runs until the window is closed
+    void setFrameLimit(uint32_t frameCount);
+
+    // << Allocation Check >> the main loop fails (exit code) if a frame
+    // allocates from the heap once the renderer is warmed up, see
+    // AllocationCounter.h
+    void setAllocationCheck(bool isEnabled);
+
+    // << Renderer Settings >> applied before the renderer is initialized,
+    // 0: the renderer's default
+    void setMaxFramesInFlight(uint32_t maxFramesInFlight);
+    void setMsaaSamples(uint32_t sampleCount);
 
 private:
     void    initGLFW();
     void    initVulkanManager();
-    void    mainLoop();
+    bool    mainLoop();     // false: the allocation check failed
+    bool    runGoldenImage();
+    bool    writeGoldenResult(const char* result, double frameTimeMs, const ImageCompareResult* compare);
+    void    submitSceneSprites();
+    void    drawSceneFrame();
     void    cleanVulkanManager();
     void    cleanup();
 
@@ -29,4 +71,19 @@ private:
 
     // Vulkan Manager
     VulkanManager*  m_VulkanManager;
+
+    // Golden Image
+    std::string     m_goldenReferencePath;  // empty: regular run
+    std::string     m_goldenOutputPath;
+    std::string     m_goldenResultsPath;    // empty: not written
+    bool            m_isGoldenUpdate;
+
+    AppScene        m_scene;
+
+    uint32_t        m_frameLimit;
+    bool            m_isAllocationCheck;
+
+    // Renderer Settings
+    uint32_t        m_maxFramesInFlight;
+    uint32_t        m_msaaSamples;
 };
\ No newline at end of file
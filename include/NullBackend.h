@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Null Backend
+//
+//  Stub Vulkan and GLFW entry points, for measuring the CPU cost of the
+//  renderer alone. The Hello_Vulkan_null target (BUILD_NULL_BACKEND, see
+//  CMakeLists.txt) is built from the same sources, but is linked against
+//  NullBackend.cpp instead of the Vulkan loader and GLFW: it runs without
+//  a GPU, a Vulkan driver (ICD) or a display.
+//
+//  Every call returns right away with valid handles. The GPU work is done
+//  as soon as it is submitted (timeline semaphores are signaled by the
+//  submit), queries read zeros, and only host visible memory is backed by
+//  actual memory. The window never closes: run it with a frame limit.
+//
+//      ./Hello_Vulkan_null --frames 1000
+//
+//  vkGetInstanceProcAddr / vkGetDeviceProcAddr resolve through the table
+//  of all the stubs, extensions included.
+// ---------------------------------------------------------------------
+
+// Vulkan calls made so far, on all threads
+uint64_t    getNullBackendCallCount();
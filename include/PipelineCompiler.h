@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "JobSystem.h"
+
+#include <string>
+#include <functional>
+#include <future>
+#include <memory>
+
+// ---------------------------------------------------------------------
+//  Pipeline Compiler
+//
+//  Builds pipelines as jobs so vkCreate*Pipelines never blocks the main
+//  thread. All the builds share one VkPipelineCache, which is
+//  loaded from and saved to the disk. A request returns a future, and the
+//  caller keeps drawing with the previous (or no) pipeline until it is
+//  ready.
+// ---------------------------------------------------------------------
+
+class PipelineCompiler
+{
+public:
+    // creates the pipeline with the given (shared) pipeline cache
+    using BuildFunction = std::function<VkPipeline(VkPipelineCache)>;
+
+    PipelineCompiler();
+    ~PipelineCompiler();
+
+    void    init(VkDevice device, const std::string& cachePath, JobSystem& jobSystem);
+    void    clean();    // waits for the pending builds, then saves the cache
+
+    // the build starts once the dependency (optional) is done
+    std::shared_future<VkPipeline>  compile(BuildFunction buildFunction, JobCounter* dependency = nullptr);
+
+private:
+    struct BuildRequest
+    {
+        BuildFunction               buildFunction;
+        std::promise<VkPipeline>    promise;
+    };
+
+    void    build(BuildRequest& request);
+    void    loadPipelineCache();
+    void    savePipelineCache();
+
+    VkDevice                    m_device;
+    VkPipelineCache             m_pipelineCache;
+    std::string                 m_cachePath;
+
+    // << Jobs >>
+    JobSystem*                  m_jobSystem;
+    JobCounter                  m_pendingBuilds;
+};
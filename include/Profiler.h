@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Profiler
+//
+//  Lightweight CPU instrumentation. A zone measures the scope it is
+//  declared in, and is recorded into a ring buffer owned by the calling
+//  thread, so recording never contends with other threads (the buffer's
+//  lock is only shared with the reports).
+//
+//      void VulkanManager::createSwapChain()
+//      {
+//          PROFILE_FUNCTION();
+//          ...
+//      }
+//
+//  Zone names must be string literals (only the pointer is stored).
+//  Define DISABLE_PROFILER to compile all the zones out.
+// ---------------------------------------------------------------------
+
+class Profiler
+{
+public:
+    // nanoseconds since an arbitrary (process wide) origin
+    static uint64_t now();
+
+    static void     recordZone(const char* name, uint64_t startTime, uint64_t endTime);
+
+    // prints the zones recorded since startTime, on all threads, aggregated
+    // by name and sorted by total time. Percentages are relative to the
+    // zone named totalZoneName (if any).
+    static void     printReport(const char* title, uint64_t startTime, const char* totalZoneName = nullptr);
+};
+
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char* name) : m_name(name), m_startTime(Profiler::now()) {}
+    ~ProfileZone() { Profiler::recordZone(m_name, m_startTime, Profiler::now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t    m_startTime;
+};
+
+#define PROFILE_CONCAT_IMPL(_a, _b)     _a##_b
+#define PROFILE_CONCAT(_a, _b)          PROFILE_CONCAT_IMPL(_a, _b)
+
+#if defined(DISABLE_PROFILER)
+#   define PROFILE_ZONE(_name)
+#   define PROFILE_FUNCTION()
+#else
+#   define PROFILE_ZONE(_name)          ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(_name)
+#   define PROFILE_FUNCTION()           PROFILE_ZONE(__func__)
+#endif
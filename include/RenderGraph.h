@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <functional>
+
+class LinearArena;
+
+// ---------------------------------------------------------------------
+//  Render Graph
+//
+//  Describes a frame as a list of passes, each declaring how it uses the
+//  images it touches (ImageUsage). From that, compile() derives:
+//
+//   - the pass order (dependencies between conflicting accesses)
+//   - the image layouts, and one vkCmdPipelineBarrier per pass covering
+//     all its images, with the stage/access masks of the actual producer
+//     and consumer (no barrier at all between two reads in the same layout)
+//   - the load/store ops of the attachments (content needed before/after)
+//
+//  The graph is set up once (i.e. per swapchain), executed every time the
+//  command buffers are recorded. The passes record their own commands,
+//  the render pass of a graphics pass included (see getAttachmentDescription).
+//
+//      RenderGraphImage color = graph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT,
+//                                                 ImageUsage::Acquired, ImageUsage::Present);
+//      RenderGraphPass  main  = graph.addPass("main", [&](VkCommandBuffer cmd) { ... });
+//      graph.write(main, color, ImageUsage::ColorAttachment, true);
+//      graph.compile();
+//      ...
+//      graph.bindImage(color, swapchainImage);
+//      graph.execute(cmd, frameArena);
+//
+//  Names must be string literals (only the pointer is stored).
+// ---------------------------------------------------------------------
+
+enum class ImageUsage : uint32_t
+{
+    Undefined,              // content not needed
+    Acquired,               // swapchain image, right after the acquire semaphore wait
+    ColorAttachment,
+    ColorResolve,           // multisample resolve target, fully overwritten
+    DepthStencilAttachment,
+    DepthStencilRead,       // depth test without writes
+    SampledFragment,
+    SampledCompute,
+    StorageCompute,
+    TransferSrc,
+    TransferDst,
+    Present,
+
+    Count
+};
+
+// how an image is used by the pipeline: the layout it must be in, the
+// stages that access it and the type of accesses
+struct ImageState
+{
+    VkImageLayout           layout;
+    VkPipelineStageFlags    stageMask;
+    VkAccessFlags           accessMask;
+};
+
+const char* getImageUsageName(ImageUsage usage);
+ImageState  getImageUsageState(ImageUsage usage);
+// the state of an image in the given layout, for the one-off transitions
+// outside of the graph (i.e. uploads). Unknown layouts get all the stages.
+ImageState  getImageLayoutState(VkImageLayout layout);
+
+using RenderGraphImage  = uint32_t;
+using RenderGraphPass   = uint32_t;
+
+class RenderGraph
+{
+public:
+    using RecordFunction = std::function<void(VkCommandBuffer)>;
+
+    RenderGraph();
+
+    // << Setup >>
+    void                reset();
+    // initialUsage: how the image is left before the graph runs
+    // finalUsage: how it must be left after, ImageUsage::Undefined if the
+    //             content is not needed anymore (i.e. depth buffers)
+    RenderGraphImage    importImage(const char* name, VkImageAspectFlags aspectMask, ImageUsage initialUsage, ImageUsage finalUsage);
+    RenderGraphPass     addPass(const char* name, RecordFunction record);
+    void                read(RenderGraphPass pass, RenderGraphImage image, ImageUsage usage);
+    // isCleared: the pass clears the attachment, the previous content is not needed
+    void                write(RenderGraphPass pass, RenderGraphImage image, ImageUsage usage, bool isCleared = false);
+
+    // orders the passes and plans the barriers, must be done before execute()
+    bool                compile();
+
+    // << Queries >> valid after compile()
+    // the attachment of a graphics pass, with the derived load/store ops. The
+    // layout transitions are done by the graph, the render pass keeps the
+    // attachment in the layout of its usage.
+    VkAttachmentDescription getAttachmentDescription(RenderGraphPass pass, RenderGraphImage image, VkFormat format,
+                                                     VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT) const;
+    const std::vector<RenderGraphPass>& getPassOrder() const { return m_passOrder; }
+    uint32_t            getPipelineBarrierCount() const;     // vkCmdPipelineBarrier calls per execution
+    void                printPlan() const;
+
+    // << Execution >>
+    // images may change between executions (i.e. the swapchain image)
+    void                bindImage(RenderGraphImage image, VkImage vkImage);
+    // the barriers are built in arena (the frame's, see LinearArena.h)
+    void                execute(VkCommandBuffer commandBuffer, LinearArena& arena);
+
+private:
+    struct Image
+    {
+        const char*         name;
+        VkImage             image;
+        VkImageAspectFlags  aspectMask;
+        ImageUsage          initialUsage;
+        ImageUsage          finalUsage;
+    };
+
+    struct Access
+    {
+        RenderGraphImage    image;
+        ImageUsage          usage;
+        bool                isWrite;
+        bool                isCleared;
+        bool                isOverwritten;  // previous content not needed (cleared, resolved)
+        // derived by compile()
+        VkAttachmentLoadOp  loadOp;
+        VkAttachmentStoreOp storeOp;
+    };
+
+    struct Pass
+    {
+        const char*         name;
+        RecordFunction      record;
+        std::vector<Access> accesses;
+    };
+
+    struct Barrier
+    {
+        RenderGraphImage    image;
+        ImageUsage          usage;      // transitioned to
+        VkImageLayout       oldLayout;
+        VkImageLayout       newLayout;
+        VkAccessFlags       srcAccessMask;
+        VkAccessFlags       dstAccessMask;
+    };
+
+    // the barriers issued before a pass, in a single vkCmdPipelineBarrier
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags    srcStageMask;
+        VkPipelineStageFlags    dstStageMask;
+        std::vector<Barrier>    barriers;   // none for an execution dependency only
+    };
+
+    // state of an image while walking through the passes
+    struct ImageTracking
+    {
+        VkImageLayout           layout;
+        VkPipelineStageFlags    writeStageMask;     // last write (or layout transition)
+        VkAccessFlags           writeAccessMask;    // to be made visible to the next accesses
+        VkPipelineStageFlags    readStageMask;      // reads since the last write
+        VkPipelineStageFlags    syncedStageMask;    // stages already ordered after the last write
+        VkAccessFlags           visibleAccessMask;  // accesses the last write is visible to
+        bool                    isContentDefined;
+    };
+
+    void    orderPasses();
+    void    planBarriers();
+    void    deriveAttachmentOps();
+    void    trackAccess(BarrierBatch& batch, ImageTracking& tracking, RenderGraphImage image, ImageUsage usage, bool isWrite, bool isOverwritten) const;
+    void    recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch, LinearArena& arena);
+    const Access*   findAccess(RenderGraphPass pass, RenderGraphImage image) const;
+
+    std::vector<Image>          m_images;
+    std::vector<Pass>           m_passes;
+
+    // << Compiled >>
+    bool                        m_isCompiled;
+    std::vector<RenderGraphPass>    m_passOrder;
+    std::vector<BarrierBatch>   m_passBarriers;     // per position in m_passOrder
+    BarrierBatch                m_finalBarriers;    // to the final usages
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <mutex>
+#include <filesystem>
+
+// ---------------------------------------------------------------------
+//  Shader Compiler
+//
+//  Compiles GLSL sources (shader.vert, shader.frag...) into SPIR-V at
+//  runtime. Compiled byte code is stored in a content-hashed cache on
+//  disk, so an unchanged source is never compiled twice. Watched sources
+//  are polled for modifications to allow hot reloading.
+//
+//  Compilation is done in-process through shaderc when it is available
+//  (USE_SHADERC), otherwise by invoking the glslc executable. Shaders can
+//  be loaded from multiple threads (e.g. pipeline compiler workers).
+// ---------------------------------------------------------------------
+
+class ShaderCompiler
+{
+public:
+    ShaderCompiler(const std::string& shaderDir, const std::string& cacheDir);
+
+    // returns the SPIR-V byte code of a shader source (e.g. "shader.vert").
+    // throws std::runtime_error if the source fails to compile.
+    std::vector<char>   loadSpirv(const std::string& shaderName);
+
+    // << Hot Reload >>
+    // sources are watched once they are loaded. pollChanges() returns the
+    // names of the modified sources since the last poll.
+    bool                pollChanges(std::vector<std::string>& outChangedShaders);
+
+private:
+    std::vector<char>   compile(const std::string& shaderName, const std::vector<char>& source);
+    std::string         getCachePath(const std::string& shaderName, uint64_t hash) const;
+
+    struct WatchedShader
+    {
+        std::filesystem::path               sourcePath;     // kept, polling doesn't allocate
+        std::filesystem::file_time_type     writeTime;      // last modification
+    };
+
+    std::filesystem::path   m_shaderDir;
+    std::filesystem::path   m_cacheDir;
+
+    std::map<std::string, WatchedShader>    m_watchedShaders;
+    std::chrono::steady_clock::time_point   m_lastPollTime;
+    std::mutex                              m_watchMutex;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cstddef>      // offsetof
+
+// ---------------------------------------------------------------------
+//  Shader Types
+//
+//  The data layouts shared with the shaders of the main pass (shader.vert):
+//  the vertex and instance inputs, and the uniform buffer. They only depend
+//  on the Vulkan headers, not on a device, so the CPU side code that fills
+//  them can be benchmarked on its own (see BenchmarkMain.cpp).
+// ---------------------------------------------------------------------
+
+struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+
+    // Vertex Binding: describes at which rate the vertex data should be loaded.
+    static VkVertexInputBindingDescription getBindingDesc()
+    {
+        VkVertexInputBindingDescription vertexInputBindingDesc{};
+        vertexInputBindingDesc.binding      = 0;    // index of the binding
+        vertexInputBindingDesc.stride       = sizeof(Vertex);
+        // available options are:
+        // VK_VERTEX_INPUT_RATE_VERTEX: move to next data entry after each vertex
+        // VK_VERTEX_INPUT_RATE_INSTANCE: move to next data entry after each instance
+        vertexInputBindingDesc.inputRate    = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return vertexInputBindingDesc;
+    }
+
+    // Attribute Binding: how to extract a chunk of attribute vertex data
+    // from binding description. Here we have 3: position, color, textCoord
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDesc()
+    {
+        std::array<VkVertexInputAttributeDescription, 3> vertexInputAttributeDesc{};
+        const int iPos      = 0;
+        const int iColor    = 1;
+        const int iTex      = 2;
+
+        vertexInputAttributeDesc[iPos].binding  = 0;    // from which binding per-vertex comes from
+        vertexInputAttributeDesc[iPos].location = 0;    // in the shader, (location = x)
+        // common formats:
+        // float: VK_FORMAT_R32_SFLOAT
+        // vec2: VK_FORMAT_R32G32_SFLOAT
+        // vec3: VK_FORMAT_R32G32B32_SFLOAT
+        // vec4: VK_FORMAT_R32G32B32A32_SFLOAT
+        vertexInputAttributeDesc[iPos].format   = VK_FORMAT_R32G32B32_SFLOAT;
+        vertexInputAttributeDesc[iPos].offset   = offsetof(Vertex, pos);
+
+        vertexInputAttributeDesc[iColor].binding  = 0;    // from which binding per-vertex comes from
+        vertexInputAttributeDesc[iColor].location = 1;    // in the shader, (location = x)
+        vertexInputAttributeDesc[iColor].format   = VK_FORMAT_R32G32B32_SFLOAT;
+        vertexInputAttributeDesc[iColor].offset   = offsetof(Vertex, color);
+
+        vertexInputAttributeDesc[iTex].binding  = 0;    // from which binding per-vertex comes from
+        vertexInputAttributeDesc[iTex].location = 2;    // in the shader, (location = x)
+        vertexInputAttributeDesc[iTex].format   = VK_FORMAT_R32G32_SFLOAT;
+        vertexInputAttributeDesc[iTex].offset   = offsetof(Vertex, texCoord);
+
+        return vertexInputAttributeDesc;
+    }
+};
+
+// per instance (binding 1): the world matrix of the draw, see updateInstanceBuffer()
+struct InstanceData
+{
+    static VkVertexInputBindingDescription getBindingDesc()
+    {
+        VkVertexInputBindingDescription instanceInputBindingDesc{};
+        instanceInputBindingDesc.binding    = 1;
+        instanceInputBindingDesc.stride     = sizeof(glm::mat4);
+        instanceInputBindingDesc.inputRate  = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return instanceInputBindingDesc;
+    }
+
+    // a mat4 attribute takes 4 locations, one column each
+    static std::array<VkVertexInputAttributeDescription, 4> getAttributeDesc()
+    {
+        std::array<VkVertexInputAttributeDescription, 4> instanceInputAttributeDesc{};
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            instanceInputAttributeDesc[column].binding  = 1;
+            instanceInputAttributeDesc[column].location = 3 + column;   // after the vertex attributes
+            instanceInputAttributeDesc[column].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+            instanceInputAttributeDesc[column].offset   = column * sizeof(glm::vec4);
+        }
+
+        return instanceInputAttributeDesc;
+    }
+};
+
+struct UniformBufferObject
+{
+    // Data alignment: Vulkan requires the memory to be aligned in a specific way:
+    // scalar(4) vec2(8) vec3/vec4/mat4(16), nested struct(x*16) in bytes
+    // So, here we use the alignas(C++11 feature) to make sure mat4 is aligned 16.
+    // It doesn't matter just like this (i.e already aligned 16,16,16 bytes) but it
+    // can be easily broken down by adding any other components such as vec2.
+    alignas(16)
+    glm::mat4 view;
+    alignas(16)
+    glm::mat4 proj;
+
+    // the camera of the scene, looking down at the origin (see updateUniformBuffer())
+    static UniformBufferObject makeCamera(float aspectRatio)
+    {
+        UniformBufferObject ubo{};
+        ubo.view = glm::lookAt(glm::vec3(2.0f), glm::vec3(0.0), glm::vec3(0.0f, 0.0f, 1.0f));
+        ubo.proj = glm::perspective(glm::radians(30.f), aspectRatio, 0.1f, 10.f);
+        ubo.proj[1][1] *= -1;   // flip Y-axis (because glm was designed for OpenGL)
+        return ubo;
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "DrawSort.h"
+
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Sprite Batch
+//
+//  Collects the 2D sprites of a frame and turns them into as few draws as
+//  possible: one indexed draw per texture (or atlas page), whatever the
+//  number of sprites.
+//
+//      SpriteBatch& sprites = vulkanManager.getSpriteBatch();
+//      sprites.submit(SPRITE_TEXTURE_DEFAULT, {x, y, 32, 32}, {0, 0, 1, 1});
+//      ...
+//      vulkanManager.drawFrame();      // flushed into the frame
+//
+//  flush() sorts the sprites by texture (then front-to-back) with the draw
+//  radix sort, and writes 4 vertices per sprite straight into the mapped
+//  vertex buffer of the frame. The index buffer is the same for every
+//  frame (see writeIndices), so a draw is just a range of sprites.
+//
+//  Sprites are depth tested and alpha tested (no blending), so the order
+//  they are drawn in doesn't matter and they can be grouped freely.
+//  Positions are in pixels, from the top-left corner of the window, and
+//  the depth is in [0, 1] (0: closest).
+// ---------------------------------------------------------------------
+
+using SpriteTexture = uint32_t;     // up to 2^DRAW_KEY_MATERIAL_BITS
+
+#define SPRITE_TEXTURE_DEFAULT      0   // the loaded texture, see VulkanManager::createTextureImage()
+#define SPRITE_COLOR_WHITE          0xffffffffu
+
+struct SpriteRect
+{
+    float   x;
+    float   y;
+    float   width;
+    float   height;
+};
+
+// 24 bytes, see sprite.vert
+struct SpriteVertex
+{
+    float       position[3];    // pixels, depth
+    float       texCoord[2];
+    uint32_t    color;          // RGBA8, multiplies the texture
+};
+
+// a range of sprites in the vertex buffer, drawn with one texture
+struct SpriteDraw
+{
+    SpriteTexture   texture;
+    uint32_t        firstSprite;
+    uint32_t        spriteCount;
+};
+
+// RGBA8 color from [0, 1] components
+uint32_t    makeSpriteColor(float r, float g, float b, float a = 1.0f);
+
+class SpriteBatch
+{
+public:
+    SpriteBatch();
+
+    // uv: the part of the texture, in normalized coordinates
+    void        submit(SpriteTexture texture, const SpriteRect& rect, const SpriteRect& uv,
+                       uint32_t color = SPRITE_COLOR_WHITE, float depth = 0.5f);
+    uint32_t    getSpriteCount() const { return static_cast<uint32_t>(m_sprites.size()); }
+
+    // writes the vertices of (up to maxSprites) sprites and the draws, in
+    // drawing order, and clears the batch. Returns the number of sprites written.
+    uint32_t    flush(SpriteVertex* vertices, uint32_t maxSprites, std::vector<SpriteDraw>& outDraws);
+
+    // 2 triangles per sprite, the same for every flush
+    static void writeIndices(uint32_t* indices, uint32_t spriteCount);
+
+private:
+    struct Sprite
+    {
+        SpriteRect      rect;
+        SpriteRect      uv;
+        uint32_t        color;
+        float           depth;
+    };
+
+    std::vector<Sprite>         m_sprites;
+    std::vector<SortedDraw>     m_order;        // keyed by texture and depth, one per sprite
+    std::vector<SortedDraw>     m_sortScratch;  // kept between frames, sorting doesn't allocate
+};
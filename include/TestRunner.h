@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Test Runner
+//
+//  A small harness for the unit tests of the parts that run without a
+//  device (see TestMain.cpp, built as Hello_Vulkan_tests). A case checks
+//  its expectations with TEST_CHECK, a failed check is printed and fails
+//  the case but the case goes on:
+//
+//      runner.add("imageCompare/identical", []() {
+//          ImageCompareResult result = compareImages(a, a);
+//          TEST_CHECK(result.isMatching);
+//          TEST_CHECK(result.maxDeltaE == 0.0f);
+//      });
+//
+//  The cases are selected by name like the benchmarks, ctest runs each
+//  group on its own (see CMakeLists.txt).
+// ---------------------------------------------------------------------
+
+#define TEST_CHECK(condition)   TestRunner::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+class TestRunner
+{
+public:
+    using Function = std::function<void()>;
+
+    void    add(const std::string& name, Function function);
+
+    // runs the cases whose name contains filter (all if empty), in the
+    // order they were added. Returns the number of failed cases, the
+    // number of cases run in runCount.
+    uint32_t    run(const std::string& filter, uint32_t& runCount) const;
+
+    // records a failed check in the running case
+    static void check(bool isPassing, const char* condition, const char* file, int line);
+
+private:
+    struct Case
+    {
+        std::string name;
+        Function    function;
+    };
+
+    std::vector<Case>   m_cases;
+};
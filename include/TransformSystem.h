@@ -0,0 +1,102 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <cstdint>
+
+// ---------------------------------------------------------------------
+//  Transform System
+//
+//  The transform hierarchy of the scene. Each node has a local position,
+//  rotation and scale relative to its parent, and a world matrix computed
+//  by update().
+//
+//  The nodes are stored as a structure of arrays, sorted by depth: the
+//  roots, then their children, and so on (breadth first, so siblings are
+//  next to each other). Each level is padded to a multiple of 4, so a
+//  group of 4 nodes never holds its own parent, and the pass computes
+//  the 4 world matrices together in SIMD registers, one lane per node:
+//  local TRS composition and parent multiplication alike. The world
+//  matrices are stored the same way (affine 3x4, per group of 4).
+//
+//  A level is done once the previous one is. With a JobSystem, the large
+//  levels are split into batches run by the workers. Only the dirty
+//  subtrees are recomputed: a node is updated when its local transform
+//  changed or its parent's world matrix did.
+//
+//      TransformHandle root = transforms.create();
+//      TransformHandle node = transforms.create(root);
+//      transforms.setPosition(node, glm::vec3(0.0f, 0.0f, 1.0f));
+//      transforms.update(&jobSystem);
+//      glm::mat4 world = transforms.getWorldMatrix(node);
+//
+//  Handles are stable, the storage is sorted again by the first update()
+//  after nodes were created (the whole hierarchy is recomputed then).
+//  Nodes are never destroyed individually, see clear().
+// ---------------------------------------------------------------------
+
+class JobSystem;
+
+using TransformHandle = uint32_t;
+
+#define INVALID_TRANSFORM   UINT32_MAX
+
+class TransformSystem
+{
+public:
+    TransformSystem();
+
+    // the parent must already exist (INVALID_TRANSFORM for a root)
+    TransformHandle create(TransformHandle parent = INVALID_TRANSFORM);
+    void            clear();
+    void            reserve(uint32_t nodeCount);
+
+    // << Local Transform >> relative to the parent
+    void            setPosition(TransformHandle node, const glm::vec3& position);
+    void            setRotation(TransformHandle node, const glm::quat& rotation);
+    void            setScale(TransformHandle node, const glm::vec3& scale);
+    void            setLocal(TransformHandle node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+    // recomputes the world matrices of the dirty subtrees, on the workers
+    // of jobSystem for the large levels (nullptr: on the calling thread)
+    void            update(JobSystem* jobSystem = nullptr);
+
+    // << Queries >> world matrices are valid after update()
+    uint32_t            getNodeCount() const { return static_cast<uint32_t>(m_slots.size()); }
+    uint32_t            getLevelCount() const { return static_cast<uint32_t>(m_levelOffsets.size()) - 1; }
+    TransformHandle     getParent(TransformHandle node) const { return m_parentHandles[node]; }
+    glm::mat4           getWorldMatrix(TransformHandle node) const;
+    bool                isWorldMatrixChanged(TransformHandle node) const { return m_isWorldChanged[m_slots[node]] != 0; }  // by the last update()
+    uint32_t            getUpdatedCount() const { return m_updatedCount; }                                                  // by the last update()
+
+private:
+    // the world matrices of 4 nodes, element r of column c in values[c * 3 + r]
+    struct alignas(16) WorldGroup
+    {
+        float   values[12][4];      // [element][lane], the last row is (0, 0, 0, 1)
+    };
+
+    void        sortByLevel();
+    uint32_t    updateGroups(uint32_t first, uint32_t end);     // returns the number of nodes updated
+    void        composeWorldMatrices(uint32_t first);
+
+    bool                    m_isSorted;         // false once nodes were created, see sortByLevel()
+    uint32_t                m_updatedCount;
+
+    // << Handles >> in creation order
+    std::vector<uint32_t>           m_slots;            // of each handle in the node arrays
+    std::vector<TransformHandle>    m_parentHandles;
+
+    // << Nodes >> by slot, sorted by level, each padded to a multiple of 4
+    std::vector<uint32_t>   m_levelOffsets;     // first slot of each level, then the slot count
+    std::vector<uint32_t>   m_parents;          // slot of the parent
+    std::vector<float>      m_positionX, m_positionY, m_positionZ;
+    std::vector<float>      m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+    std::vector<float>      m_scaleX, m_scaleY, m_scaleZ;
+    std::vector<uint8_t>    m_isDirty;          // local transform changed since the last update()
+    std::vector<uint8_t>    m_isWorldChanged;   // world matrix recomputed by the last update()
+    std::vector<WorldGroup> m_worldGroups;      // per 4 slots
+};
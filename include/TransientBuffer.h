@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------
+//  Transient Buffer
+//
+//  A ring over a single persistently mapped, host visible buffer, for the
+//  data that changes every frame (sprites, debug lines, UI, particles,
+//  per-draw uniforms...): a subsystem asks for N bytes for the current
+//  frame, writes them, and binds the buffer at the returned offset. No
+//  buffer is created per frame.
+//
+//      VkDeviceSize offset;
+//      SpriteVertex* vertices = transientBuffer.allocate<SpriteVertex>(n_vertices, TransientUsage::Vertex, offset);
+//      ...
+//      vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+//
+//  The ring remembers where each frame's allocations end. beginFrame()
+//  is given the last frame the GPU completed (the frame timeline), the
+//  space up to the end of that frame is reused. An allocation that would
+//  overwrite a frame still in flight fails instead (nullptr), an
+//  allocation never straddles the end of the buffer.
+//
+//  The memory is host coherent: nothing to flush. Not thread safe, the
+//  allocations are made by the thread recording the frame.
+// ---------------------------------------------------------------------
+
+enum class TransientUsage : uint32_t
+{
+    Vertex,
+    Index,
+    Uniform,    // aligned to minUniformBufferOffsetAlignment
+};
+
+struct TransientAllocation
+{
+    void*           data;       // nullptr: the ring is full
+    VkBuffer        buffer;
+    VkDeviceSize    offset;     // of data in buffer
+};
+
+class TransientBuffer
+{
+public:
+    TransientBuffer();
+
+    // buffer: created with the vertex, index and uniform usages, mapped at
+    // mappedData. size is rounded down to a multiple of the alignments.
+    void    init(VkBuffer buffer, void* mappedData, VkDeviceSize size, VkDeviceSize uniformAlignment, uint32_t framesInFlight);
+
+    // frame numbers start from 1, completedFrame: the last frame done on the GPU
+    void    beginFrame(uint64_t frameNumber, uint64_t completedFrame);
+
+    TransientAllocation     allocate(VkDeviceSize size, TransientUsage usage);
+    template<typename T>
+    T*                      allocate(uint32_t count, TransientUsage usage, VkDeviceSize& outOffset)
+    {
+        const TransientAllocation allocation = allocate(count * sizeof(T), usage);
+        outOffset = allocation.offset;
+        return static_cast<T*>(allocation.data);
+    }
+
+    VkBuffer        getBuffer() const { return m_buffer; }
+    VkDeviceSize    getSize() const { return m_size; }
+    VkDeviceSize    getUsedSize() const { return m_head - m_tail; }    // by the frames in flight, this one included
+
+private:
+    VkDeviceSize    getAlignment(TransientUsage usage) const;
+
+    struct FrameRange
+    {
+        uint64_t    frameNumber;    // 0: unused
+        uint64_t    end;            // m_head after its last allocation
+    };
+
+    VkBuffer                    m_buffer;
+    uint8_t*                    m_mappedData;
+    VkDeviceSize                m_size;
+    VkDeviceSize                m_uniformAlignment;
+
+    // bytes allocated since init, wrapping included: the offset is % m_size
+    uint64_t                    m_head;
+    uint64_t                    m_tail;             // oldest byte still used by a frame in flight
+    std::vector<FrameRange>     m_frames;           // per frame in flight slot
+    uint32_t                    m_frameSlot;        // of the current frame
+};
@@ -2,12 +2,57 @@
 
 #include <vulkan/vulkan.h>
 
+// glm
+#define GLM_FORCE_RADIANS   // use radians by default on any parameters
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+#include "ShaderCompiler.h"
+#include "PipelineCompiler.h"
+#include "MemoryTracker.h"
+#include "DeletionQueue.h"
+#include "RenderGraph.h"
+#include "DrawSort.h"
+#include "TransformSystem.h"
+#include "ImageProcessing.h"
+#include "SpriteBatch.h"
+#include "GpuStats.h"
+#include "LinearArena.h"
+#include "TransientBuffer.h"
+
 #include <vector>
+#include <string>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
 
 struct QueueFamilyIndices;
 struct SwapchainSupportDetails;
 struct GLFWwindow;
 
+// an opaque draw of the main pass
+struct DrawItem
+{
+    TransformHandle transform;  // world matrix written to the instance buffer (see updateInstanceBuffer)
+    uint32_t    pipeline;       // state of the draw, indices into the tables of recordMainPass()
+    uint32_t    material;
+    uint32_t    mesh;           // in m_meshes
+    uint32_t    firstIndex;
+    uint32_t    indexCount;
+    float       viewDepth;      // distance from the camera, updated every frame
+};
+
+// the vertex and index buffers of a draw
+struct DrawMesh
+{
+    VkBuffer    vertexBuffer;
+    VkBuffer    indexBuffer;
+};
+
 
 class VulkanManager
 {
@@ -17,11 +62,43 @@ public:
     void    initVulkan(GLFWwindow*);
     void    drawFrame();
     void    setFrameBufferResized(bool);
+    void    setMaxFramesInFlight(uint32_t);     // must be called before initVulkan()
+    void    setMsaaSamples(uint32_t);           // 1 to disable, must be called before initVulkan()
+    void    setTextureProcessing(const ImageOperationChain& chain);    // applied on load, must be called before initVulkan()
+    void    setAnimationTime(float seconds);    // freezes the animation (i.e. reproducible captures), negative to resume
+    bool    isReadyToRender() const { return m_graphicsPipeline != VK_NULL_HANDLE && m_spritePipeline != VK_NULL_HANDLE; }  // pipelines are built asynchronously
+
+    // << Frame Timeline >> frame N is complete once the timeline semaphore reaches N
+    uint64_t    getCurrentFrame() const { return m_frameCounter; }
+    bool        isFrameComplete(uint64_t frameNumber);
+    uint64_t    getCompletedFrame();
+    void        waitForFrame(uint64_t frameNumber);
+
+    // << Jobs >> shared with the app, i.e. for per-frame work
+    JobSystem&  getJobSystem() { return m_jobSystem; }
+
+    // << Sprites >> submitted before drawFrame(), drawn by it
+    SpriteBatch&    getSpriteBatch() { return m_spriteBatch; }
+
+    // << GPU Memory >> usage per category, and per heap against the budget
+    const MemoryTracker&    getMemoryTracker() const { return m_memoryTracker; }
+
+    // << GPU Stats >> counters of the last completed frame (see GpuStats)
+    const GpuFrameStats&    getGpuStats() const { return m_gpuStats.getLatestStats(); }
+
+    // << Frame Capture >> the next presented frame is written to path (PNG).
+    // Read back and written asynchronously, drawFrame() never waits for it.
+    bool        captureFrame(const std::string& path);
+    bool        isCaptureSupported() const { return m_isCaptureSupported; }
+    uint32_t    getPendingCaptureCount() const;     // requested, in flight or being written
+    void        waitForCaptures();                  // i.e. before exiting, draws frames until all are written
 
     void    cleanVulkan();
 
 private:
     void    updateUniformBuffer(uint32_t currentImageIdx);
+    void    sortOpaqueDraws(LinearArena& frameArena);
+    void    updateInstanceBuffer(uint32_t currentImageIdx);
 
 private:
     bool                        createVulkanInstance();
@@ -62,11 +139,13 @@ private:
 
     // << Device Extensions >>
     bool    checkDeviceExtensionSupport(VkPhysicalDevice);
+    bool    isDeviceExtensionSupported(VkPhysicalDevice, const char* extensionName);
 
     // << Swap Chain >>
     bool                    createSwapChain();
     bool                    recreateSwapChain();
     void                    cleanSwapChain();
+    void                    retireSwapChain();
     SwapchainSupportDetails querySwapChainSupport(VkPhysicalDevice);
     VkSurfaceFormatKHR      chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>&);
     VkPresentModeKHR        choosePresentMode(const std::vector<VkPresentModeKHR>&);
@@ -75,7 +154,15 @@ private:
     // << Image Views >>
     bool createImageViews();
     bool createTextureImageView();
-    bool createImageView(VkImage image, VkFormat format, VkImageView* outImageView);
+    bool createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectMask, VkImageView* outImageView);
+
+    // << Depth Buffer >>
+    bool        createDepthResources();
+
+    // << Multisampling >>
+    bool                    createColorResources();
+    VkSampleCountFlagBits   getMaxUsableSampleCount();
+    VkFormat    findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
     // << Descriptor Layout >>
     bool            createDescriptorSetLayout();
@@ -83,45 +170,111 @@ private:
     bool            createDescriptorSets();
 
     // << Graphics Pipeline >>
+    // what differs between the pipelines of the main pass
+    struct GraphicsPipelineDesc
+    {
+        const char*                                     vertShader;
+        const char*                                     fragShader;
+        VkPipelineLayout                                layout;
+        std::vector<VkVertexInputBindingDescription>    vertexBindings;
+        std::vector<VkVertexInputAttributeDescription>  vertexAttributes;
+        VkCullModeFlags                                 cullMode;
+        VkCompareOp                                     depthCompareOp;
+        bool                                            isBlended;
+    };
+    bool            createPipelineLayout();
     bool            createGraphicsPipeline();
+    VkPipeline      buildGraphicsPipeline(const GraphicsPipelineDesc& desc, VkRenderPass, VkPipelineCache);
+    bool            updateGraphicsPipeline();
+    bool            updatePipeline(std::shared_future<VkPipeline>& pendingPipeline, VkPipeline& pipeline, const char* name);
     VkShaderModule  createShaderModule(const std::vector<char>&);
+    void            prefetchShaders();
+    bool            reloadChangedShaders();
 
     // << Render Passes >>
     bool createRenderPass();
+    bool createRenderGraph();
+    bool buildRenderGraph(RenderGraph& graph, bool isCapturing);
+    void recordMainPass(VkCommandBuffer commandBuffer);
 
     // << Frame Buffers >>
     bool createFrameBuffers();
 
     // << Vertex Buffers >>
-    bool        createBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, VkBuffer&, VkDeviceMemory&);
+    bool        createBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, MemoryCategory, VkBuffer&, VkDeviceMemory&);
     bool        createVertexBuffer();
     bool        createTextureImage();
     bool        createIndexBuffer();
+    bool        createDrawList();
     bool        createUniformBuffers();
+    bool        createInstanceBuffers();
+    bool        createTransientBuffer();
     uint32_t    findMemoryType(uint32_t, VkMemoryPropertyFlags);
+    std::optional<uint32_t> queryMemoryType(uint32_t, VkMemoryPropertyFlags);    // nullopt: none, doesn't throw
     bool        copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize deviceSize);
 
     // << Images >>
-    void createImage(uint32_t w, uint32_t h, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags property, VkImage &img, VkDeviceMemory &mem);
+    void createImage(uint32_t w, uint32_t h, VkSampleCountFlagBits samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags property, MemoryCategory category, VkImage &img, VkDeviceMemory &mem);
     void transitionImageLayout(VkImage img, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 
     // << Image Samplers >>
     bool createTextureSampler();
 
+    // << Sprites >>
+    bool            createSpriteResources();
+    bool            createSpriteTextures();
+    SpriteTexture   addSpriteTexture(VkImageView imageView, VkSampler sampler);
+    void            updateSpriteBuffer();
+    void            recordSpriteDraws(VkCommandBuffer commandBuffer);
+
+    // << Image Processing >> compute, see ImageProcessing.h
+    bool createImageProcessingPipeline();
+    bool processImage(VkImage srcImage, VkImageView srcImageView, VkImage dstImage, const std::vector<ImageDispatch>& dispatches);
+
     // << Command Buffers >>
     bool            createCommandPool();
     bool            createCommandBuffers();
-    VkCommandBuffer beginSingleTimeCommands();
-    void            endSingleTimeCommands(VkCommandBuffer cmdBuffer);
+    bool            recordCommandBuffer(uint32_t imageIndex);
+    // the pool and the queue are shared: lock is held from begin to end, and
+    // released by its destructor if the recording throws in between
+    VkCommandBuffer beginSingleTimeCommands(std::unique_lock<std::mutex>& lock);
+    void            endSingleTimeCommands(VkCommandBuffer cmdBuffer, std::unique_lock<std::mutex> lock);
+
+    // << Deferred Destruction >>
+    // resources released now may be used by any submitted frame, and by the
+    // commands submitted before the next one (i.e. uploads)
+    uint64_t        getReleaseFrame() const { return m_frameCounter + 1; }
 
     // << Rendering & Presentation >>
     bool  createSyncObjects();
     bool  acquireNextImageIndex(const uint32_t frameIndex, uint32_t &imageIndex);
-    bool  submitCommandBuffer(const uint32_t frameIndex, const uint32_t imageIndex);
+    bool  submitCommandBuffer(const uint32_t frameIndex, const uint32_t imageIndex, const uint64_t frameNumber);
     bool  submitPresentation(const uint32_t frameIndex, const uint32_t imageIndex);
 
+    // << Frame Capture >>
+    struct CaptureReadback
+    {
+        VkBuffer        buffer          = VK_NULL_HANDLE;
+        VkDeviceMemory  memory          = VK_NULL_HANDLE;
+        uint8_t*        mapped          = nullptr;  // persistently
+        VkDeviceSize    size            = 0;
+        uint32_t        width           = 0;
+        uint32_t        height          = 0;
+        bool            isBgra          = false;
+        uint64_t        frameNumber     = 0;        // the frame copying into it, 0 if none
+        std::string     path;
+        JobCounter      writeCounter;   // writing the file
+    };
+    bool    beginCapture(uint32_t frameIndex);
+    void    processCaptures();
+    void    recordCapturePass(VkCommandBuffer commandBuffer);
+    static void writeCapture(CaptureReadback& readback);
+
 private:
+    // << Job System >> declared first, it outlives everything that schedules jobs
+    JobSystem                       m_jobSystem;
+
     // << Vulkan Instance >> connects between the application and the Vulkan library.
     VkInstance                      m_VkInstance;
     // << Validation Layers >> custom error-checking method
@@ -146,7 +299,13 @@ private:
     VkSurfaceKHR                    m_windowSurface;
 
     // << Device Extensions >>
-    const std::vector<const char*>  m_deviceExtensions;
+    const std::vector<const char*>  m_deviceExtensions;     // required, see createLogicalDevice() for the optional ones
+
+    // << GPU Memory >>
+    MemoryTracker                   m_memoryTracker;
+    DeletionQueue                   m_deletionQueue;
+    std::chrono::steady_clock::time_point   m_lastMemoryReportTime;
+    GpuStats                        m_gpuStats;
 
     // << Swap Chain >>
     VkSwapchainKHR                  m_swapchain;
@@ -161,6 +320,28 @@ private:
 
     // << Render Pass >>
     VkRenderPass                    m_renderPass;
+    RenderGraph                     m_renderGraph;
+    RenderGraphImage                m_graphSwapchainImage;
+    RenderGraphImage                m_graphTextureImage;
+    RenderGraphImage                m_graphDepthImage;
+    RenderGraphImage                m_graphColorImage;      // multisampled, resolved into the swapchain image
+    RenderGraphPass                 m_mainPass;
+    RenderGraph                     m_captureGraph;         // same, followed by the copy of the swapchain image
+    RenderGraphPass                 m_capturePass;
+
+    // << Frame Capture >>
+    bool                            m_isCaptureSupported;   // swapchain images can be copied from
+    std::deque<std::string>         m_captureRequests;
+    std::vector<std::unique_ptr<CaptureReadback>>  m_captureReadbacks;  // per frame in flight
+    CaptureReadback*                m_recordingCapture;     // copied into by the frame being recorded
+
+    // << Image Processing >> the pipeline is created on first use
+    ImageOperationChain             m_textureProcessing;
+    VkDescriptorSetLayout           m_imageProcessingSetLayout;
+    VkPipelineLayout                m_imageProcessingPipelineLayout;
+    VkPipeline                      m_imageProcessingPipeline;
+    VkSampler                       m_imageProcessingSampler;   // clamped, for the resize
+    std::mutex                      m_imageProcessingMutex;     // textures may be processed by several jobs
 
     // << Descriptors >>
     VkDescriptorSetLayout           m_descriptorSetLayout;
@@ -169,11 +350,56 @@ private:
 
     // << Graphics Pipeline >>
     VkPipelineLayout                m_pipelineLayout;
-    VkPipeline                      m_graphicsPipeline;
+    VkPipeline                      m_graphicsPipeline;     // VK_NULL_HANDLE until the first build is done
+    PipelineCompiler                m_pipelineCompiler;
+    std::shared_future<VkPipeline>  m_pendingGraphicsPipeline;
+    bool                            m_isGraphicsPipelineOutdated;
+
+    // << Shaders >>
+    ShaderCompiler                  m_shaderCompiler;
+    std::vector<std::string>        m_changedShaders;
+    JobCounter                      m_shadersLoaded;    // pipeline builds depend on it
 
     // << Frame Buffers >>
     std::vector<VkFramebuffer>      m_swapchainFrameBuffers;
 
+    // << Depth Buffer >> one for all the frames, the render graph orders their accesses
+    VkFormat                        m_depthFormat;
+    VkImage                         m_depthImage;
+    VkDeviceMemory                  m_depthImageMemory;
+    VkImageView                     m_depthImageView;
+
+    // << Multisampling >> transient images, only live during the main pass
+    uint32_t                        m_requestedMsaaSamples;
+    VkSampleCountFlagBits           m_msaaSamples;          // chosen once, the render pass and the pipeline depend on it
+    VkImage                         m_colorImage;
+    VkDeviceMemory                  m_colorImageMemory;
+    VkImageView                     m_colorImageView;
+
+    // << Draw List >>
+    std::vector<DrawItem>           m_opaqueDraws;
+    std::vector<DrawMesh>           m_meshes;
+    FrameVector<SortedDraw>         m_opaqueDrawOrder;  // by state, then front-to-back, in the frame's arena (see sortOpaqueDraws)
+
+    // << Scene >>
+    TransformSystem                 m_transforms;
+    TransformHandle                 m_sceneRoot;        // animated, the quads are its children
+    glm::mat4                       m_viewMatrix;       // of the current frame (see updateUniformBuffer)
+    float                           m_animationTime;    // fixed time in seconds, negative for real time
+
+    // << Sprites >>
+    SpriteBatch                     m_spriteBatch;
+    VkDescriptorSetLayout           m_spriteSetLayout;
+    VkPipelineLayout                m_spritePipelineLayout;
+    VkPipeline                      m_spritePipeline;       // built along with the graphics pipeline
+    std::shared_future<VkPipeline>  m_pendingSpritePipeline;
+    VkDescriptorPool                m_spriteDescriptorPool;
+    std::vector<VkDescriptorSet>    m_spriteTextures;       // per SpriteTexture
+    VkBuffer                        m_spriteIndexBuffer;
+    VkDeviceMemory                  m_spriteIndexBufferMemory;
+    VkDeviceSize                    m_spriteVertexOffset;   // in the transient buffer, of the frame being recorded
+    std::vector<SpriteDraw>         m_spriteDraws;          // of the frame being recorded
+
     // << Vertex Buffers >>
     VkBuffer                        m_vertexBuffer;
     VkDeviceMemory                  m_vertexBufferMemory;
@@ -186,15 +412,33 @@ private:
     std::vector<VkBuffer>           m_uniformBuffers;
     std::vector<VkDeviceMemory>     m_uniformBuffersMemory;
 
+    // << Instance Buffers >> per swapchain image, persistently mapped
+    std::vector<VkBuffer>           m_instanceBuffers;
+    std::vector<VkDeviceMemory>     m_instanceBuffersMemory;
+    std::vector<glm::mat4*>         m_instanceBuffersMapped;
+
+    // << Transient Buffer >> data written every frame, see TransientBuffer.h
+    TransientBuffer                 m_transientBuffer;
+    VkBuffer                        m_transientVkBuffer;
+    VkDeviceMemory                  m_transientBufferMemory;  // persistently mapped
+
     // << Command Buffers >>
     VkCommandPool                   m_commandPool;
+    std::mutex                      m_singleTimeCommandsMutex;  // guards m_commandPool & m_graphicsQueue for uploads
     std::vector<VkCommandBuffer>    m_commandBuffers;
+    uint32_t                        m_recordingImageIndex;      // swapchain image of the command buffer being recorded
+    uint32_t                        m_recordingFrameIndex;      // frame in flight slot of the command buffer being recorded
 
     // << Rendering & Presentation >>
-    uint32_t                        m_curretFrameIndex;
+    uint32_t                        m_maxFramesInFlight;
     bool                            m_frameBufferResized;
     std::vector<VkSemaphore>        m_imageAvailableSemaphores;
     std::vector<VkSemaphore>        m_renderFinishedSemaphores;
-    std::vector<VkFence>            m_inFlightFences;
-    std::vector<VkFence>            m_imagesInFlight;
+    std::vector<LinearArena>        m_frameArenas;          // per frame in flight, transient CPU data (see LinearArena.h)
+
+    // << Frame Timeline >>
+    VkSemaphore                     m_frameTimeline;        // signaled with the frame number on completion
+    uint64_t                        m_frameCounter;         // number of the last submitted frame
+    std::atomic<uint64_t>           m_completedFrame;       // cached, last known completed frame
+    std::vector<uint64_t>           m_imageFrameNumbers;    // last frame that rendered to each swapchain image
 };
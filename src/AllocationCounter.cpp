@@ -0,0 +1,151 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+// malloc, calloc and realloc are counted too where they can be replaced:
+// glibc's are also exported as __libc_*, so ours forward to them. Not
+// under the sanitizers, which replace them already.
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#   define ALLOCATION_COUNTER_SANITIZED
+#elif defined(__has_feature)
+#   if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#       define ALLOCATION_COUNTER_SANITIZED
+#   endif
+#endif
+#if defined(__GLIBC__) && !defined(ALLOCATION_COUNTER_SANITIZED)
+#   define COUNT_MALLOC
+#endif
+
+// trivial type, no thread_local initialization guard on the allocation path
+static thread_local uint64_t t_allocationCount = 0;
+
+#if defined(COUNT_MALLOC)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+#   define RAW_MALLOC   __libc_malloc   // operator new counts on its own
+#else
+#   define RAW_MALLOC   malloc
+#endif
+
+uint64_t AllocationCounter::getThreadAllocationCount()
+{
+    return t_allocationCount;
+}
+
+
+// -----------------------<<  Global operator new  >>------------------------
+//
+//  All the forms are replaced, the array and nothrow ones forward to the
+//  plain ones (which is what the standard library does, but not all of
+//  them, e.g. the sanitizers).
+//
+// --------------------------------------------------------------------------
+
+void* operator new(size_t size)
+{
+    t_allocationCount++;
+
+    void* pointer = RAW_MALLOC(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    t_allocationCount++;
+
+#if defined(_MSC_VER)
+    void* pointer = _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment));
+#else
+    // the size must be a multiple of the alignment
+    const size_t align = static_cast<size_t>(alignment);
+    void* pointer = aligned_alloc(align, size ? (size + align - 1) / align * align : align);
+#endif
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+#if defined(_MSC_VER)
+    _aligned_free(pointer);
+#else
+    free(pointer);
+#endif
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
+
+void* operator new[](size_t size)                                   { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t alignment)       { return operator new(size, alignment); }
+void operator delete[](void* pointer) noexcept                      { operator delete(pointer); }
+void operator delete[](void* pointer, size_t) noexcept              { operator delete(pointer); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept          { operator delete(pointer, alignment); }
+void operator delete[](void* pointer, size_t, std::align_val_t alignment) noexcept  { operator delete(pointer, alignment); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try { return operator new(size); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try { return operator new(size, alignment); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept                               { return operator new(size, nothrow); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t& nothrow) noexcept   { return operator new(size, alignment, nothrow); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept                                     { operator delete(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept         { operator delete(pointer, alignment); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept                                   { operator delete(pointer); }
+void operator delete[](void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept       { operator delete(pointer, alignment); }
+
+
+// ------------------------------<<  malloc  >>------------------------------
+//
+//  The C allocations (GLFW, the Vulkan loader, stb...) resolve to these
+//  in every library of the process. free() doesn't need replacing, the
+//  memory comes from glibc's allocator either way. The aligned forms
+//  (aligned_alloc, posix_memalign) are not counted.
+//
+// --------------------------------------------------------------------------
+
+#if defined(COUNT_MALLOC)
+extern "C" void* malloc(size_t size) noexcept
+{
+    t_allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+    t_allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) noexcept
+{
+    t_allocationCount++;
+    return __libc_realloc(pointer, size);
+}
+#endif  // defined(COUNT_MALLOC)
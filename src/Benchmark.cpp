@@ -0,0 +1,95 @@
+#include "Benchmark.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+
+// -------------------------------<< Runner >>---------------------------------
+
+static uint64_t timeIterations(const BenchmarkRunner::Function& function, uint64_t iterations)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    function(iterations);
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count());
+}
+
+static double getMedian(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
+
+void BenchmarkRunner::add(const std::string& name, Function function)
+{
+    m_cases.push_back(Case{ name, std::move(function) });
+}
+
+std::vector<BenchmarkResult> BenchmarkRunner::run(const std::string& filter) const
+{
+    std::vector<BenchmarkResult> results;
+
+    PRINT_BAR_LINE();
+    PRINTLN(std::left << std::setw(40) << "Benchmark" << std::right << std::setw(14) << "median ns"
+            << std::setw(14) << "min ns" << std::setw(10) << "+/- %" << std::setw(12) << "iterations");
+    PRINT_BAR_DOTS();
+    for (const Case& benchmark : m_cases)
+    {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+            continue;
+
+        const BenchmarkResult result = measure(benchmark);
+        PRINTLN(std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(1)
+                << std::setw(14) << result.medianNs << std::setw(14) << result.minNs
+                << std::setw(10) << 100.0 * result.deviationNs / result.medianNs
+                << std::setw(12) << result.iterations << std::defaultfloat);
+        results.push_back(result);
+    }
+    PRINT_BAR_LINE();
+
+    return results;
+}
+
+BenchmarkResult BenchmarkRunner::measure(const Case& benchmark)
+{
+    // 1. calibration, doubles as the warm up
+    uint64_t iterations = 1;
+    while (timeIterations(benchmark.function, iterations) < BENCHMARK_MIN_SAMPLE_NS)
+        iterations *= 2;
+
+    // 2. samples
+    std::vector<double> samples(BENCHMARK_SAMPLES);
+    for (double& sample : samples)
+        sample = static_cast<double>(timeIterations(benchmark.function, iterations)) / iterations;
+
+    BenchmarkResult result;
+    result.name         = benchmark.name;
+    result.iterations   = iterations;
+    result.medianNs     = getMedian(samples);
+    result.minNs        = *std::min_element(samples.begin(), samples.end());
+
+    std::vector<double> deviations(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+        deviations[i] = std::abs(samples[i] - result.medianNs);
+    result.deviationNs  = getMedian(deviations);
+
+    return result;
+}
+
+bool BenchmarkRunner::writeCsv(const std::string& path, const std::vector<BenchmarkResult>& results)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    file << "name,median_ns,min_ns,deviation_ns,iterations\n";
+    for (const BenchmarkResult& result : results)
+        file << result.name << ',' << result.medianNs << ',' << result.minNs << ','
+             << result.deviationNs << ',' << result.iterations << '\n';
+    return true;
+}
@@ -0,0 +1,355 @@
+#include "Benchmark.h"
+#include "Common.h"
+#include "DrawSort.h"
+#include "JobSystem.h"
+#include "ShaderCompiler.h"
+#include "ShaderTypes.h"
+#include "SpriteBatch.h"
+#include "TransformSystem.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+
+// the same paths as the app, run from the build directory too
+#define BENCHMARK_SHADER_DIR        "../src/shaders/"
+#define BENCHMARK_SHADER_CACHE_DIR  "shader_cache/"
+#define BENCHMARK_IMAGE_DIR         "../src/images/"
+
+#define BENCHMARK_SEED              1234    // the generated data is the same on every run
+
+
+// -------------------------------<< Camera >>---------------------------------
+
+static void addCameraBenchmarks(BenchmarkRunner& runner)
+{
+    // updateUniformBuffer()
+    runner.add("camera/makeCamera", [](uint64_t iterations) {
+        float aspectRatio = 800.0f / 600.0f;
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            doNotOptimize(aspectRatio);
+            UniformBufferObject ubo = UniformBufferObject::makeCamera(aspectRatio);
+            doNotOptimize(ubo);
+        }
+    });
+
+    // the scene rotation, propagated to the children of the root. The
+    // largest on the calling thread, then split over the workers
+    auto jobSystem = std::make_shared<JobSystem>();
+    for (uint32_t nodeCount : { 2u, 1024u, 300000u })
+    {
+        auto transforms = std::make_shared<TransformSystem>();
+        transforms->reserve(nodeCount);
+        const TransformHandle root = transforms->create();
+        for (uint32_t i = 1; i < nodeCount; ++i)
+        {
+            const TransformHandle node = transforms->create(root);
+            transforms->setPosition(node, glm::vec3(i % 32, i / 32, 0.0f) * 0.1f);
+        }
+        transforms->update();
+
+        const auto rotateRoot = [transforms, root](JobSystem* jobSystem, uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                transforms->setRotation(root, glm::angleAxis(i * 0.001f, glm::vec3(0.0f, 0.0f, 1.0f)));
+                transforms->update(jobSystem);
+                doNotOptimize(transforms->getWorldMatrix(root));
+            }
+        };
+
+        const std::string name = "transforms/rotateRoot/" + std::to_string(nodeCount);
+        runner.add(name, [rotateRoot](uint64_t iterations) { rotateRoot(nullptr, iterations); });
+        if (nodeCount >= 300000)
+            runner.add(name + "/jobs", [rotateRoot, jobSystem](uint64_t iterations) { rotateRoot(jobSystem.get(), iterations); });
+    }
+}
+
+
+// -------------------------------<< Vertex >>---------------------------------
+
+static void addVertexBenchmarks(BenchmarkRunner& runner, std::mt19937& random)
+{
+    // separate attribute streams (as they come out of a loader) interleaved
+    // into Vertex, then copied into the staging buffer
+    struct VertexStreams
+    {
+        std::vector<glm::vec3>  positions;
+        std::vector<glm::vec3>  colors;
+        std::vector<glm::vec2>  texCoords;
+        std::vector<Vertex>     vertices;
+        std::vector<uint8_t>    staging;
+    };
+
+    const uint32_t vertexCount = 65536;
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    auto streams = std::make_shared<VertexStreams>();
+    streams->positions.resize(vertexCount);
+    streams->colors.resize(vertexCount);
+    streams->texCoords.resize(vertexCount);
+    streams->vertices.resize(vertexCount);
+    streams->staging.resize(vertexCount * sizeof(Vertex));
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        streams->positions[i]   = glm::vec3(distribution(random), distribution(random), distribution(random));
+        streams->colors[i]      = glm::vec3(distribution(random), distribution(random), distribution(random));
+        streams->texCoords[i]   = glm::vec2(distribution(random), distribution(random));
+    }
+
+    runner.add("vertex/pack/" + std::to_string(vertexCount), [streams](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            const size_t count = streams->vertices.size();
+            for (size_t v = 0; v < count; ++v)
+                streams->vertices[v] = Vertex{ streams->positions[v], streams->colors[v], streams->texCoords[v] };
+            memcpy(streams->staging.data(), streams->vertices.data(), streams->staging.size());
+            doNotOptimize(streams->staging.data());
+        }
+    });
+}
+
+
+// -------------------------------<< Files >>----------------------------------
+
+static void addShaderBenchmarks(BenchmarkRunner& runner)
+{
+    // the shader load of createGraphicsPipeline(), on a cache hit: reads and
+    // hashes the source, then reads the cached SPIR-V
+    auto shaderCompiler = std::make_shared<ShaderCompiler>(BENCHMARK_SHADER_DIR, BENCHMARK_SHADER_CACHE_DIR);
+    for (const char* shaderName : { "shader.vert", "shader.frag" })
+    {
+        try
+        {
+            shaderCompiler->loadSpirv(shaderName);  // fills the cache
+        }
+        catch (const std::exception& e)
+        {
+            PRINTLN("Benchmark) skipped shader/loadSpirv/" << shaderName << " - " << e.what());
+            continue;
+        }
+
+        const std::string name = shaderName;
+        runner.add("shader/loadSpirv/" + name, [shaderCompiler, name](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                std::vector<char> spirv = shaderCompiler->loadSpirv(name);
+                doNotOptimize(spirv.data());
+            }
+        });
+    }
+}
+
+static void addImageBenchmarks(BenchmarkRunner& runner)
+{
+    std::error_code error;
+    std::vector<std::filesystem::path> imagePaths;
+    for (const auto& entry : std::filesystem::directory_iterator(BENCHMARK_IMAGE_DIR, error))
+    {
+        const std::string extension = entry.path().extension().string();
+        if (extension == ".jpg" || extension == ".png")
+            imagePaths.push_back(entry.path());
+    }
+    if (imagePaths.empty())
+        PRINTLN("Benchmark) skipped image/ - no images in " << BENCHMARK_IMAGE_DIR);
+    std::sort(imagePaths.begin(), imagePaths.end());
+
+    for (const std::filesystem::path& imagePath : imagePaths)
+    {
+        // the file is read once, so the decode can be measured without the IO
+        std::ifstream file(imagePath, std::ios::binary);
+        auto bytes = std::make_shared<std::vector<stbi_uc>>(std::istreambuf_iterator<char>(file),
+                                                            std::istreambuf_iterator<char>());
+        int width, height, channels;
+        if (!stbi_info_from_memory(bytes->data(), static_cast<int>(bytes->size()), &width, &height, &channels))
+        {
+            PRINTLN("Benchmark) skipped " << imagePath.string() << " - " << stbi_failure_reason());
+            continue;
+        }
+
+        // createTextureImage()
+        const std::string path = imagePath.string();
+        const std::string fileName = imagePath.filename().string();
+        runner.add("image/stbi_load/" + fileName, [path](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                int imgWidth, imgHeight, imgChannels;
+                stbi_uc* pixels = stbi_load(path.c_str(), &imgWidth, &imgHeight, &imgChannels, STBI_rgb_alpha);
+                doNotOptimize(pixels);
+                stbi_image_free(pixels);
+            }
+        });
+        runner.add("image/decode/" + fileName, [bytes](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                int imgWidth, imgHeight, imgChannels;
+                stbi_uc* pixels = stbi_load_from_memory(bytes->data(), static_cast<int>(bytes->size()),
+                                                        &imgWidth, &imgHeight, &imgChannels, STBI_rgb_alpha);
+                doNotOptimize(pixels);
+                stbi_image_free(pixels);
+            }
+        });
+    }
+}
+
+
+// -------------------------------<< Draws >>----------------------------------
+
+static void addDrawBenchmarks(BenchmarkRunner& runner, std::mt19937& random)
+{
+    struct DrawLists
+    {
+        std::vector<DrawKeyFields>  fields;
+        std::vector<float>          depths;
+        std::vector<SortedDraw>     unsorted;
+        std::vector<SortedDraw>     draws;
+        std::vector<SortedDraw>     scratch;
+    };
+
+    std::uniform_int_distribution<uint32_t> pipelineDistribution(0, 7);
+    std::uniform_int_distribution<uint32_t> materialDistribution(0, 255);
+    std::uniform_int_distribution<uint32_t> meshDistribution(0, 63);
+    std::uniform_real_distribution<float>   depthDistribution(0.0f, 1.0f);
+
+    for (uint32_t drawCount : { 1024u, 65536u })
+    {
+        auto lists = std::make_shared<DrawLists>();
+        lists->fields.resize(drawCount);
+        lists->depths.resize(drawCount);
+        lists->unsorted.resize(drawCount);
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            DrawKeyFields& fields = lists->fields[i];
+            fields.pass         = 0;
+            fields.pipeline     = pipelineDistribution(random);
+            fields.material     = materialDistribution(random);
+            fields.mesh         = meshDistribution(random);
+            lists->depths[i]    = depthDistribution(random);
+            lists->unsorted[i]  = SortedDraw{ makeDrawKey(fields.pass, fields.pipeline, fields.material, fields.mesh,
+                                                          lists->depths[i]), i };
+        }
+        lists->draws.reserve(drawCount);
+        lists->scratch.reserve(drawCount);
+
+        const std::string count = std::to_string(drawCount);
+        runner.add("drawSort/makeDrawKey/" + count, [lists](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                const size_t drawCount = lists->fields.size();
+                for (size_t d = 0; d < drawCount; ++d)
+                {
+                    const DrawKeyFields& fields = lists->fields[d];
+                    lists->unsorted[d].key = makeDrawKey(fields.pass, fields.pipeline, fields.material, fields.mesh,
+                                                         lists->depths[d]);
+                }
+                doNotOptimize(lists->unsorted.data());
+            }
+        });
+        // the copy is part of it, the sort of a sorted list would skip work
+        runner.add("drawSort/radixSort/" + count, [lists](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                lists->draws = lists->unsorted;
+                radixSortDraws(lists->draws, lists->scratch);
+                doNotOptimize(lists->draws.data());
+            }
+        });
+    }
+}
+
+static void addSpriteBenchmarks(BenchmarkRunner& runner, std::mt19937& random)
+{
+    struct SpriteFrame
+    {
+        std::vector<SpriteRect>     rects;
+        std::vector<SpriteTexture>  textures;
+        SpriteBatch                 sprites;
+        std::vector<SpriteVertex>   vertices;
+        std::vector<SpriteDraw>     draws;
+    };
+
+    const uint32_t spriteCount = 10000;
+    std::uniform_real_distribution<float>       positionDistribution(0.0f, 800.0f);
+    std::uniform_int_distribution<SpriteTexture> textureDistribution(0, 3);
+
+    auto frame = std::make_shared<SpriteFrame>();
+    frame->rects.resize(spriteCount);
+    frame->textures.resize(spriteCount);
+    frame->vertices.resize(spriteCount * 4);
+    for (uint32_t i = 0; i < spriteCount; ++i)
+    {
+        frame->rects[i]     = SpriteRect{ positionDistribution(random), positionDistribution(random), 16.0f, 16.0f };
+        frame->textures[i]  = textureDistribution(random);
+    }
+
+    // a frame of submitStressSprites() (MyApp.cpp)
+    runner.add("sprites/submitFlush/" + std::to_string(spriteCount), [frame](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            const uint32_t count = static_cast<uint32_t>(frame->rects.size());
+            for (uint32_t s = 0; s < count; ++s)
+                frame->sprites.submit(frame->textures[s], frame->rects[s], { 0.0f, 0.0f, 1.0f, 1.0f },
+                                      SPRITE_COLOR_WHITE, s / static_cast<float>(count));
+            frame->sprites.flush(frame->vertices.data(), count, frame->draws);
+            doNotOptimize(frame->vertices.data());
+        }
+    });
+}
+
+
+//----------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    // Hello_Vulkan_bench [filter] [--csv <path>]
+    std::string filter;
+    std::string csvPath;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+            csvPath = argv[++i];
+        else if (argv[i][0] != '-' && filter.empty())
+            filter = argv[i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [filter] [--csv <path>]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937 random(BENCHMARK_SEED);
+
+    BenchmarkRunner runner;
+    addCameraBenchmarks(runner);
+    addVertexBenchmarks(runner, random);
+    addShaderBenchmarks(runner);
+    addImageBenchmarks(runner);
+    addDrawBenchmarks(runner, random);
+    addSpriteBenchmarks(runner, random);
+
+    const std::vector<BenchmarkResult> results = runner.run(filter);
+    if (results.empty())
+    {
+        std::cerr << "no benchmark matching \"" << filter << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!csvPath.empty())
+    {
+        if (!BenchmarkRunner::writeCsv(csvPath, results))
+        {
+            std::cerr << "failed to write " << csvPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        PRINTLN("Benchmark) results written to " << csvPath);
+    }
+
+    return EXIT_SUCCESS;
+}
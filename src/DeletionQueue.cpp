@@ -0,0 +1,179 @@
+#include "DeletionQueue.h"
+#include "MemoryTracker.h"
+#include "HostAllocator.h"
+
+// entries are reserved up front, releasing a resource doesn't allocate
+// in the common case
+#define DELETION_QUEUE_INITIAL_CAPACITY 256
+
+
+// -------------------------<<  Deletion Queue  >>---------------------------
+
+DeletionQueue::DeletionQueue() :
+    m_device(VK_NULL_HANDLE),
+    m_memoryTracker(nullptr)
+{
+}
+
+void DeletionQueue::init(VkDevice device, MemoryTracker* memoryTracker)
+{
+    m_device        = device;
+    m_memoryTracker = memoryTracker;
+    m_entries.reserve(DELETION_QUEUE_INITIAL_CAPACITY);
+}
+
+void DeletionQueue::releaseBuffer(uint64_t frameNumber, VkBuffer buffer, VkDeviceMemory memory)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::Buffer;
+    entry.buffer.buffer = buffer;
+    entry.buffer.memory = memory;
+    push(entry);
+}
+
+void DeletionQueue::releaseImage(uint64_t frameNumber, VkImage image, VkDeviceMemory memory)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::Image;
+    entry.image.image   = image;
+    entry.image.memory  = memory;
+    push(entry);
+}
+
+void DeletionQueue::releaseImageView(uint64_t frameNumber, VkImageView imageView)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::ImageView;
+    entry.imageView     = imageView;
+    push(entry);
+}
+
+void DeletionQueue::releaseFramebuffer(uint64_t frameNumber, VkFramebuffer framebuffer)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::Framebuffer;
+    entry.framebuffer   = framebuffer;
+    push(entry);
+}
+
+void DeletionQueue::releasePipeline(uint64_t frameNumber, VkPipeline pipeline)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::Pipeline;
+    entry.pipeline      = pipeline;
+    push(entry);
+}
+
+void DeletionQueue::releaseCommandBuffer(uint64_t frameNumber, VkCommandPool commandPool, VkCommandBuffer commandBuffer)
+{
+    Entry entry{};
+    entry.frameNumber                   = frameNumber;
+    entry.type                          = ResourceType::CommandBuffer;
+    entry.commandBuffer.pool            = commandPool;
+    entry.commandBuffer.commandBuffer   = commandBuffer;
+    push(entry);
+}
+
+void DeletionQueue::releaseDescriptorPool(uint64_t frameNumber, VkDescriptorPool descriptorPool)
+{
+    Entry entry{};
+    entry.frameNumber       = frameNumber;
+    entry.type              = ResourceType::DescriptorPool;
+    entry.descriptorPool    = descriptorPool;
+    push(entry);
+}
+
+void DeletionQueue::releaseRenderPass(uint64_t frameNumber, VkRenderPass renderPass)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::RenderPass;
+    entry.renderPass    = renderPass;
+    push(entry);
+}
+
+void DeletionQueue::releaseSwapchain(uint64_t frameNumber, VkSwapchainKHR swapchain)
+{
+    Entry entry{};
+    entry.frameNumber   = frameNumber;
+    entry.type          = ResourceType::Swapchain;
+    entry.swapchain     = swapchain;
+    push(entry);
+}
+
+void DeletionQueue::flush(uint64_t completedFrame)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto end = m_entries.begin();
+    while (end != m_entries.end() && end->frameNumber <= completedFrame)
+    {
+        destroy(*end);
+        ++end;
+    }
+    m_entries.erase(m_entries.begin(), end);    // keeps the capacity
+}
+
+void DeletionQueue::flushAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const auto& entry : m_entries)
+        destroy(entry);
+    m_entries.clear();
+}
+
+void DeletionQueue::push(const Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // released from several threads, the frame numbers may come slightly out
+    // of order. Keep the queue sorted so flush() can stop at the first pending one.
+    auto position = m_entries.end();
+    while (position != m_entries.begin() && (position - 1)->frameNumber > entry.frameNumber)
+        --position;
+    m_entries.insert(position, entry);
+}
+
+void DeletionQueue::destroy(const Entry& entry)
+{
+    switch (entry.type)
+    {
+    case ResourceType::Buffer:
+        vkDestroyBuffer(m_device, entry.buffer.buffer, HostAllocator::getCallbacks());
+        m_memoryTracker->free(m_device, entry.buffer.memory);
+        break;
+    case ResourceType::Image:
+        vkDestroyImage(m_device, entry.image.image, HostAllocator::getCallbacks());
+        m_memoryTracker->free(m_device, entry.image.memory);
+        break;
+    case ResourceType::ImageView:
+        vkDestroyImageView(m_device, entry.imageView, HostAllocator::getCallbacks());
+        break;
+    case ResourceType::Framebuffer:
+        vkDestroyFramebuffer(m_device, entry.framebuffer, HostAllocator::getCallbacks());
+        break;
+    case ResourceType::Pipeline:
+        vkDestroyPipeline(m_device, entry.pipeline, HostAllocator::getCallbacks());
+        break;
+    case ResourceType::CommandBuffer:
+        vkFreeCommandBuffers(m_device, entry.commandBuffer.pool, 1, &entry.commandBuffer.commandBuffer);
+        break;
+    case ResourceType::DescriptorPool:
+        // the descriptor sets allocated from it are freed along
+        vkDestroyDescriptorPool(m_device, entry.descriptorPool, HostAllocator::getCallbacks());
+        break;
+    case ResourceType::RenderPass:
+        vkDestroyRenderPass(m_device, entry.renderPass, HostAllocator::getCallbacks());
+        break;
+    case ResourceType::Swapchain:
+        // a retired swapchain: its last presents went out with the frame
+        vkDestroySwapchainKHR(m_device, entry.swapchain, HostAllocator::getCallbacks());
+        break;
+    }
+}
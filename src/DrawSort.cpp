@@ -0,0 +1,101 @@
+#include "DrawSort.h"
+
+#include <cstring>
+#include <utility>
+
+#define DRAW_KEY_MESH_SHIFT         DRAW_KEY_DEPTH_BITS
+#define DRAW_KEY_MATERIAL_SHIFT     (DRAW_KEY_MESH_SHIFT + DRAW_KEY_MESH_BITS)
+#define DRAW_KEY_PIPELINE_SHIFT     (DRAW_KEY_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS)
+#define DRAW_KEY_PASS_SHIFT         (DRAW_KEY_PIPELINE_SHIFT + DRAW_KEY_PIPELINE_BITS)
+
+#define DRAW_KEY_MASK(_bits)        ((uint64_t(1) << (_bits)) - 1)
+
+// 8 passes of a byte each, the histograms fit in L1
+#define RADIX_BITS                  8
+#define RADIX_SIZE                  (1 << RADIX_BITS)
+#define RADIX_PASSES                (64 / RADIX_BITS)
+
+static_assert(DRAW_KEY_PASS_SHIFT + DRAW_KEY_PASS_BITS == 64, "draw key fields must fill the 64 bits");
+
+
+// ---------------------------<<  Draw Keys  >>------------------------------
+
+static uint32_t quantizeDepth(float viewDepth)
+{
+    // The bits of a positive float sort the same way as its value, the top
+    // ones (exponent and the high mantissa) give a depth with a constant
+    // relative precision, without knowing the depth range.
+    if (!(viewDepth > 0.0f))    // behind the camera, or NaN
+        return 0;
+
+    uint32_t bits;
+    memcpy(&bits, &viewDepth, sizeof(bits));
+    return bits >> (32 - DRAW_KEY_DEPTH_BITS);
+}
+
+uint64_t makeDrawKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDepth)
+{
+    return ((pass       & DRAW_KEY_MASK(DRAW_KEY_PASS_BITS))        << DRAW_KEY_PASS_SHIFT)
+         | ((pipeline   & DRAW_KEY_MASK(DRAW_KEY_PIPELINE_BITS))    << DRAW_KEY_PIPELINE_SHIFT)
+         | ((material   & DRAW_KEY_MASK(DRAW_KEY_MATERIAL_BITS))    << DRAW_KEY_MATERIAL_SHIFT)
+         | ((mesh       & DRAW_KEY_MASK(DRAW_KEY_MESH_BITS))        << DRAW_KEY_MESH_SHIFT)
+         | (quantizeDepth(viewDepth) & DRAW_KEY_MASK(DRAW_KEY_DEPTH_BITS));
+}
+
+DrawKeyFields getDrawKeyFields(uint64_t key)
+{
+    DrawKeyFields fields;
+    fields.pass     = static_cast<uint32_t>((key >> DRAW_KEY_PASS_SHIFT)     & DRAW_KEY_MASK(DRAW_KEY_PASS_BITS));
+    fields.pipeline = static_cast<uint32_t>((key >> DRAW_KEY_PIPELINE_SHIFT) & DRAW_KEY_MASK(DRAW_KEY_PIPELINE_BITS));
+    fields.material = static_cast<uint32_t>((key >> DRAW_KEY_MATERIAL_SHIFT) & DRAW_KEY_MASK(DRAW_KEY_MATERIAL_BITS));
+    fields.mesh     = static_cast<uint32_t>((key >> DRAW_KEY_MESH_SHIFT)     & DRAW_KEY_MASK(DRAW_KEY_MESH_BITS));
+    return fields;
+}
+
+
+// ---------------------------<<  Radix Sort  >>-----------------------------
+
+SortedDraw* radixSortDraws(SortedDraw* draws, SortedDraw* scratch, size_t count)
+{
+    if (count < 2)
+        return draws;
+
+    // all the histograms in a single read of the keys
+    uint32_t histograms[RADIX_PASSES][RADIX_SIZE] = {};
+    for (size_t i = 0; i < count; i++)
+    {
+        const SortedDraw& draw = draws[i];
+        for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+            histograms[pass][(draw.key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+    }
+
+    SortedDraw* src = draws;
+    SortedDraw* dst = scratch;
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        uint32_t* histogram = histograms[pass];
+        const uint32_t shift = pass * RADIX_BITS;
+
+        // every key has the same byte: already in order
+        if (histogram[(src[0].key >> shift) & (RADIX_SIZE - 1)] == count)
+            continue;
+
+        // counts to offsets
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; digit++)
+        {
+            const uint32_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        // scatter, in order within each digit (stable)
+        for (size_t i = 0; i < count; i++)
+            dst[histogram[(src[i].key >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+
+        std::swap(src, dst);
+    }
+
+    // the result is in the scratch after an odd number of scatters
+    return src;
+}
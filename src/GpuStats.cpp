@@ -0,0 +1,215 @@
+#include "GpuStats.h"
+#include "Common.h"
+#include "HostAllocator.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+// the counters, written in the order of their bits
+#define PIPELINE_STATISTICS_FLAGS   (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |      \
+                                     VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |    \
+                                     VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |    \
+                                     VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |         \
+                                     VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |          \
+                                     VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+#define PIPELINE_STATISTICS_COUNT   6
+
+static_assert(sizeof(PipelineStatistics) == sizeof(uint64_t) * PIPELINE_STATISTICS_COUNT, "one field per counter");
+
+
+// ------------------------------<<  GPU Stats  >>-----------------------------
+
+GpuStats::GpuStats() :
+    m_device(VK_NULL_HANDLE),
+    m_statisticsPool(VK_NULL_HANDLE),
+    m_occlusionPool(VK_NULL_HANDLE),
+    m_occlusionFlags(0),
+    m_recordingFrame(0),
+    m_isPassActive(false),
+    m_isOcclusionActive(false),
+    m_latestStats{},
+    m_collectedStats{}
+{
+}
+
+void GpuStats::init(VkDevice device, uint32_t framesInFlight, bool isPipelineStatisticsEnabled,
+                    bool isOcclusionEnabled, bool isOcclusionPrecise)
+{
+    m_device = device;
+    m_frames.assign(framesInFlight, FrameQueries{});
+
+    if (isPipelineStatisticsEnabled)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType             = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount            = GPU_STATS_MAX_PASSES * framesInFlight;
+        queryPoolInfo.pipelineStatistics    = PIPELINE_STATISTICS_FLAGS;
+        if (vkCreateQueryPool(m_device, &queryPoolInfo, HostAllocator::getCallbacks(), &m_statisticsPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+    }
+
+    if (isOcclusionEnabled)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType         = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType     = VK_QUERY_TYPE_OCCLUSION;
+        queryPoolInfo.queryCount    = GPU_STATS_MAX_OCCLUSION_GROUPS * framesInFlight;
+        if (vkCreateQueryPool(m_device, &queryPoolInfo, HostAllocator::getCallbacks(), &m_occlusionPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create occlusion query pool!");
+        m_occlusionFlags = isOcclusionPrecise ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+    }
+}
+
+void GpuStats::clean()
+{
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyQueryPool(m_device, m_statisticsPool, HostAllocator::getCallbacks());
+    vkDestroyQueryPool(m_device, m_occlusionPool, HostAllocator::getCallbacks());
+    m_statisticsPool    = VK_NULL_HANDLE;
+    m_occlusionPool     = VK_NULL_HANDLE;
+    m_frames.clear();
+}
+
+void GpuStats::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber)
+{
+    // the previous results of the slot must have been collected
+    m_recordingFrame = frameIndex;
+    FrameQueries& frame = m_frames[frameIndex];
+    frame.frameNumber = frameNumber;
+    frame.passNames.clear();
+    frame.occlusionNames.clear();
+
+    if (m_statisticsPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(commandBuffer, m_statisticsPool, frameIndex * GPU_STATS_MAX_PASSES, GPU_STATS_MAX_PASSES);
+    if (m_occlusionPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(commandBuffer, m_occlusionPool, frameIndex * GPU_STATS_MAX_OCCLUSION_GROUPS, GPU_STATS_MAX_OCCLUSION_GROUPS);
+}
+
+void GpuStats::beginPass(VkCommandBuffer commandBuffer, const char* name)
+{
+    FrameQueries& frame = m_frames[m_recordingFrame];
+    if (m_statisticsPool == VK_NULL_HANDLE || frame.passNames.size() == GPU_STATS_MAX_PASSES)
+        return;
+
+    const uint32_t query = m_recordingFrame * GPU_STATS_MAX_PASSES + static_cast<uint32_t>(frame.passNames.size());
+    vkCmdBeginQuery(commandBuffer, m_statisticsPool, query, 0);
+    frame.passNames.push_back(name);
+    m_isPassActive = true;
+}
+
+void GpuStats::endPass(VkCommandBuffer commandBuffer)
+{
+    if (!m_isPassActive)
+        return;
+
+    const FrameQueries& frame = m_frames[m_recordingFrame];
+    const uint32_t query = m_recordingFrame * GPU_STATS_MAX_PASSES + static_cast<uint32_t>(frame.passNames.size()) - 1;
+    vkCmdEndQuery(commandBuffer, m_statisticsPool, query);
+    m_isPassActive = false;
+}
+
+void GpuStats::beginOcclusion(VkCommandBuffer commandBuffer, const char* name)
+{
+    FrameQueries& frame = m_frames[m_recordingFrame];
+    if (m_occlusionPool == VK_NULL_HANDLE || frame.occlusionNames.size() == GPU_STATS_MAX_OCCLUSION_GROUPS)
+        return;
+
+    const uint32_t query = m_recordingFrame * GPU_STATS_MAX_OCCLUSION_GROUPS + static_cast<uint32_t>(frame.occlusionNames.size());
+    vkCmdBeginQuery(commandBuffer, m_occlusionPool, query, m_occlusionFlags);
+    frame.occlusionNames.push_back(name);
+    m_isOcclusionActive = true;
+}
+
+void GpuStats::endOcclusion(VkCommandBuffer commandBuffer)
+{
+    if (!m_isOcclusionActive)
+        return;
+
+    const FrameQueries& frame = m_frames[m_recordingFrame];
+    const uint32_t query = m_recordingFrame * GPU_STATS_MAX_OCCLUSION_GROUPS + static_cast<uint32_t>(frame.occlusionNames.size()) - 1;
+    vkCmdEndQuery(commandBuffer, m_occlusionPool, query);
+    m_isOcclusionActive = false;
+}
+
+void GpuStats::collect(uint32_t frameIndex)
+{
+    if (frameIndex >= m_frames.size())
+        return;
+
+    FrameQueries& frame = m_frames[frameIndex];
+    if (frame.frameNumber == 0)
+        return;
+
+    // The frame is complete, the results are available: no WAIT_BIT. A
+    // query that is still not (i.e. the frame was never submitted) makes
+    // the call return VK_NOT_READY, the frame is skipped then.
+    // The two stats are swapped, they keep their storage: no allocation per frame.
+    GpuFrameStats& stats = m_collectedStats;
+    stats.frameNumber = frame.frameNumber;
+    stats.passes.clear();
+    stats.occlusionGroups.clear();
+
+    const uint32_t n_passes = static_cast<uint32_t>(frame.passNames.size());
+    if (n_passes > 0)
+    {
+        m_results.resize(n_passes * PIPELINE_STATISTICS_COUNT);
+        if (vkGetQueryPoolResults(m_device, m_statisticsPool, frameIndex * GPU_STATS_MAX_PASSES, n_passes,
+                                  m_results.size() * sizeof(uint64_t), m_results.data(),
+                                  PIPELINE_STATISTICS_COUNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+            stats.frameNumber = 0;
+
+        for (uint32_t i = 0; i < n_passes && stats.frameNumber != 0; ++i)
+        {
+            const uint64_t* counters = &m_results[i * PIPELINE_STATISTICS_COUNT];
+            stats.passes.push_back(GpuPassStats{ frame.passNames[i],
+                PipelineStatistics{ counters[0], counters[1], counters[2], counters[3], counters[4], counters[5] } });
+        }
+    }
+
+    const uint32_t n_groups = static_cast<uint32_t>(frame.occlusionNames.size());
+    if (n_groups > 0 && stats.frameNumber != 0)
+    {
+        m_results.resize(n_groups);
+        if (vkGetQueryPoolResults(m_device, m_occlusionPool, frameIndex * GPU_STATS_MAX_OCCLUSION_GROUPS, n_groups,
+                                  m_results.size() * sizeof(uint64_t), m_results.data(),
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+            stats.frameNumber = 0;
+
+        for (uint32_t i = 0; i < n_groups && stats.frameNumber != 0; ++i)
+            stats.occlusionGroups.push_back(GpuOcclusionStats{ frame.occlusionNames[i], m_results[i] });
+    }
+
+    frame.frameNumber = 0;
+    if (stats.frameNumber != 0)
+        std::swap(m_latestStats, stats);
+}
+
+void GpuStats::printReport(uint64_t pixelCount) const
+{
+    PRINT_BAR_LINE();
+    PRINTLN("GPU stats (frame " << m_latestStats.frameNumber << ")");
+    PRINT_BAR_DOTS();
+    if (m_statisticsPool == VK_NULL_HANDLE)
+        PRINTLN("pipeline statistics not supported");
+    PRINT(std::fixed << std::setprecision(2));
+    for (const GpuPassStats& pass : m_latestStats.passes)
+    {
+        const PipelineStatistics& statistics = pass.statistics;
+        PRINTLN(std::left << std::setw(12) << pass.name << std::right
+                << " vertices " << std::setw(10) << statistics.inputAssemblyVertices
+                << "   VS " << std::setw(10) << statistics.vertexShaderInvocations
+                << "   primitives " << std::setw(10) << statistics.clippingInvocations
+                << " -> " << std::setw(10) << statistics.clippingPrimitives
+                << "   FS " << std::setw(12) << statistics.fragmentShaderInvocations);
+        if (pixelCount > 0)
+            PRINTLN(std::setw(12) << "" << " overdraw " << double(statistics.fragmentShaderInvocations) / pixelCount
+                    << " fragments per pixel");
+    }
+    for (const GpuOcclusionStats& group : m_latestStats.occlusionGroups)
+        PRINTLN(std::left << std::setw(12) << group.name << std::right << " samples passed " << group.samplesPassed);
+    PRINT(std::defaultfloat);
+    PRINT_BAR_LINE();
+}
@@ -0,0 +1,305 @@
+#include "HostAllocator.h"
+#include "Common.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+
+#define BYTES_TO_KB(_bytes)     ((_bytes) / 1024.0)
+
+#define SCOPE_COUNT             (VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1)
+
+
+namespace
+{
+
+struct CommandArena
+{
+    std::unique_ptr<uint8_t[]>  memory;         // HOST_COMMAND_ARENA_SIZE, on first use
+    size_t                      offset = 0;     // only touched by the owning thread
+    std::atomic<uint32_t>       liveCount{ 0 }; // freed from any thread
+};
+
+// right before every allocation
+struct AllocationHeader
+{
+    void*                   block;      // what was malloc'd, nullptr: from arena
+    CommandArena*           arena;
+    size_t                  size;
+    VkSystemAllocationScope scope;
+};
+
+struct ScopeCounters
+{
+    std::atomic<uint64_t>   allocationCount{ 0 };
+    std::atomic<uint64_t>   arenaCount{ 0 };
+    std::atomic<uint64_t>   freeCount{ 0 };
+    std::atomic<uint64_t>   liveBytes{ 0 };
+    std::atomic<uint64_t>   peakBytes{ 0 };
+    std::atomic<uint64_t>   totalBytes{ 0 };
+    std::atomic<uint64_t>   internalBytes{ 0 };
+};
+
+std::array<ScopeCounters, SCOPE_COUNT>  s_counters;
+thread_local CommandArena               t_commandArena;
+
+const char* getScopeName(VkSystemAllocationScope scope)
+{
+    switch (scope)
+    {
+    case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:    return "command";
+    case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:     return "object";
+    case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:      return "cache";
+    case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:     return "device";
+    case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:   return "instance";
+    default:                                    return "unknown";
+    }
+}
+
+ScopeCounters& getCounters(VkSystemAllocationScope scope)
+{
+    return s_counters[scope < SCOPE_COUNT ? scope : VK_SYSTEM_ALLOCATION_SCOPE_OBJECT];
+}
+
+AllocationHeader* getHeader(void* pointer)
+{
+    return reinterpret_cast<AllocationHeader*>(pointer) - 1;
+}
+
+uintptr_t alignUp(uintptr_t address, size_t alignment)
+{
+    return (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+}
+
+void recordAllocation(VkSystemAllocationScope scope, size_t size, bool isArena)
+{
+    ScopeCounters& counters = getCounters(scope);
+    counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (isArena)
+        counters.arenaCount.fetch_add(1, std::memory_order_relaxed);
+    counters.totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+    const uint64_t liveBytes = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    while (liveBytes > peakBytes && !counters.peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed))
+        ;
+}
+
+void recordFree(VkSystemAllocationScope scope, size_t size)
+{
+    ScopeCounters& counters = getCounters(scope);
+    counters.freeCount.fetch_add(1, std::memory_order_relaxed);
+    counters.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void* allocateFromArena(size_t size, size_t alignment)
+{
+    CommandArena& arena = t_commandArena;
+    if (!arena.memory)
+        arena.memory.reset(new uint8_t[HOST_COMMAND_ARENA_SIZE]);
+
+    // the previous commands are done with it
+    if (arena.liveCount.load(std::memory_order_acquire) == 0)
+        arena.offset = 0;
+
+    const uintptr_t begin   = reinterpret_cast<uintptr_t>(arena.memory.get());
+    const uintptr_t pointer = alignUp(begin + arena.offset + sizeof(AllocationHeader), alignment);
+    if (pointer + size > begin + HOST_COMMAND_ARENA_SIZE)
+        return nullptr;
+
+    arena.offset = pointer + size - begin;
+    arena.liveCount.fetch_add(1, std::memory_order_relaxed);
+
+    *getHeader(reinterpret_cast<void*>(pointer)) = AllocationHeader{ nullptr, &arena, size, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND };
+    return reinterpret_cast<void*>(pointer);
+}
+
+void* allocateFromHeap(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    void* block = malloc(size + alignment + sizeof(AllocationHeader));
+    if (!block)
+        return nullptr;
+
+    const uintptr_t pointer = alignUp(reinterpret_cast<uintptr_t>(block) + sizeof(AllocationHeader), alignment);
+    *getHeader(reinterpret_cast<void*>(pointer)) = AllocationHeader{ block, nullptr, size, scope };
+    return reinterpret_cast<void*>(pointer);
+}
+
+void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    // the header is right before the allocation, it needs its alignment too
+    alignment = std::max(alignment, alignof(AllocationHeader));
+
+    void* pointer = nullptr;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND)
+        pointer = allocateFromArena(size, alignment);
+    const bool isArena = pointer != nullptr;
+    if (!pointer)
+        pointer = allocateFromHeap(size, alignment, scope);
+
+    if (pointer)
+        recordAllocation(scope, size, isArena);
+    return pointer;
+}
+
+void release(void* pointer)
+{
+    const AllocationHeader header = *getHeader(pointer);
+    recordFree(header.scope, header.size);
+
+    if (header.block)
+        free(header.block);
+    else
+        header.arena->liveCount.fetch_sub(1, std::memory_order_release);
+}
+
+// the last allocation of this thread's arena grows in place
+bool tryGrowInArena(void* pointer, size_t size, size_t alignment)
+{
+    AllocationHeader* header = getHeader(pointer);
+    CommandArena& arena = t_commandArena;
+    if (header->arena != &arena || reinterpret_cast<uintptr_t>(pointer) % alignment != 0)
+        return false;
+
+    const uintptr_t begin   = reinterpret_cast<uintptr_t>(arena.memory.get());
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    if (address + header->size != begin + arena.offset || address + size > begin + HOST_COMMAND_ARENA_SIZE)
+        return false;
+
+    arena.offset = address + size - begin;
+    header->size = size;
+    return true;
+}
+
+// ---------------------------<< Callbacks >>---------------------------
+
+VKAPI_ATTR void* VKAPI_CALL hostAllocation(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+    (void)pUserData;
+    return size ? allocate(size, alignment, scope) : nullptr;
+}
+
+VKAPI_ATTR void* VKAPI_CALL hostReallocation(void* pUserData, void* pOriginal, size_t size, size_t alignment,
+                                             VkSystemAllocationScope scope)
+{
+    (void)pUserData;
+    if (!pOriginal)
+        return hostAllocation(pUserData, size, alignment, scope);
+    if (size == 0)
+    {
+        release(pOriginal);
+        return nullptr;
+    }
+
+    const size_t originalSize = getHeader(pOriginal)->size;
+    if (tryGrowInArena(pOriginal, size, std::max(alignment, alignof(AllocationHeader))))
+    {
+        recordFree(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND, originalSize);
+        recordAllocation(VK_SYSTEM_ALLOCATION_SCOPE_COMMAND, size, true);
+        return pOriginal;
+    }
+
+    // on failure, the original allocation is left as it is
+    void* pointer = allocate(size, alignment, scope);
+    if (!pointer)
+        return nullptr;
+    memcpy(pointer, pOriginal, std::min(originalSize, size));
+    release(pOriginal);
+    return pointer;
+}
+
+VKAPI_ATTR void VKAPI_CALL hostFree(void* pUserData, void* pMemory)
+{
+    (void)pUserData;
+    if (pMemory)
+        release(pMemory);
+}
+
+VKAPI_ATTR void VKAPI_CALL hostInternalAllocation(void* pUserData, size_t size, VkInternalAllocationType allocationType,
+                                                  VkSystemAllocationScope scope)
+{
+    (void)pUserData;
+    (void)allocationType;
+    getCounters(scope).internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL hostInternalFree(void* pUserData, size_t size, VkInternalAllocationType allocationType,
+                                            VkSystemAllocationScope scope)
+{
+    (void)pUserData;
+    (void)allocationType;
+    getCounters(scope).internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+const VkAllocationCallbacks s_callbacks = {
+    nullptr,                    // pUserData
+    hostAllocation,
+    hostReallocation,
+    hostFree,
+    hostInternalAllocation,
+    hostInternalFree,
+};
+
+}   // namespace
+
+
+// --------------------------<<  Host Allocator  >>--------------------------
+
+const VkAllocationCallbacks* HostAllocator::getCallbacks()
+{
+#if defined(DISABLE_HOST_ALLOCATOR)
+    return nullptr;
+#else
+    return &s_callbacks;
+#endif
+}
+
+HostAllocationStats HostAllocator::getStats(VkSystemAllocationScope scope)
+{
+    const ScopeCounters& counters = getCounters(scope);
+
+    HostAllocationStats stats;
+    stats.allocationCount   = counters.allocationCount.load(std::memory_order_relaxed);
+    stats.arenaCount        = counters.arenaCount.load(std::memory_order_relaxed);
+    stats.freeCount         = counters.freeCount.load(std::memory_order_relaxed);
+    stats.liveBytes         = counters.liveBytes.load(std::memory_order_relaxed);
+    stats.peakBytes         = counters.peakBytes.load(std::memory_order_relaxed);
+    stats.totalBytes        = counters.totalBytes.load(std::memory_order_relaxed);
+    stats.internalBytes     = counters.internalBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t HostAllocator::getHeapAllocationCount()
+{
+    uint64_t count = 0;
+    for (const ScopeCounters& counters : s_counters)
+        count += counters.allocationCount.load(std::memory_order_relaxed) - counters.arenaCount.load(std::memory_order_relaxed);
+    return count;
+}
+
+void HostAllocator::printReport()
+{
+    if (!getCallbacks())
+        return;
+
+    PRINT_BAR_LINE();
+    PRINTLN("Host memory (driver allocations)");
+    PRINT_BAR_DOTS();
+    PRINT(std::fixed << std::setprecision(1));
+    for (uint32_t i = 0; i < SCOPE_COUNT; ++i)
+    {
+        const HostAllocationStats stats = getStats(static_cast<VkSystemAllocationScope>(i));
+        PRINTLN(std::left << std::setw(10) << getScopeName(static_cast<VkSystemAllocationScope>(i)) << std::right
+                << std::setw(10) << stats.allocationCount - stats.arenaCount << " heap"
+                << std::setw(10) << stats.arenaCount << " arena"
+                << std::setw(10) << BYTES_TO_KB(stats.liveBytes) << " KB"
+                << "   peak " << std::setw(8) << BYTES_TO_KB(stats.peakBytes) << " KB"
+                << "   internal " << std::setw(8) << BYTES_TO_KB(stats.internalBytes) << " KB");
+    }
+    PRINT(std::defaultfloat);
+    PRINT_BAR_LINE();
+}
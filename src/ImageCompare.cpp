@@ -0,0 +1,105 @@
+#include "ImageCompare.h"
+
+#include "stb_image.h"      // implemented in StbImage.cpp
+
+#include <cmath>
+#include <algorithm>
+
+
+// ----------------------------<<  Color Space  >>---------------------------
+
+struct Lab
+{
+    float l, a, b;
+};
+
+static float srgbToLinear(uint8_t value)
+{
+    const float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float labCurve(float t)
+{
+    // cube root, linear close to 0
+    return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+// 8-bit sRGB to CIELAB (D65 white). Alpha is ignored, the captures are opaque.
+static Lab toLab(const uint8_t* rgb, const float* linearTable)
+{
+    const float r = linearTable[rgb[0]];
+    const float g = linearTable[rgb[1]];
+    const float b = linearTable[rgb[2]];
+
+    const float x = (0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f;
+    const float y = (0.2126f * r + 0.7152f * g + 0.0722f * b);
+    const float z = (0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f;
+
+    const float fx = labCurve(x);
+    const float fy = labCurve(y);
+    const float fz = labCurve(z);
+    return { 116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz) };
+}
+
+
+// ---------------------------<<  Image Compare  >>--------------------------
+
+ImageCompareResult compareImages(const char* imagePath, const char* referencePath, const ImageCompareSettings& settings)
+{
+    ImageCompareResult result{};
+
+    int width, height, channels;
+    int referenceWidth, referenceHeight, referenceChannels;
+    stbi_uc* image      = stbi_load(imagePath, &width, &height, &channels, STBI_rgb_alpha);
+    stbi_uc* reference  = stbi_load(referencePath, &referenceWidth, &referenceHeight, &referenceChannels, STBI_rgb_alpha);
+
+    if (!image || !reference)
+        result.error = std::string("failed to load ") + (!image ? imagePath : referencePath);
+    else if (width != referenceWidth || height != referenceHeight)
+        result.error = "size mismatch: " + std::to_string(width) + "x" + std::to_string(height) + " against "
+                     + std::to_string(referenceWidth) + "x" + std::to_string(referenceHeight);
+
+    if (!result.error.empty())
+    {
+        stbi_image_free(image);
+        stbi_image_free(reference);
+        return result;
+    }
+
+    float linearTable[256];
+    for (int i = 0; i < 256; i++)
+        linearTable[i] = srgbToLinear(static_cast<uint8_t>(i));
+
+    const uint64_t pixelCount = uint64_t(width) * height;
+    double totalDeltaE = 0.0;
+    for (uint64_t i = 0; i < pixelCount; i++)
+    {
+        const uint8_t* pixel            = image + i * 4;
+        const uint8_t* referencePixel   = reference + i * 4;
+        if (pixel[0] == referencePixel[0] && pixel[1] == referencePixel[1] && pixel[2] == referencePixel[2])
+            continue;
+
+        // CIE76 distance
+        const Lab lab           = toLab(pixel, linearTable);
+        const Lab referenceLab  = toLab(referencePixel, linearTable);
+        const float deltaE = std::sqrt((lab.l - referenceLab.l) * (lab.l - referenceLab.l)
+                                     + (lab.a - referenceLab.a) * (lab.a - referenceLab.a)
+                                     + (lab.b - referenceLab.b) * (lab.b - referenceLab.b));
+
+        totalDeltaE        += deltaE;
+        result.maxDeltaE    = std::max(result.maxDeltaE, deltaE);
+        if (deltaE > settings.deltaEThreshold)
+            result.differentPixelCount++;
+    }
+
+    result.width            = static_cast<uint32_t>(width);
+    result.height           = static_cast<uint32_t>(height);
+    result.differentRatio   = static_cast<float>(double(result.differentPixelCount) / pixelCount);
+    result.meanDeltaE       = static_cast<float>(totalDeltaE / pixelCount);
+    result.isMatching       = result.differentRatio <= settings.maxDifferentRatio;
+
+    stbi_image_free(image);
+    stbi_image_free(reference);
+    return result;
+}
@@ -0,0 +1,65 @@
+#include "ImageProcessing.h"
+
+#include <cstring>
+
+
+// -------------------------<<  Dispatch Planning  >>--------------------------
+
+static ImageDispatch makeDispatch(ImageSpatialOp op, float amount, uint32_t inputWidth, uint32_t inputHeight,
+                                  uint32_t outputWidth, uint32_t outputHeight)
+{
+    ImageDispatch dispatch;
+    memset(&dispatch, 0, sizeof(dispatch));
+    dispatch.constants.inputSize[0]     = inputWidth;
+    dispatch.constants.inputSize[1]     = inputHeight;
+    dispatch.constants.outputSize[0]    = outputWidth;
+    dispatch.constants.outputSize[1]    = outputHeight;
+    dispatch.constants.spatialOp        = static_cast<uint32_t>(op);
+    dispatch.constants.spatialAmount    = amount;
+    dispatch.width                      = outputWidth;
+    dispatch.height                     = outputHeight;
+    return dispatch;
+}
+
+std::vector<ImageDispatch> planImageDispatches(const ImageOperationChain& chain, uint32_t width, uint32_t height)
+{
+    std::vector<ImageDispatch> dispatches;
+
+    for (const ImageOperation& operation : chain)
+    {
+        // fused into the previous dispatch, applied to its result
+        if (operation.isPerPixel())
+        {
+            // nothing to fuse into (i.e. at the start), or full: a plain copy hosts it
+            if (dispatches.empty() || dispatches.back().constants.pointOpCount == IMAGE_MAX_FUSED_OPS)
+                dispatches.push_back(makeDispatch(ImageSpatialOp::Copy, 0.0f, width, height, width, height));
+
+            ImageDispatchConstants& constants = dispatches.back().constants;
+            constants.pointOps[constants.pointOpCount]      = static_cast<uint32_t>(operation.type);
+            constants.pointAmounts[constants.pointOpCount]  = operation.amount;
+            constants.pointOpCount++;
+            continue;
+        }
+
+        switch (operation.type)
+        {
+        case ImageOperationType::Resize:
+            dispatches.push_back(makeDispatch(ImageSpatialOp::Copy, 0.0f, width, height, operation.width, operation.height));
+            width   = operation.width;
+            height  = operation.height;
+            break;
+        case ImageOperationType::Blur:
+            // separable: 2 x (2r + 1) taps instead of (2r + 1)^2
+            dispatches.push_back(makeDispatch(ImageSpatialOp::BlurHorizontal, operation.amount, width, height, width, height));
+            dispatches.push_back(makeDispatch(ImageSpatialOp::BlurVertical, operation.amount, width, height, width, height));
+            break;
+        case ImageOperationType::Sharpen:
+            dispatches.push_back(makeDispatch(ImageSpatialOp::Sharpen, operation.amount, width, height, width, height));
+            break;
+        default:
+            break;
+        }
+    }
+
+    return dispatches;
+}
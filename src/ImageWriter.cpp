@@ -0,0 +1,146 @@
+#include "ImageWriter.h"
+
+#include <cstdio>
+#include <vector>
+
+// deflate stored blocks hold up to 65535 bytes
+#define DEFLATE_MAX_STORED_BLOCK    65535
+
+
+// ---------------------------<<  Checksums  >>------------------------------
+
+struct CrcTable
+{
+    uint32_t values[256];
+
+    CrcTable()
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            values[n] = c;
+        }
+    }
+};
+static const CrcTable s_crcTable;   // built before main(), read-only after
+
+static uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        crc = s_crcTable.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void updateAdler(uint32_t& a, uint32_t& b, const uint8_t* data, size_t size)
+{
+    // the sums are reduced every 5552 bytes, the most that can't overflow
+    while (size > 0)
+    {
+        const size_t chunk = size < 5552 ? size : 5552;
+        for (size_t i = 0; i < chunk; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+
+// ----------------------------<<  PNG Writer  >>----------------------------
+
+static void appendUint32(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool writeChunk(FILE* file, const char* type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> header;
+    appendUint32(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+
+    uint32_t crc = updateCrc(0xFFFFFFFFu, header.data() + 4, 4);
+    crc = updateCrc(crc, data.data(), data.size()) ^ 0xFFFFFFFFu;
+    std::vector<uint8_t> footer;
+    appendUint32(footer, crc);
+
+    return fwrite(header.data(), 1, header.size(), file) == header.size()
+        && (data.empty() || fwrite(data.data(), 1, data.size(), file) == data.size())     // IEND has none
+        && fwrite(footer.data(), 1, footer.size(), file) == footer.size();
+}
+
+bool writePng(const char* path, const ImageWriteDesc& image)
+{
+    if (image.width == 0 || image.height == 0 || image.rowPitch < image.width * 4)
+        return false;
+
+    // << Image Data >> each row: filter type (0, none) then the RGBA pixels
+    const size_t rowSize = 1 + size_t(image.width) * 4;
+    std::vector<uint8_t> raw(rowSize * image.height);
+    for (uint32_t y = 0; y < image.height; y++)
+    {
+        uint8_t*        dst = &raw[y * rowSize];
+        const uint8_t*  src = image.pixels + size_t(y) * image.rowPitch;
+        *dst++ = 0;
+        for (uint32_t x = 0; x < image.width; x++, src += 4, dst += 4)
+        {
+            dst[0] = image.isBgra ? src[2] : src[0];
+            dst[1] = src[1];
+            dst[2] = image.isBgra ? src[0] : src[2];
+            dst[3] = src[3];
+        }
+    }
+
+    // zlib stream of stored deflate blocks
+    const size_t blockCount = (raw.size() + DEFLATE_MAX_STORED_BLOCK - 1) / DEFLATE_MAX_STORED_BLOCK;
+    std::vector<uint8_t> compressed;
+    compressed.reserve(2 + raw.size() + blockCount * 5 + 4);
+    compressed.push_back(0x78);     // deflate, 32K window
+    compressed.push_back(0x01);     // no preset dictionary, fastest (header checksum)
+    for (size_t offset = 0; offset < raw.size(); offset += DEFLATE_MAX_STORED_BLOCK)
+    {
+        const size_t    size    = raw.size() - offset < DEFLATE_MAX_STORED_BLOCK ? raw.size() - offset : DEFLATE_MAX_STORED_BLOCK;
+        const bool      isLast  = offset + size == raw.size();
+        compressed.push_back(isLast ? 1 : 0);
+        compressed.push_back(static_cast<uint8_t>(size));
+        compressed.push_back(static_cast<uint8_t>(size >> 8));
+        compressed.push_back(static_cast<uint8_t>(~size));
+        compressed.push_back(static_cast<uint8_t>(~size >> 8));
+        compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    uint32_t adlerA = 1, adlerB = 0;
+    updateAdler(adlerA, adlerB, raw.data(), raw.size());
+    appendUint32(compressed, (adlerB << 16) | adlerA);
+
+    // << Chunks >>
+    std::vector<uint8_t> header;
+    appendUint32(header, image.width);
+    appendUint32(header, image.height);
+    header.push_back(8);    // bit depth
+    header.push_back(6);    // color type: RGBA
+    header.push_back(0);    // compression: deflate
+    header.push_back(0);    // filter method
+    header.push_back(0);    // no interlace
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    bool result = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature);
+    result = result && writeChunk(file, "IHDR", header);
+    result = result && writeChunk(file, "IDAT", compressed);
+    result = result && writeChunk(file, "IEND", {});
+    result = (fclose(file) == 0) && result;
+
+    return result;
+}
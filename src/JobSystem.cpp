@@ -0,0 +1,267 @@
+#include "JobSystem.h"
+#include "Common.h"
+
+#include <stdexcept>
+
+// (owner, queue index) of the calling thread. Index 0 is the shared queue.
+static thread_local const JobSystem*    s_currentJobSystem  = nullptr;
+static thread_local size_t              s_currentQueueIndex = 0;
+
+
+// ------------------------<<  Job System  >>---------------------------
+
+JobSystem::JobSystem(uint32_t workerCount) :
+    m_jobPool(nullptr),
+    m_freeJobs(nullptr),
+    m_queuedJobs(0),
+    m_isRunning(true)
+{
+    if (workerCount == 0)
+    {
+        const uint32_t n_cores = std::thread::hardware_concurrency();
+        workerCount = n_cores > 1 ? n_cores - 1 : 1;
+    }
+
+    // all the jobs are allocated once, and recycled through the free list
+    m_jobPool = new Job[k_maxJobs];
+    for (size_t i = 0; i < k_maxJobs; ++i)
+    {
+        m_jobPool[i].nextFree = m_freeJobs;
+        m_freeJobs = &m_jobPool[i];
+    }
+
+    for (uint32_t i = 0; i < workerCount + 1; ++i)
+        m_queues.push_back(new WorkQueue());
+
+    for (uint32_t i = 0; i < workerCount; ++i)
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+
+    PRINTLN("Created Job System with " << workerCount << " workers");
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_isRunning = false;
+    }
+    m_sleepCondition.notify_all();
+
+    for (auto& worker : m_workers)
+        worker.join();
+
+    for (auto queue : m_queues)
+        delete queue;
+    delete[] m_jobPool;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    // help instead of blocking, the jobs we wait for may be sitting in a queue
+    while (!counter.isDone())
+    {
+        if (!runOneJob())
+            std::this_thread::yield();
+    }
+
+    // the last decrement may still hold the lock, the counter (often on
+    // the caller's stack) must outlive it
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+JobSystem::Job* JobSystem::allocateJob()
+{
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_freeJobsMutex);
+            if (m_freeJobs != nullptr)
+            {
+                Job* job = m_freeJobs;
+                m_freeJobs = job->nextFree;
+                return job;
+            }
+        }
+
+        // pool exhausted: drain some work to recycle jobs
+        if (!runOneJob())
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::freeJob(Job* job)
+{
+    std::lock_guard<std::mutex> lock(m_freeJobsMutex);
+    job->nextFree = m_freeJobs;
+    m_freeJobs = job;
+}
+
+void JobSystem::submit(Job* job, JobCounter* signalCounter, std::initializer_list<JobCounter*> dependencies)
+{
+    if (dependencies.size() > k_maxDependencies)
+        throw std::invalid_argument("too many job dependencies!");
+
+    job->signalCounter = signalCounter;
+    if (signalCounter != nullptr)
+        signalCounter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+    // one extra reference, so the job can't be released while registering
+    job->pendingDependencies.store(static_cast<uint32_t>(dependencies.size()) + 1, std::memory_order_relaxed);
+
+    size_t n_waiter = 0;
+    for (JobCounter* dependency : dependencies)
+    {
+        bool isDone = true;
+        {
+            std::lock_guard<std::mutex> lock(dependency->m_mutex);
+            if (!dependency->isDone())
+            {
+                WaiterNode& waiter = job->waiters[n_waiter++];
+                waiter.job  = job;
+                waiter.next = dependency->m_waiters;
+                dependency->m_waiters = &waiter;
+                isDone = false;
+            }
+        }
+        if (isDone)
+            job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        enqueue(job);
+}
+
+void JobSystem::enqueue(Job* job)
+{
+    WorkQueue& queue = *m_queues[getQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        // cannot overflow: a queue never holds more than the jobs in the pool
+        queue.jobs[queue.bottom % k_maxJobs] = job;
+        queue.bottom++;
+    }
+    m_queuedJobs.fetch_add(1, std::memory_order_release);
+
+    // wake up a sleeping worker. Taking the lock avoids a lost wake-up between
+    // a worker checking m_queuedJobs and going to sleep.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_sleepCondition.notify_one();
+}
+
+void JobSystem::execute(Job* job)
+{
+    job->invoke(job->storage);
+    job->destroy(job->storage);
+
+    JobCounter* signalCounter = job->signalCounter;
+    freeJob(job);
+
+    if (signalCounter != nullptr)
+        decrement(signalCounter);
+}
+
+void JobSystem::decrement(JobCounter* counter)
+{
+    uint32_t value = counter->m_value.load(std::memory_order_relaxed);
+    while (value > 1)
+    {
+        if (counter->m_value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+            return;
+    }
+
+    // The last one reaches zero under the lock, wait() takes it before
+    // returning: the counter isn't touched once released.
+    // Then release the jobs that were waiting for it.
+    WaiterNode* waiter;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (counter->m_value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        waiter = counter->m_waiters;
+        counter->m_waiters = nullptr;
+    }
+
+    while (waiter != nullptr)
+    {
+        WaiterNode* next = waiter->next;    // the node belongs to the job, read before release
+        Job*        job  = waiter->job;
+        if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            enqueue(job);
+        waiter = next;
+    }
+}
+
+bool JobSystem::runOneJob()
+{
+    Job* job = findJob(getQueueIndex());
+    if (job == nullptr)
+        return false;
+
+    execute(job);
+    return true;
+}
+
+JobSystem::Job* JobSystem::findJob(size_t queueIndex)
+{
+    if (m_queuedJobs.load(std::memory_order_acquire) == 0)
+        return nullptr;
+
+    // 1. own queue, newest first
+    {
+        WorkQueue& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.bottom != queue.top)
+        {
+            queue.bottom--;
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return queue.jobs[queue.bottom % k_maxJobs];
+        }
+    }
+
+    // 2. steal the oldest job from the others
+    for (size_t i = 1; i < m_queues.size(); ++i)
+    {
+        WorkQueue& queue = *m_queues[(queueIndex + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.bottom != queue.top)
+        {
+            Job* job = queue.jobs[queue.top % k_maxJobs];
+            queue.top++;
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::workerLoop(size_t queueIndex)
+{
+    s_currentJobSystem  = this;
+    s_currentQueueIndex = queueIndex;
+
+    while (true)
+    {
+        Job* job = findJob(queueIndex);
+        if (job != nullptr)
+        {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCondition.wait(lock, [this] {
+            return m_queuedJobs.load(std::memory_order_acquire) > 0 || !m_isRunning;
+        });
+
+        if (!m_isRunning)
+            return;
+    }
+}
+
+size_t JobSystem::getQueueIndex() const
+{
+    return s_currentJobSystem == this ? s_currentQueueIndex : 0;
+}
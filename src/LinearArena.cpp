@@ -0,0 +1,55 @@
+#include "LinearArena.h"
+#include "Common.h"
+
+#include <algorithm>
+
+static uintptr_t alignUp(uintptr_t address, size_t alignment)
+{
+    return (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+}
+
+
+// --------------------------<<  Linear Arena  >>---------------------------
+
+LinearArena::LinearArena(size_t capacity) :
+    m_memory(capacity ? new uint8_t[capacity] : nullptr),
+    m_capacity(capacity),
+    m_offset(0),
+    m_usedBytes(0),
+    m_peakBytes(0)
+{
+}
+
+void* LinearArena::allocate(size_t size, size_t alignment)
+{
+    const uintptr_t begin   = reinterpret_cast<uintptr_t>(m_memory.get());
+    const uintptr_t pointer = alignUp(begin + m_offset, alignment);
+
+    m_usedBytes += size + (pointer - (begin + m_offset));
+    m_peakBytes = std::max(m_peakBytes, m_usedBytes);
+
+    if (m_memory && pointer + size <= begin + m_capacity)
+    {
+        m_offset = pointer + size - begin;
+        return reinterpret_cast<void*>(pointer);
+    }
+
+    // out of room, until the next reset
+    m_overflowBlocks.emplace_back(new uint8_t[size + alignment]);
+    return reinterpret_cast<void*>(alignUp(reinterpret_cast<uintptr_t>(m_overflowBlocks.back().get()), alignment));
+}
+
+void LinearArena::reset()
+{
+    if (!m_overflowBlocks.empty())
+    {
+        // room for the whole of the biggest frame so far, with some margin
+        m_capacity = std::max(m_capacity * 2, m_peakBytes + m_peakBytes / 2);
+        m_memory.reset(new uint8_t[m_capacity]);
+        m_overflowBlocks.clear();
+        PRINTLN_VERBOSE("Arena) grown to " << m_capacity / 1024 << " KB");
+    }
+
+    m_offset    = 0;
+    m_usedBytes = 0;
+}
@@ -0,0 +1,177 @@
+#include "MemoryTracker.h"
+#include "Common.h"
+#include "HostAllocator.h"
+
+#include <iomanip>
+
+#define BYTES_TO_MB(_bytes)     ((_bytes) / (1024.0 * 1024.0))
+
+
+const char* getMemoryCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::Vertex:        return "vertex";
+    case MemoryCategory::Index:         return "index";
+    case MemoryCategory::Uniform:       return "uniform";
+    case MemoryCategory::Texture:       return "texture";
+    case MemoryCategory::Staging:       return "staging";
+    case MemoryCategory::Attachment:    return "attachment";
+    case MemoryCategory::Readback:      return "readback";
+    case MemoryCategory::Transient:     return "transient";
+    default:                            return "unknown";
+    }
+}
+
+
+// -------------------------<<  Memory Tracker  >>---------------------------
+
+MemoryTracker::MemoryTracker() :
+    m_physicalDevice(VK_NULL_HANDLE),
+    m_memoryProperties{},
+    m_isMemoryBudgetEnabled(false)
+{
+    m_categoryUsage.fill(0);
+    m_categoryAllocationCount.fill(0);
+    m_heapUsage.fill(0);
+}
+
+void MemoryTracker::init(VkPhysicalDevice physicalDevice, bool isMemoryBudgetEnabled)
+{
+    m_physicalDevice        = physicalDevice;
+    m_isMemoryBudgetEnabled = isMemoryBudgetEnabled;
+
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+    PRINTLN("Memory) " << m_memoryProperties.memoryHeapCount << " heaps, budget query "
+            << (m_isMemoryBudgetEnabled ? "enabled" : "not available"));
+}
+
+VkResult MemoryTracker::allocate(VkDevice device, const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category, VkDeviceMemory* outMemory)
+{
+    const uint32_t heapIndex = m_memoryProperties.memoryTypes[allocateInfo.memoryTypeIndex].heapIndex;
+
+    // going over the budget doesn't fail right away, but the OS starts paging
+    // (or the next allocation fails). Worth a warning.
+    if (m_isMemoryBudgetEnabled)
+    {
+        MemoryHeapBudgets budgets;
+        getHeapBudgets(budgets);
+        if (budgets[heapIndex].usage + allocateInfo.allocationSize > budgets[heapIndex].budget)
+            PRINTLN("Memory) heap " << heapIndex << " over budget after allocating "
+                    << BYTES_TO_MB(allocateInfo.allocationSize) << "MB of " << getMemoryCategoryName(category));
+    }
+
+    VkResult result = vkAllocateMemory(device, &allocateInfo, HostAllocator::getCallbacks(), outMemory);
+    if (result != VK_SUCCESS)
+    {
+        // the state of the heaps is what we need to diagnose this
+        PRINTLN("Memory) failed to allocate " << BYTES_TO_MB(allocateInfo.allocationSize)
+                << "MB of " << getMemoryCategoryName(category) << " (VkResult " << result << ")");
+        printReport();
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allocations[*outMemory] = Allocation{ allocateInfo.allocationSize, category, heapIndex };
+    m_categoryUsage[static_cast<size_t>(category)] += allocateInfo.allocationSize;
+    m_categoryAllocationCount[static_cast<size_t>(category)]++;
+    m_heapUsage[heapIndex] += allocateInfo.allocationSize;
+
+    return result;
+}
+
+void MemoryTracker::free(VkDevice device, VkDeviceMemory memory)
+{
+    if (memory == VK_NULL_HANDLE)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto allocation = m_allocations.find(memory);
+        if (allocation != m_allocations.end())
+        {
+            const Allocation& info = allocation->second;
+            m_categoryUsage[static_cast<size_t>(info.category)] -= info.size;
+            m_categoryAllocationCount[static_cast<size_t>(info.category)]--;
+            m_heapUsage[info.heapIndex] -= info.size;
+            m_allocations.erase(allocation);
+        }
+    }
+
+    vkFreeMemory(device, memory, HostAllocator::getCallbacks());
+}
+
+uint32_t MemoryTracker::getHeapBudgets(MemoryHeapBudgets& outBudgets) const
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    if (m_isMemoryBudgetEnabled)
+    {
+        // the values change over time, queried every time (cheap, no driver allocation)
+        VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+        memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties2.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &memoryProperties2);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+    {
+        const VkMemoryHeap& heap = m_memoryProperties.memoryHeaps[i];
+
+        MemoryHeapBudget& budget = outBudgets[i];
+        budget.size             = heap.size;
+        budget.budget           = m_isMemoryBudgetEnabled ? budgetProperties.heapBudget[i] : heap.size;
+        budget.usage            = m_isMemoryBudgetEnabled ? budgetProperties.heapUsage[i] : m_heapUsage[i];
+        budget.trackedUsage     = m_heapUsage[i];
+        budget.isDeviceLocal    = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+
+    return m_memoryProperties.memoryHeapCount;
+}
+
+VkDeviceSize MemoryTracker::getCategoryUsage(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_categoryUsage[static_cast<size_t>(category)];
+}
+
+uint32_t MemoryTracker::getCategoryAllocationCount(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_categoryAllocationCount[static_cast<size_t>(category)];
+}
+
+void MemoryTracker::printReport() const
+{
+    MemoryHeapBudgets budgets;
+    const uint32_t n_heaps = getHeapBudgets(budgets);
+
+    PRINT_BAR_LINE();
+    PRINTLN("GPU memory" << (m_isMemoryBudgetEnabled ? "" : " (no VK_EXT_memory_budget, usage is ours only)"));
+    PRINT_BAR_DOTS();
+    PRINT(std::fixed << std::setprecision(1));
+    for (uint32_t i = 0; i < n_heaps; ++i)
+    {
+        const MemoryHeapBudget& budget = budgets[i];
+        PRINTLN("heap " << i << (budget.isDeviceLocal ? " (device) " : " (host)   ")
+                << std::setw(10) << BYTES_TO_MB(budget.usage) << " / "
+                << std::setw(10) << BYTES_TO_MB(budget.budget) << " MB"
+                << "   ours " << std::setw(8) << BYTES_TO_MB(budget.trackedUsage) << " MB"
+                << "   size " << std::setw(10) << BYTES_TO_MB(budget.size) << " MB");
+    }
+    PRINT_BAR_DOTS();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < k_categoryCount; ++i)
+        {
+            PRINTLN(std::left << std::setw(12) << getMemoryCategoryName(static_cast<MemoryCategory>(i)) << std::right
+                    << std::setw(10) << BYTES_TO_MB(m_categoryUsage[i]) << " MB"
+                    << std::setw(8) << m_categoryAllocationCount[i] << " allocations");
+        }
+    }
+    PRINT(std::defaultfloat);
+    PRINT_BAR_LINE();
+}
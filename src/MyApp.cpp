@@ -1,16 +1,55 @@
 #include "MyApp.h"
 #include "VulkanManager.h"
 #include "Common.h"
+#include "ImageCompare.h"
+#include "Profiler.h"
+#include "HostAllocator.h"
+#include "AllocationCounter.h"
+#if defined(NULL_BACKEND)
+#   include "NullBackend.h"
+#endif
 
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 #include <stdexcept>
 #include <chrono>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+
+// golden image runs, see runGoldenImage()
+#define GOLDEN_ANIMATION_TIME       0.5f    // seconds, the frame that is rendered
+#define GOLDEN_READY_TIMEOUT_SEC    60      // pipelines are slow to build on software drivers
+#define GOLDEN_WARMUP_FRAMES        10
+#define GOLDEN_TIMED_FRAMES         100
+
+// allocation check, see setAllocationCheck()
+#define ALLOCATION_CHECK_WARMUP_FRAMES  100     // once the pipelines are ready, the first frames fill the caches
+#define ALLOCATION_CHECK_FRAME_LIMIT    1000    // without --frames
+#define ALLOCATION_CHECK_PRINTED_FRAMES 10      // the first allocating frames are printed
+
+#if defined(NULL_BACKEND)
+#   define DEFAULT_FRAME_LIMIT      1000    // the null window never closes (see NullBackend.h)
+#else
+#   define DEFAULT_FRAME_LIMIT      0
+#endif
+
+// #define SPRITE_STRESS_COUNT 100000  // sprites submitted every frame, see submitStressSprites()
 
 
 //----------------------------------------------------------------------
 
-MyApp::MyApp() : m_width(800), m_height(600)
+MyApp::MyApp() :
+    m_width(800),
+    m_height(600),
+    m_goldenOutputPath("golden_output.png"),
+    m_isGoldenUpdate(false),
+    m_scene(AppScene::Quads),
+    m_frameLimit(DEFAULT_FRAME_LIMIT),
+    m_isAllocationCheck(false),
+    m_maxFramesInFlight(0),
+    m_msaaSamples(0)
 {
 };
 
@@ -20,12 +59,72 @@ MyApp::~MyApp()
 
 //----------------------------------------------------------------------
 
-void MyApp::run()
+int MyApp::run()
 {
     initGLFW();
     initVulkanManager();
-    mainLoop();
+
+    bool result = true;
+    if (m_goldenReferencePath.empty())
+        result = mainLoop();
+    else
+        result = runGoldenImage();
+
     cleanup();
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void MyApp::setGoldenImage(const std::string& referencePath, bool isUpdate)
+{
+    m_goldenReferencePath   = referencePath;
+    m_isGoldenUpdate        = isUpdate;
+}
+
+void MyApp::setGoldenOutput(const std::string& outputPath)
+{
+    m_goldenOutputPath = outputPath;
+}
+
+void MyApp::setGoldenResults(const std::string& csvPath)
+{
+    m_goldenResultsPath = csvPath;
+}
+
+// per AppScene, the names of --scene and of the golden images
+static const char* const k_sceneNames[] = { "quads", "quads_no_msaa", "sprites", "processed_texture", "resized_texture" };
+static_assert(sizeof(k_sceneNames) / sizeof(k_sceneNames[0]) == size_t(AppScene::Count), "a name per scene");
+
+bool MyApp::setScene(const std::string& name)
+{
+    for (uint32_t i = 0; i < uint32_t(AppScene::Count); i++)
+    {
+        if (name == k_sceneNames[i])
+        {
+            m_scene = static_cast<AppScene>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void MyApp::setFrameLimit(uint32_t frameCount)
+{
+    m_frameLimit = frameCount;
+}
+
+void MyApp::setAllocationCheck(bool isEnabled)
+{
+    m_isAllocationCheck = isEnabled;
+}
+
+void MyApp::setMaxFramesInFlight(uint32_t maxFramesInFlight)
+{
+    m_maxFramesInFlight = maxFramesInFlight;
+}
+
+void MyApp::setMsaaSamples(uint32_t sampleCount)
+{
+    m_msaaSamples = sampleCount;
 }
 
 
@@ -48,7 +147,8 @@ void MyApp::initGLFW()
     // GLFW is initially deigned for OpenGL, so we need to explicitly tell
     // that we will not create OpenGL context.
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    // the golden images are compared at the size they were made
+    glfwWindowHint(GLFW_RESIZABLE, m_goldenReferencePath.empty() ? GLFW_TRUE : GLFW_FALSE);
 
     // create window
     m_window = glfwCreateWindow(m_width, m_height, "Vulkan Window", nullptr, nullptr);
@@ -70,21 +170,116 @@ void MyApp::initVulkanManager()
 {
     m_VulkanManager = new VulkanManager();
 
+    if (m_maxFramesInFlight != 0)
+        m_VulkanManager->setMaxFramesInFlight(m_maxFramesInFlight);
+    if (m_msaaSamples != 0)
+        m_VulkanManager->setMsaaSamples(m_msaaSamples);
+
+    // the settings of the scene, unless given
+    if (m_scene == AppScene::QuadsNoMsaa && m_msaaSamples == 0)
+        m_VulkanManager->setMsaaSamples(1);
+    if (m_scene == AppScene::ProcessedTexture)
+    {
+        m_VulkanManager->setTextureProcessing({
+            ImageOperation::resize(512, 512),
+            ImageOperation::sharpen(0.5f),
+            ImageOperation::saturation(1.3f),
+            ImageOperation::contrast(1.1f),
+        });
+    }
+    if (m_scene == AppScene::ResizedTexture)
+    {
+        m_VulkanManager->setTextureProcessing({
+            ImageOperation::resize(2048, 2048),
+            ImageOperation::resize(512, 512),
+            ImageOperation::resize(256, 256),
+        });
+    }
+
     m_VulkanManager->initVulkan(m_window);
 }
 
-void MyApp::mainLoop()
+#if defined(SPRITE_STRESS_COUNT)
+// sprites drifting across the window, all with the same texture (a single draw)
+static void submitStressSprites(SpriteBatch& sprites, uint32_t width, uint32_t height, float time)
+{
+    const float size = 16.0f;
+    for (uint32_t i = 0; i < SPRITE_STRESS_COUNT; i++)
+    {
+        const float x = std::fmod(i * 13.37f + time * (20.0f + i % 60), static_cast<float>(width));
+        const float y = std::fmod(i * 7.31f, static_cast<float>(height));
+        const uint32_t color = makeSpriteColor((i % 7) / 6.0f, (i % 5) / 4.0f, (i % 3) / 2.0f);
+        sprites.submit(SPRITE_TEXTURE_DEFAULT, { x, y, size, size }, { 0.0f, 0.0f, 1.0f, 1.0f }, color,
+                       0.1f + 0.8f * i / SPRITE_STRESS_COUNT);
+    }
+}
+#endif  // defined(SPRITE_STRESS_COUNT)
+
+void MyApp::submitSceneSprites()
+{
+    if (m_scene != AppScene::Sprites)
+        return;
+
+    // a grid of overlapping sprites, the depth and the color vary across it
+    const uint32_t  columns = 16;
+    const uint32_t  rows    = 12;
+    const float     size    = 0.9f * m_width / columns;
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        for (uint32_t x = 0; x < columns; x++)
+        {
+            const uint32_t color = makeSpriteColor(float(x) / (columns - 1), float(y) / (rows - 1), 0.5f);
+            m_VulkanManager->getSpriteBatch().submit(SPRITE_TEXTURE_DEFAULT,
+                { (x + 0.25f) * m_width / columns, (y + 0.25f) * m_height / rows, size, size },
+                { 0.0f, 0.0f, 1.0f, 1.0f }, color, float((x + y) % 5) / 5.0f);
+        }
+    }
+}
+
+void MyApp::drawSceneFrame()
+{
+    glfwPollEvents();
+    submitSceneSprites();
+    m_VulkanManager->drawFrame();
+}
+
+bool MyApp::mainLoop()
 {
     // fps timer setup
     uint32_t    frames = 0;
     double      fps = 0;
     auto        prevTime = std::chrono::high_resolution_clock::now();
 
-    while (!glfwWindowShouldClose(m_window))
+    // allocation check: the frames after the warm up must not allocate
+    const uint32_t  frameLimit = m_isAllocationCheck && m_frameLimit == 0 ? ALLOCATION_CHECK_FRAME_LIMIT : m_frameLimit;
+    uint32_t        warmupFrames = 0;       // since the pipelines are ready
+    uint32_t        checkedFrames = 0;
+    uint32_t        allocatingFrames = 0;
+    uint64_t        frameAllocations = 0;   // in the checked frames
+
+    // CPU frame time over the whole loop, see setFrameLimit()
+    const uint64_t  loopStartTime = Profiler::now();
+    uint32_t        frameCount = 0;
+#if defined(NULL_BACKEND)
+    const uint64_t  loopStartCalls = getNullBackendCallCount();
+#endif
+    const uint64_t  loopStartHostAllocations = HostAllocator::getHeapAllocationCount();
+
+    while (!glfwWindowShouldClose(m_window) && (frameLimit == 0 || frameCount < frameLimit))
     {
+        const uint64_t  frameStartAllocations = AllocationCounter::getThreadAllocationCount();
         glfwPollEvents();
 
+#if defined(SPRITE_STRESS_COUNT)
+        static const auto startTime = std::chrono::steady_clock::now();
+        const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+        submitStressSprites(m_VulkanManager->getSpriteBatch(), m_width, m_height, time);
+#endif  // defined(SPRITE_STRESS_COUNT)
+        submitSceneSprites();
+
+        const uint64_t  drawStartAllocations = AllocationCounter::getThreadAllocationCount();
         m_VulkanManager->drawFrame();
+        const uint64_t  drawAllocations = AllocationCounter::getThreadAllocationCount() - drawStartAllocations;
 
         // update FPS
         if (frames > 10)
@@ -96,14 +291,153 @@ void MyApp::mainLoop()
 
             prevTime = currentTime;
             frames = 0;
+
+            // display FPS in the Window title, only when it changes
+            char str_buffer[64];
+            snprintf(str_buffer, sizeof(str_buffer), "Bonjour Vulkan!\t fps: %.2f", fps);
+            glfwSetWindowTitle(m_window, str_buffer);
         }
         frames++;
+        frameCount++;
+
+        if (!m_isAllocationCheck)
+            continue;
+        if (warmupFrames < ALLOCATION_CHECK_WARMUP_FRAMES)
+        {
+            if (m_VulkanManager->isReadyToRender())
+                warmupFrames++;
+            continue;
+        }
 
-        // display FPS in the Window title
-        char str_buffer[64];
-        sprintf(str_buffer, "Bonjour Vulkan!\t fps: %.2f", fps);
-        glfwSetWindowTitle(m_window, str_buffer);
+        checkedFrames++;
+        const uint64_t allocations = AllocationCounter::getThreadAllocationCount() - frameStartAllocations;
+        if (allocations == 0)
+            continue;
+        if (allocatingFrames++ < ALLOCATION_CHECK_PRINTED_FRAMES)
+            PRINTLN("Allocations) frame " << frameCount << ": " << allocations << " allocations, "
+                    << drawAllocations << " in drawFrame");
+        frameAllocations += allocations;
     }
+
+    bool result = true;
+    if (m_isAllocationCheck)
+    {
+        PRINT_BAR_LINE();
+        if (checkedFrames == 0)
+        {
+            PRINTLN("Allocations) FAIL (no frame checked, the renderer was not ready after the warm up)");
+            result = false;
+        }
+        else
+        {
+            PRINTLN("Allocations) " << (allocatingFrames == 0 ? "PASS" : "FAIL") << " (" << allocatingFrames << " of "
+                    << checkedFrames << " frames allocated, " << frameAllocations << " allocations)");
+            result = allocatingFrames == 0;
+        }
+#if !defined(NDEBUG)
+        PRINTLN("Allocations) debug build, the validation layers allocate too");
+#endif
+    }
+
+    if (frameLimit == 0 || frameCount == 0)
+        return result;
+
+    const double frameTimeMs = (Profiler::now() - loopStartTime) / 1e6 / frameCount;
+    PRINT_BAR_LINE();
+    PRINTLN("Frames) " << frameCount << " frames, " << frameTimeMs << " ms per frame (CPU)");
+#if defined(NULL_BACKEND)
+    PRINTLN("Frames) " << double(getNullBackendCallCount() - loopStartCalls) / frameCount << " Vulkan calls per frame");
+#endif
+    // driver heap churn, see HostAllocator::printReport() for the scopes
+    PRINTLN("Frames) " << double(HostAllocator::getHeapAllocationCount() - loopStartHostAllocations) / frameCount
+            << " driver heap allocations per frame");
+    // the zones of the last frames (see PROFILER_ZONES_PER_THREAD)
+    Profiler::printReport("Frame timings", loopStartTime, "drawFrame");
+    return result;
+}
+
+bool MyApp::runGoldenImage()
+{
+    // Renders the frame at a fixed animation time, measures the frame time
+    // over a few frames, then captures it. Meant to run in CI, on a software
+    // driver (see README).
+    m_VulkanManager->setAnimationTime(GOLDEN_ANIMATION_TIME);
+
+    // the frames are cleared only until the pipelines are built
+    auto readyDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(GOLDEN_READY_TIMEOUT_SEC);
+    while (!m_VulkanManager->isReadyToRender())
+    {
+        if (std::chrono::steady_clock::now() > readyDeadline)
+        {
+            PRINTLN("Golden) timed out waiting for the pipelines");
+            writeGoldenResult("timeout", 0.0, nullptr);
+            return false;
+        }
+        drawSceneFrame();
+    }
+    for (uint32_t i = 0; i < GOLDEN_WARMUP_FRAMES; i++)
+        drawSceneFrame();
+
+    // the same frame, over and over
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < GOLDEN_TIMED_FRAMES; i++)
+        drawSceneFrame();
+    const double frameTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+                             / GOLDEN_TIMED_FRAMES;
+
+    const std::string& capturePath = m_isGoldenUpdate ? m_goldenReferencePath : m_goldenOutputPath;
+    if (!m_VulkanManager->captureFrame(capturePath))
+    {
+        writeGoldenResult("error", frameTimeMs, nullptr);
+        return false;
+    }
+    m_VulkanManager->waitForCaptures();
+
+    if (m_isGoldenUpdate)
+    {
+        PRINTLN("Golden) " << m_goldenReferencePath << ": updated, frame time " << frameTimeMs << " ms");
+        return writeGoldenResult("updated", frameTimeMs, nullptr);
+    }
+
+    ImageCompareResult compare = compareImages(m_goldenOutputPath.c_str(), m_goldenReferencePath.c_str());
+    if (!compare.error.empty())
+    {
+        PRINTLN("Golden) " << m_goldenReferencePath << ": FAIL (" << compare.error << ")");
+        if (!std::filesystem::exists(m_goldenReferencePath))
+            PRINTLN("Golden) no reference, make it with --golden-update (all the scenes: the golden_update target)");
+        writeGoldenResult("error", frameTimeMs, nullptr);
+        return false;
+    }
+
+    PRINTLN("Golden) " << m_goldenReferencePath << ": " << (compare.isMatching ? "PASS" : "FAIL")
+            << " (" << compare.differentRatio * 100.0f << "% pixels differ, mean dE " << compare.meanDeltaE
+            << ", max dE " << compare.maxDeltaE << "), frame time " << frameTimeMs << " ms");
+    return writeGoldenResult(compare.isMatching ? "pass" : "fail", frameTimeMs, &compare) && compare.isMatching;
+}
+
+bool MyApp::writeGoldenResult(const char* result, double frameTimeMs, const ImageCompareResult* compare)
+{
+    // one row per run, the scenes are run one after the other (see CMakeLists.txt)
+    if (m_goldenResultsPath.empty())
+        return true;
+
+    const bool isNewFile = !std::filesystem::exists(m_goldenResultsPath);
+    std::ofstream file(m_goldenResultsPath, std::ios::app);
+    if (!file)
+    {
+        PRINTLN("Golden) failed to write " << m_goldenResultsPath);
+        return false;
+    }
+
+    if (isNewFile)
+        file << "scene,result,frame_time_ms,different_ratio,mean_delta_e,max_delta_e\n";
+    file << k_sceneNames[uint32_t(m_scene)] << ',' << result << ',' << frameTimeMs;
+    if (compare)
+        file << ',' << compare->differentRatio << ',' << compare->meanDeltaE << ',' << compare->maxDeltaE;
+    else
+        file << ",,,";
+    file << '\n';
+    return true;
 }
 
 void MyApp::cleanVulkanManager()
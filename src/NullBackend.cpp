@@ -0,0 +1,1093 @@
+#include "NullBackend.h"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+// handles are pointers to the objects below (non-dispatchable ones are only on 64-bit)
+static_assert(sizeof(void*) == sizeof(uint64_t), "the null backend requires a 64-bit build");
+
+#define NULL_DEVICE_NAME            "Null Device"
+#define NULL_BUFFER_ALIGNMENT       256
+#define NULL_IMAGE_ALIGNMENT        4096
+#define NULL_MEMORY_TYPE_BITS       0x3     // 0: device local, 1: host visible (see vkGetPhysicalDeviceMemoryProperties)
+#define NULL_HOST_VISIBLE_TYPE      1
+#define NULL_HEAP_SIZE              (VkDeviceSize(8) << 30)
+
+
+// -----------------------------< Internal >-----------------------------
+
+namespace
+{
+    // every Vulkan object. Objects owned by another one (i.e. pool
+    // allocations, swapchain images) are destroyed along with it.
+    struct NullObject
+    {
+        std::vector<NullObject*>    children;
+        std::vector<uint8_t>        memory;             // VkDeviceMemory, of the host visible type only
+        VkDeviceSize                size        = 0;    // VkBuffer, VkImage: memory requirements
+        VkExtent2D                  extent      = {};   // VkSurfaceKHR, VkSwapchainKHR
+        std::atomic<uint64_t>       value{ 0 };         // VkSemaphore: timeline value
+        uint32_t                    nextImage   = 0;    // VkSwapchainKHR
+    };
+
+    std::atomic<uint64_t> s_callCount{ 0 };
+
+    template<typename Handle>
+    Handle toHandle(NullObject* object) { return reinterpret_cast<Handle>(object); }
+
+    template<typename Handle>
+    NullObject* toObject(Handle handle) { return reinterpret_cast<NullObject*>(handle); }
+
+    template<typename Handle>
+    VkResult createObject(Handle* pHandle)
+    {
+        *pHandle = toHandle<Handle>(new NullObject());
+        return VK_SUCCESS;
+    }
+
+    void destroyObject(NullObject* object)
+    {
+        if (object == nullptr)
+            return;
+        for (NullObject* child : object->children)
+            destroyObject(child);
+        delete object;
+    }
+
+    template<typename Handle>
+    void destroyHandle(Handle handle) { destroyObject(toObject(handle)); }
+
+    // the usual two calls enumeration: count, then (up to count) items
+    template<typename T>
+    VkResult enumerate(const T* items, uint32_t itemCount, uint32_t* pCount, T* pItems)
+    {
+        if (pItems == nullptr)
+        {
+            *pCount = itemCount;
+            return VK_SUCCESS;
+        }
+        const uint32_t n_copied = std::min(*pCount, itemCount);
+        std::copy(items, items + n_copied, pItems);
+        *pCount = n_copied;
+        return n_copied < itemCount ? VK_INCOMPLETE : VK_SUCCESS;
+    }
+
+    const VkBaseInStructure* findInChain(const void* pNext, VkStructureType sType)
+    {
+        for (const VkBaseInStructure* item = static_cast<const VkBaseInStructure*>(pNext); item != nullptr; item = item->pNext)
+        {
+            if (item->sType == sType)
+                return item;
+        }
+        return nullptr;
+    }
+
+    VkExtensionProperties makeExtension(const char* name)
+    {
+        VkExtensionProperties extension{};
+        strncpy(extension.extensionName, name, VK_MAX_EXTENSION_NAME_SIZE - 1);
+        extension.specVersion = 1;
+        return extension;
+    }
+}
+
+#define NULL_BACKEND_CALL()     s_callCount.fetch_add(1, std::memory_order_relaxed)
+
+uint64_t getNullBackendCallCount()
+{
+    return s_callCount.load(std::memory_order_relaxed);
+}
+
+
+// ----------------------------<<  Instance  >>--------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(const char*, uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+{
+    NULL_BACKEND_CALL();
+    const VkExtensionProperties extensions[] = {
+        makeExtension(VK_KHR_SURFACE_EXTENSION_NAME),
+        makeExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME),
+        makeExtension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME),
+    };
+    return enumerate(extensions, 3, pPropertyCount, pProperties);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(uint32_t* pPropertyCount, VkLayerProperties* pProperties)
+{
+    NULL_BACKEND_CALL();
+    // accepted, so that debug builds run too. Nothing is validated.
+    VkLayerProperties layer{};
+    strncpy(layer.layerName, "VK_LAYER_KHRONOS_validation", VK_MAX_EXTENSION_NAME_SIZE - 1);
+    strncpy(layer.description, "null backend, no validation", VK_MAX_DESCRIPTION_SIZE - 1);
+    layer.specVersion = VK_API_VERSION_1_2;
+    return enumerate(&layer, 1, pPropertyCount, pProperties);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(const VkInstanceCreateInfo*, const VkAllocationCallbacks*, VkInstance* pInstance)
+{
+    NULL_BACKEND_CALL();
+    NullObject* instance = new NullObject();
+    instance->children.push_back(new NullObject());     // the physical device
+    *pInstance = toHandle<VkInstance>(instance);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(instance);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(VkInstance instance, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices)
+{
+    NULL_BACKEND_CALL();
+    const VkPhysicalDevice physicalDevice = toHandle<VkPhysicalDevice>(toObject(instance)->children[0]);
+    return enumerate(&physicalDevice, 1, pPhysicalDeviceCount, pPhysicalDevices);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL nullCreateDebugUtilsMessengerEXT(VkInstance, const VkDebugUtilsMessengerCreateInfoEXT*,
+                                                                      const VkAllocationCallbacks*, VkDebugUtilsMessengerEXT* pMessenger)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pMessenger);
+}
+
+static VKAPI_ATTR void VKAPI_CALL nullDestroyDebugUtilsMessengerEXT(VkInstance, VkDebugUtilsMessengerEXT messenger, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(messenger);
+}
+
+
+// ------------------------<<  Physical Device  >>-----------------------------
+//
+//  A discrete GPU with every feature, a single graphics/compute/present
+//  queue family, one device local and one host visible memory type.
+//
+// ----------------------------------------------------------------------------
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties* pProperties)
+{
+    NULL_BACKEND_CALL();
+    *pProperties = VkPhysicalDeviceProperties{};
+    pProperties->apiVersion     = VK_API_VERSION_1_2;
+    pProperties->deviceType     = VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+    strncpy(pProperties->deviceName, NULL_DEVICE_NAME, VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+
+    VkPhysicalDeviceLimits& limits = pProperties->limits;
+    limits.maxImageDimension1D              = 16384;
+    limits.maxImageDimension2D              = 16384;
+    limits.maxImageDimension3D              = 2048;
+    limits.maxImageArrayLayers              = 2048;
+    limits.maxFramebufferWidth              = 16384;
+    limits.maxFramebufferHeight             = 16384;
+    limits.maxFramebufferLayers             = 2048;
+    limits.maxColorAttachments              = 8;
+    limits.maxViewports                     = 16;
+    limits.maxBoundDescriptorSets           = 32;
+    limits.maxPushConstantsSize             = 256;
+    limits.maxSamplerAnisotropy             = 16.0f;
+    limits.maxComputeWorkGroupInvocations   = 1024;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        limits.maxComputeWorkGroupCount[i]  = 65535;
+        limits.maxComputeWorkGroupSize[i]   = i < 2 ? 1024 : 64;
+    }
+    limits.framebufferColorSampleCounts     = VK_SAMPLE_COUNT_1_BIT | VK_SAMPLE_COUNT_2_BIT | VK_SAMPLE_COUNT_4_BIT | VK_SAMPLE_COUNT_8_BIT;
+    limits.framebufferDepthSampleCounts     = limits.framebufferColorSampleCounts;
+    limits.minUniformBufferOffsetAlignment  = NULL_BUFFER_ALIGNMENT;
+    limits.minStorageBufferOffsetAlignment  = NULL_BUFFER_ALIGNMENT;
+    limits.nonCoherentAtomSize              = 64;
+    limits.timestampPeriod                  = 1.0f;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures(VkPhysicalDevice, VkPhysicalDeviceFeatures* pFeatures)
+{
+    NULL_BACKEND_CALL();
+    // only VkBool32 members
+    VkBool32* features = reinterpret_cast<VkBool32*>(pFeatures);
+    std::fill(features, features + sizeof(VkPhysicalDeviceFeatures) / sizeof(VkBool32), VK_TRUE);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2* pFeatures)
+{
+    vkGetPhysicalDeviceFeatures(physicalDevice, &pFeatures->features);
+    for (VkBaseOutStructure* item = static_cast<VkBaseOutStructure*>(pFeatures->pNext); item != nullptr; item = item->pNext)
+    {
+        if (item->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES)
+            reinterpret_cast<VkPhysicalDeviceTimelineSemaphoreFeatures*>(item)->timelineSemaphore = VK_TRUE;
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceFormatProperties(VkPhysicalDevice, VkFormat, VkFormatProperties* pFormatProperties)
+{
+    NULL_BACKEND_CALL();
+    const VkFormatFeatureFlags allFeatures = ~VkFormatFeatureFlags(0);
+    pFormatProperties->linearTilingFeatures     = allFeatures;
+    pFormatProperties->optimalTilingFeatures    = allFeatures;
+    pFormatProperties->bufferFeatures           = allFeatures;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties)
+{
+    NULL_BACKEND_CALL();
+    *pMemoryProperties = VkPhysicalDeviceMemoryProperties{};
+    pMemoryProperties->memoryTypeCount                  = 2;
+    pMemoryProperties->memoryTypes[0].propertyFlags     = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    pMemoryProperties->memoryTypes[0].heapIndex         = 0;
+    pMemoryProperties->memoryTypes[NULL_HOST_VISIBLE_TYPE].propertyFlags    = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                                                              VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    pMemoryProperties->memoryTypes[NULL_HOST_VISIBLE_TYPE].heapIndex        = 1;
+    pMemoryProperties->memoryHeapCount                  = 2;
+    pMemoryProperties->memoryHeaps[0].size              = NULL_HEAP_SIZE;
+    pMemoryProperties->memoryHeaps[0].flags             = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    pMemoryProperties->memoryHeaps[1].size              = NULL_HEAP_SIZE;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties2* pMemoryProperties)
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &pMemoryProperties->memoryProperties);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice, uint32_t* pQueueFamilyPropertyCount,
+                                                                    VkQueueFamilyProperties* pQueueFamilyProperties)
+{
+    NULL_BACKEND_CALL();
+    VkQueueFamilyProperties queueFamily{};
+    queueFamily.queueFlags                  = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    queueFamily.queueCount                  = 1;
+    queueFamily.timestampValidBits          = 64;
+    queueFamily.minImageTransferGranularity = { 1, 1, 1 };
+    enumerate(&queueFamily, 1, pQueueFamilyPropertyCount, pQueueFamilyProperties);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(VkPhysicalDevice, const char*, uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+{
+    NULL_BACKEND_CALL();
+    const VkExtensionProperties extensions[] = {
+        makeExtension(VK_KHR_SWAPCHAIN_EXTENSION_NAME),
+        makeExtension("VK_KHR_portability_subset"),
+    };
+    return enumerate(extensions, 2, pPropertyCount, pProperties);
+}
+
+
+// -----------------------------<<  Surface  >>--------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceSurfaceSupportKHR(VkPhysicalDevice, uint32_t, VkSurfaceKHR, VkBool32* pSupported)
+{
+    NULL_BACKEND_CALL();
+    *pSupported = VK_TRUE;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceSurfaceCapabilitiesKHR(VkPhysicalDevice, VkSurfaceKHR surface, VkSurfaceCapabilitiesKHR* pSurfaceCapabilities)
+{
+    NULL_BACKEND_CALL();
+    *pSurfaceCapabilities = VkSurfaceCapabilitiesKHR{};
+    pSurfaceCapabilities->minImageCount             = 2;
+    pSurfaceCapabilities->maxImageCount             = 8;
+    pSurfaceCapabilities->currentExtent             = toObject(surface)->extent;
+    pSurfaceCapabilities->minImageExtent            = { 1, 1 };
+    pSurfaceCapabilities->maxImageExtent            = { 16384, 16384 };
+    pSurfaceCapabilities->maxImageArrayLayers       = 1;
+    pSurfaceCapabilities->supportedTransforms       = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    pSurfaceCapabilities->currentTransform          = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    pSurfaceCapabilities->supportedCompositeAlpha   = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    pSurfaceCapabilities->supportedUsageFlags       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                                                      VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceSurfaceFormatsKHR(VkPhysicalDevice, VkSurfaceKHR, uint32_t* pSurfaceFormatCount,
+                                                                    VkSurfaceFormatKHR* pSurfaceFormats)
+{
+    NULL_BACKEND_CALL();
+    const VkSurfaceFormatKHR formats[] = {
+        { VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR },
+        { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR },
+    };
+    return enumerate(formats, 2, pSurfaceFormatCount, pSurfaceFormats);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPhysicalDeviceSurfacePresentModesKHR(VkPhysicalDevice, VkSurfaceKHR, uint32_t* pPresentModeCount,
+                                                                         VkPresentModeKHR* pPresentModes)
+{
+    NULL_BACKEND_CALL();
+    const VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+    return enumerate(presentModes, 3, pPresentModeCount, pPresentModes);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroySurfaceKHR(VkInstance, VkSurfaceKHR surface, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(surface);
+}
+
+
+// -----------------------------<<  Device  >>---------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(VkPhysicalDevice, const VkDeviceCreateInfo*, const VkAllocationCallbacks*, VkDevice* pDevice)
+{
+    NULL_BACKEND_CALL();
+    NullObject* device = new NullObject();
+    device->children.push_back(new NullObject());   // the queue, of every family
+    *pDevice = toHandle<VkDevice>(device);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(VkDevice device, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(device);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(VkDevice device, uint32_t, uint32_t, VkQueue* pQueue)
+{
+    NULL_BACKEND_CALL();
+    *pQueue = toHandle<VkQueue>(toObject(device)->children[0]);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkDeviceWaitIdle(VkDevice)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+
+// -----------------------------<<  Memory  >>---------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks*, VkDeviceMemory* pMemory)
+{
+    NULL_BACKEND_CALL();
+    NullObject* memory = new NullObject();
+    memory->size = pAllocateInfo->allocationSize;
+    // device local memory is never read nor written by the host
+    if (pAllocateInfo->memoryTypeIndex == NULL_HOST_VISIBLE_TYPE)
+        memory->memory.resize(pAllocateInfo->allocationSize);
+    *pMemory = toHandle<VkDeviceMemory>(memory);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(memory);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void** ppData)
+{
+    NULL_BACKEND_CALL();
+    NullObject* object = toObject(memory);
+    if (object->memory.empty())
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    *ppData = object->memory.data() + offset;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice, VkDeviceMemory)
+{
+    NULL_BACKEND_CALL();
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkFlushMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange*)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkInvalidateMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange*)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+
+// ------------------------<<  Buffers & Images  >>----------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(VkDevice, const VkBufferCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkBuffer* pBuffer)
+{
+    NULL_BACKEND_CALL();
+    NullObject* buffer = new NullObject();
+    buffer->size = (pCreateInfo->size + NULL_BUFFER_ALIGNMENT - 1) / NULL_BUFFER_ALIGNMENT * NULL_BUFFER_ALIGNMENT;
+    *pBuffer = toHandle<VkBuffer>(buffer);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(buffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice, VkBuffer buffer, VkMemoryRequirements* pMemoryRequirements)
+{
+    NULL_BACKEND_CALL();
+    pMemoryRequirements->size           = toObject(buffer)->size;
+    pMemoryRequirements->alignment      = NULL_BUFFER_ALIGNMENT;
+    pMemoryRequirements->memoryTypeBits = NULL_MEMORY_TYPE_BITS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImage(VkDevice, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkImage* pImage)
+{
+    NULL_BACKEND_CALL();
+    // 8 bytes per texel at most (i.e. RGBA16F), the mip chain fits in as much again
+    const VkExtent3D& extent = pCreateInfo->extent;
+    VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * extent.depth * pCreateInfo->arrayLayers * pCreateInfo->samples * 8;
+    if (pCreateInfo->mipLevels > 1)
+        size *= 2;
+
+    NullObject* image = new NullObject();
+    image->size = (size + NULL_IMAGE_ALIGNMENT - 1) / NULL_IMAGE_ALIGNMENT * NULL_IMAGE_ALIGNMENT;
+    *pImage = toHandle<VkImage>(image);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(image);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage image, VkMemoryRequirements* pMemoryRequirements)
+{
+    NULL_BACKEND_CALL();
+    pMemoryRequirements->size           = toObject(image)->size;
+    pMemoryRequirements->alignment      = NULL_IMAGE_ALIGNMENT;
+    pMemoryRequirements->memoryTypeBits = NULL_MEMORY_TYPE_BITS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateImageView(VkDevice, const VkImageViewCreateInfo*, const VkAllocationCallbacks*, VkImageView* pView)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pView);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyImageView(VkDevice, VkImageView imageView, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(imageView);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSampler(VkDevice, const VkSamplerCreateInfo*, const VkAllocationCallbacks*, VkSampler* pSampler)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pSampler);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroySampler(VkDevice, VkSampler sampler, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(sampler);
+}
+
+
+// ----------------------------<<  Pipelines  >>-------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateShaderModule(VkDevice, const VkShaderModuleCreateInfo*, const VkAllocationCallbacks*, VkShaderModule* pShaderModule)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pShaderModule);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyShaderModule(VkDevice, VkShaderModule shaderModule, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(shaderModule);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreatePipelineCache(VkDevice, const VkPipelineCacheCreateInfo*, const VkAllocationCallbacks*, VkPipelineCache* pPipelineCache)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pPipelineCache);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyPipelineCache(VkDevice, VkPipelineCache pipelineCache, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(pipelineCache);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(VkDevice, VkPipelineCache, size_t* pDataSize, void*)
+{
+    NULL_BACKEND_CALL();
+    *pDataSize = 0;     // nothing is saved
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateGraphicsPipelines(VkDevice, VkPipelineCache, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo*,
+                                                         const VkAllocationCallbacks*, VkPipeline* pPipelines)
+{
+    NULL_BACKEND_CALL();
+    for (uint32_t i = 0; i < createInfoCount; ++i)
+        createObject(&pPipelines[i]);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateComputePipelines(VkDevice, VkPipelineCache, uint32_t createInfoCount, const VkComputePipelineCreateInfo*,
+                                                        const VkAllocationCallbacks*, VkPipeline* pPipelines)
+{
+    NULL_BACKEND_CALL();
+    for (uint32_t i = 0; i < createInfoCount; ++i)
+        createObject(&pPipelines[i]);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyPipeline(VkDevice, VkPipeline pipeline, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(pipeline);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreatePipelineLayout(VkDevice, const VkPipelineLayoutCreateInfo*, const VkAllocationCallbacks*, VkPipelineLayout* pPipelineLayout)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pPipelineLayout);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyPipelineLayout(VkDevice, VkPipelineLayout pipelineLayout, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(pipelineLayout);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass(VkDevice, const VkRenderPassCreateInfo*, const VkAllocationCallbacks*, VkRenderPass* pRenderPass)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pRenderPass);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyRenderPass(VkDevice, VkRenderPass renderPass, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(renderPass);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateFramebuffer(VkDevice, const VkFramebufferCreateInfo*, const VkAllocationCallbacks*, VkFramebuffer* pFramebuffer)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pFramebuffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyFramebuffer(VkDevice, VkFramebuffer framebuffer, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(framebuffer);
+}
+
+
+// ---------------------------<<  Descriptors  >>------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateDescriptorSetLayout(VkDevice, const VkDescriptorSetLayoutCreateInfo*, const VkAllocationCallbacks*,
+                                                           VkDescriptorSetLayout* pSetLayout)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pSetLayout);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyDescriptorSetLayout(VkDevice, VkDescriptorSetLayout descriptorSetLayout, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(descriptorSetLayout);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateDescriptorPool(VkDevice, const VkDescriptorPoolCreateInfo*, const VkAllocationCallbacks*, VkDescriptorPool* pDescriptorPool)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pDescriptorPool);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyDescriptorPool(VkDevice, VkDescriptorPool descriptorPool, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(descriptorPool);     // its sets too
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateDescriptorSets(VkDevice, const VkDescriptorSetAllocateInfo* pAllocateInfo, VkDescriptorSet* pDescriptorSets)
+{
+    NULL_BACKEND_CALL();
+    NullObject* pool = toObject(pAllocateInfo->descriptorPool);
+    for (uint32_t i = 0; i < pAllocateInfo->descriptorSetCount; ++i)
+    {
+        pool->children.push_back(new NullObject());
+        pDescriptorSets[i] = toHandle<VkDescriptorSet>(pool->children.back());
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUpdateDescriptorSets(VkDevice, uint32_t, const VkWriteDescriptorSet*, uint32_t, const VkCopyDescriptorSet*)
+{
+    NULL_BACKEND_CALL();
+}
+
+
+// -------------------------<<  Command Buffers  >>----------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateCommandPool(VkDevice, const VkCommandPoolCreateInfo*, const VkAllocationCallbacks*, VkCommandPool* pCommandPool)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pCommandPool);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyCommandPool(VkDevice, VkCommandPool commandPool, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(commandPool);        // its command buffers too
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo* pAllocateInfo, VkCommandBuffer* pCommandBuffers)
+{
+    NULL_BACKEND_CALL();
+    NullObject* pool = toObject(pAllocateInfo->commandPool);
+    for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; ++i)
+    {
+        pool->children.push_back(new NullObject());
+        pCommandBuffers[i] = toHandle<VkCommandBuffer>(pool->children.back());
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeCommandBuffers(VkDevice, VkCommandPool commandPool, uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers)
+{
+    NULL_BACKEND_CALL();
+    std::vector<NullObject*>& commandBuffers = toObject(commandPool)->children;
+    for (uint32_t i = 0; i < commandBufferCount; ++i)
+    {
+        auto it = std::find(commandBuffers.begin(), commandBuffers.end(), toObject(pCommandBuffers[i]));
+        if (it == commandBuffers.end())
+            continue;
+        destroyObject(*it);
+        commandBuffers.erase(it);
+    }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer, const VkCommandBufferBeginInfo*)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEndCommandBuffer(VkCommandBuffer)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+// commands are not recorded, they are only counted
+VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer, const VkRenderPassBeginInfo*, VkSubpassContents) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t,
+                                                   const VkDescriptorSet*, uint32_t, const uint32_t*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdBindVertexBuffers(VkCommandBuffer, uint32_t, uint32_t, const VkBuffer*, const VkDeviceSize*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdBindIndexBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkIndexType) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t, const void*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdSetViewport(VkCommandBuffer, uint32_t, uint32_t, const VkViewport*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdSetScissor(VkCommandBuffer, uint32_t, uint32_t, const VkRect2D*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexed(VkCommandBuffer, uint32_t, uint32_t, uint32_t, int32_t, uint32_t) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdDispatch(VkCommandBuffer, uint32_t, uint32_t, uint32_t) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags, VkDependencyFlags,
+                                                uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*,
+                                                uint32_t, const VkImageMemoryBarrier*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdCopyBuffer(VkCommandBuffer, VkBuffer, VkBuffer, uint32_t, const VkBufferCopy*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdCopyBufferToImage(VkCommandBuffer, VkBuffer, VkImage, VkImageLayout, uint32_t, const VkBufferImageCopy*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdCopyImageToBuffer(VkCommandBuffer, VkImage, VkImageLayout, VkBuffer, uint32_t, const VkBufferImageCopy*) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdBlitImage(VkCommandBuffer, VkImage, VkImageLayout, VkImage, VkImageLayout, uint32_t, const VkImageBlit*, VkFilter) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdResetQueryPool(VkCommandBuffer, VkQueryPool, uint32_t, uint32_t) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdBeginQuery(VkCommandBuffer, VkQueryPool, uint32_t, VkQueryControlFlags) { NULL_BACKEND_CALL(); }
+VKAPI_ATTR void VKAPI_CALL vkCmdEndQuery(VkCommandBuffer, VkQueryPool, uint32_t) { NULL_BACKEND_CALL(); }
+
+
+// --------------------------<<  Synchronization  >>---------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSemaphore(VkDevice, const VkSemaphoreCreateInfo* pCreateInfo, const VkAllocationCallbacks*, VkSemaphore* pSemaphore)
+{
+    NULL_BACKEND_CALL();
+    NullObject* semaphore = new NullObject();
+    if (const VkBaseInStructure* item = findInChain(pCreateInfo->pNext, VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO))
+        semaphore->value = reinterpret_cast<const VkSemaphoreTypeCreateInfo*>(item)->initialValue;
+    *pSemaphore = toHandle<VkSemaphore>(semaphore);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroySemaphore(VkDevice, VkSemaphore semaphore, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(semaphore);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetSemaphoreCounterValue(VkDevice, VkSemaphore semaphore, uint64_t* pValue)
+{
+    NULL_BACKEND_CALL();
+    *pValue = toObject(semaphore)->value.load(std::memory_order_acquire);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkWaitSemaphores(VkDevice, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t)
+{
+    NULL_BACKEND_CALL();
+    // the work is done on submission: a value that isn't reached yet never will be
+    for (uint32_t i = 0; i < pWaitInfo->semaphoreCount; ++i)
+    {
+        if (toObject(pWaitInfo->pSemaphores[i])->value.load(std::memory_order_acquire) < pWaitInfo->pValues[i])
+            return VK_TIMEOUT;
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence)
+{
+    NULL_BACKEND_CALL();
+    // executed right away: signals the timeline semaphores
+    for (uint32_t i = 0; i < submitCount; ++i)
+    {
+        const VkSubmitInfo& submit = pSubmits[i];
+        const VkBaseInStructure* item = findInChain(submit.pNext, VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO);
+        if (item == nullptr)
+            continue;
+
+        const VkTimelineSemaphoreSubmitInfo* timelineInfo = reinterpret_cast<const VkTimelineSemaphoreSubmitInfo*>(item);
+        for (uint32_t j = 0; j < submit.signalSemaphoreCount && j < timelineInfo->signalSemaphoreValueCount; ++j)
+        {
+            std::atomic<uint64_t>& value = toObject(submit.pSignalSemaphores[j])->value;
+            const uint64_t signalValue = timelineInfo->pSignalSemaphoreValues[j];
+            uint64_t currentValue = value.load(std::memory_order_relaxed);
+            while (currentValue < signalValue &&
+                   !value.compare_exchange_weak(currentValue, signalValue, std::memory_order_acq_rel))
+                ;
+        }
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueWaitIdle(VkQueue)
+{
+    NULL_BACKEND_CALL();
+    return VK_SUCCESS;
+}
+
+
+// ----------------------------<<  Swapchain  >>-------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(VkDevice, const VkSwapchainCreateInfoKHR* pCreateInfo, const VkAllocationCallbacks*,
+                                                    VkSwapchainKHR* pSwapchain)
+{
+    NULL_BACKEND_CALL();
+    NullObject* swapchain = new NullObject();
+    swapchain->extent = pCreateInfo->imageExtent;
+    for (uint32_t i = 0; i < pCreateInfo->minImageCount; ++i)
+        swapchain->children.push_back(new NullObject());
+    *pSwapchain = toHandle<VkSwapchainKHR>(swapchain);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(VkDevice, VkSwapchainKHR swapchain, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(swapchain);  // its images too
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetSwapchainImagesKHR(VkDevice, VkSwapchainKHR swapchain, uint32_t* pSwapchainImageCount, VkImage* pSwapchainImages)
+{
+    NULL_BACKEND_CALL();
+    std::vector<VkImage> images;
+    for (NullObject* image : toObject(swapchain)->children)
+        images.push_back(toHandle<VkImage>(image));
+    return enumerate(images.data(), static_cast<uint32_t>(images.size()), pSwapchainImageCount, pSwapchainImages);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAcquireNextImageKHR(VkDevice, VkSwapchainKHR swapchain, uint64_t, VkSemaphore, VkFence, uint32_t* pImageIndex)
+{
+    NULL_BACKEND_CALL();
+    NullObject* object = toObject(swapchain);
+    *pImageIndex = object->nextImage;
+    object->nextImage = (object->nextImage + 1) % static_cast<uint32_t>(object->children.size());
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(VkQueue, const VkPresentInfoKHR* pPresentInfo)
+{
+    NULL_BACKEND_CALL();
+    if (pPresentInfo->pResults != nullptr)
+        std::fill(pPresentInfo->pResults, pPresentInfo->pResults + pPresentInfo->swapchainCount, VK_SUCCESS);
+    return VK_SUCCESS;
+}
+
+
+// -----------------------------<<  Queries  >>--------------------------------
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateQueryPool(VkDevice, const VkQueryPoolCreateInfo*, const VkAllocationCallbacks*, VkQueryPool* pQueryPool)
+{
+    NULL_BACKEND_CALL();
+    return createObject(pQueryPool);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyQueryPool(VkDevice, VkQueryPool queryPool, const VkAllocationCallbacks*)
+{
+    NULL_BACKEND_CALL();
+    destroyHandle(queryPool);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetQueryPoolResults(VkDevice, VkQueryPool, uint32_t, uint32_t, size_t dataSize, void* pData,
+                                                     VkDeviceSize, VkQueryResultFlags)
+{
+    NULL_BACKEND_CALL();
+    memset(pData, 0, dataSize);
+    return VK_SUCCESS;
+}
+
+
+// --------------------------<<  Dispatch Table  >>----------------------------
+//
+//  What vkGetInstanceProcAddr and vkGetDeviceProcAddr resolve: every entry
+//  point of this file, by name.
+//
+// ----------------------------------------------------------------------------
+
+#define NULL_BACKEND_ENTRY(_name)               { #_name, reinterpret_cast<PFN_vkVoidFunction>(_name) }
+#define NULL_BACKEND_EXTENSION(_name, _stub)    { #_name, reinterpret_cast<PFN_vkVoidFunction>(_stub) }
+
+struct DispatchEntry
+{
+    const char*         name;
+    PFN_vkVoidFunction  function;
+};
+
+static const DispatchEntry s_dispatchTable[] = {
+    NULL_BACKEND_ENTRY(vkEnumerateInstanceExtensionProperties),
+    NULL_BACKEND_ENTRY(vkEnumerateInstanceLayerProperties),
+    NULL_BACKEND_ENTRY(vkCreateInstance),
+    NULL_BACKEND_ENTRY(vkDestroyInstance),
+    NULL_BACKEND_ENTRY(vkEnumeratePhysicalDevices),
+    NULL_BACKEND_ENTRY(vkGetDeviceProcAddr),
+    NULL_BACKEND_EXTENSION(vkCreateDebugUtilsMessengerEXT, nullCreateDebugUtilsMessengerEXT),
+    NULL_BACKEND_EXTENSION(vkDestroyDebugUtilsMessengerEXT, nullDestroyDebugUtilsMessengerEXT),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceProperties),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceFeatures),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceFeatures2),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceFormatProperties),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceMemoryProperties),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceMemoryProperties2),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceQueueFamilyProperties),
+    NULL_BACKEND_ENTRY(vkEnumerateDeviceExtensionProperties),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceSurfaceSupportKHR),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceSurfaceCapabilitiesKHR),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceSurfaceFormatsKHR),
+    NULL_BACKEND_ENTRY(vkGetPhysicalDeviceSurfacePresentModesKHR),
+    NULL_BACKEND_ENTRY(vkDestroySurfaceKHR),
+    NULL_BACKEND_ENTRY(vkCreateDevice),
+    NULL_BACKEND_ENTRY(vkDestroyDevice),
+    NULL_BACKEND_ENTRY(vkGetDeviceQueue),
+    NULL_BACKEND_ENTRY(vkDeviceWaitIdle),
+    NULL_BACKEND_ENTRY(vkAllocateMemory),
+    NULL_BACKEND_ENTRY(vkFreeMemory),
+    NULL_BACKEND_ENTRY(vkMapMemory),
+    NULL_BACKEND_ENTRY(vkUnmapMemory),
+    NULL_BACKEND_ENTRY(vkFlushMappedMemoryRanges),
+    NULL_BACKEND_ENTRY(vkInvalidateMappedMemoryRanges),
+    NULL_BACKEND_ENTRY(vkCreateBuffer),
+    NULL_BACKEND_ENTRY(vkDestroyBuffer),
+    NULL_BACKEND_ENTRY(vkGetBufferMemoryRequirements),
+    NULL_BACKEND_ENTRY(vkBindBufferMemory),
+    NULL_BACKEND_ENTRY(vkCreateImage),
+    NULL_BACKEND_ENTRY(vkDestroyImage),
+    NULL_BACKEND_ENTRY(vkGetImageMemoryRequirements),
+    NULL_BACKEND_ENTRY(vkBindImageMemory),
+    NULL_BACKEND_ENTRY(vkCreateImageView),
+    NULL_BACKEND_ENTRY(vkDestroyImageView),
+    NULL_BACKEND_ENTRY(vkCreateSampler),
+    NULL_BACKEND_ENTRY(vkDestroySampler),
+    NULL_BACKEND_ENTRY(vkCreateShaderModule),
+    NULL_BACKEND_ENTRY(vkDestroyShaderModule),
+    NULL_BACKEND_ENTRY(vkCreatePipelineCache),
+    NULL_BACKEND_ENTRY(vkDestroyPipelineCache),
+    NULL_BACKEND_ENTRY(vkGetPipelineCacheData),
+    NULL_BACKEND_ENTRY(vkCreateGraphicsPipelines),
+    NULL_BACKEND_ENTRY(vkCreateComputePipelines),
+    NULL_BACKEND_ENTRY(vkDestroyPipeline),
+    NULL_BACKEND_ENTRY(vkCreatePipelineLayout),
+    NULL_BACKEND_ENTRY(vkDestroyPipelineLayout),
+    NULL_BACKEND_ENTRY(vkCreateRenderPass),
+    NULL_BACKEND_ENTRY(vkDestroyRenderPass),
+    NULL_BACKEND_ENTRY(vkCreateFramebuffer),
+    NULL_BACKEND_ENTRY(vkDestroyFramebuffer),
+    NULL_BACKEND_ENTRY(vkCreateDescriptorSetLayout),
+    NULL_BACKEND_ENTRY(vkDestroyDescriptorSetLayout),
+    NULL_BACKEND_ENTRY(vkCreateDescriptorPool),
+    NULL_BACKEND_ENTRY(vkDestroyDescriptorPool),
+    NULL_BACKEND_ENTRY(vkAllocateDescriptorSets),
+    NULL_BACKEND_ENTRY(vkUpdateDescriptorSets),
+    NULL_BACKEND_ENTRY(vkCreateCommandPool),
+    NULL_BACKEND_ENTRY(vkDestroyCommandPool),
+    NULL_BACKEND_ENTRY(vkAllocateCommandBuffers),
+    NULL_BACKEND_ENTRY(vkFreeCommandBuffers),
+    NULL_BACKEND_ENTRY(vkBeginCommandBuffer),
+    NULL_BACKEND_ENTRY(vkEndCommandBuffer),
+    NULL_BACKEND_ENTRY(vkCmdBeginRenderPass),
+    NULL_BACKEND_ENTRY(vkCmdEndRenderPass),
+    NULL_BACKEND_ENTRY(vkCmdBindPipeline),
+    NULL_BACKEND_ENTRY(vkCmdBindDescriptorSets),
+    NULL_BACKEND_ENTRY(vkCmdBindVertexBuffers),
+    NULL_BACKEND_ENTRY(vkCmdBindIndexBuffer),
+    NULL_BACKEND_ENTRY(vkCmdPushConstants),
+    NULL_BACKEND_ENTRY(vkCmdSetViewport),
+    NULL_BACKEND_ENTRY(vkCmdSetScissor),
+    NULL_BACKEND_ENTRY(vkCmdDrawIndexed),
+    NULL_BACKEND_ENTRY(vkCmdDispatch),
+    NULL_BACKEND_ENTRY(vkCmdPipelineBarrier),
+    NULL_BACKEND_ENTRY(vkCmdCopyBuffer),
+    NULL_BACKEND_ENTRY(vkCmdCopyBufferToImage),
+    NULL_BACKEND_ENTRY(vkCmdCopyImageToBuffer),
+    NULL_BACKEND_ENTRY(vkCmdBlitImage),
+    NULL_BACKEND_ENTRY(vkCmdResetQueryPool),
+    NULL_BACKEND_ENTRY(vkCmdBeginQuery),
+    NULL_BACKEND_ENTRY(vkCmdEndQuery),
+    NULL_BACKEND_ENTRY(vkCreateSemaphore),
+    NULL_BACKEND_ENTRY(vkDestroySemaphore),
+    NULL_BACKEND_ENTRY(vkGetSemaphoreCounterValue),
+    NULL_BACKEND_ENTRY(vkWaitSemaphores),
+    NULL_BACKEND_ENTRY(vkQueueSubmit),
+    NULL_BACKEND_ENTRY(vkQueueWaitIdle),
+    NULL_BACKEND_ENTRY(vkCreateSwapchainKHR),
+    NULL_BACKEND_ENTRY(vkDestroySwapchainKHR),
+    NULL_BACKEND_ENTRY(vkGetSwapchainImagesKHR),
+    NULL_BACKEND_ENTRY(vkAcquireNextImageKHR),
+    NULL_BACKEND_ENTRY(vkQueuePresentKHR),
+    NULL_BACKEND_ENTRY(vkCreateQueryPool),
+    NULL_BACKEND_ENTRY(vkDestroyQueryPool),
+    NULL_BACKEND_ENTRY(vkGetQueryPoolResults),
+};
+
+static PFN_vkVoidFunction findEntryPoint(const char* pName)
+{
+    for (const DispatchEntry& entry : s_dispatchTable)
+    {
+        if (strcmp(entry.name, pName) == 0)
+            return entry.function;
+    }
+    return nullptr;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance, const char* pName)
+{
+    NULL_BACKEND_CALL();
+    return findEntryPoint(pName);
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice, const char* pName)
+{
+    NULL_BACKEND_CALL();
+    return findEntryPoint(pName);
+}
+
+
+// ------------------------------<<  GLFW  >>----------------------------------
+//
+//  A window that is never shown: no display is needed. It never closes
+//  either, and its size never changes.
+//
+// ----------------------------------------------------------------------------
+
+struct GLFWwindow
+{
+    int                     width;
+    int                     height;
+    void*                   userPointer;
+    GLFWframebuffersizefun  framebufferSizeCallback;
+};
+
+int glfwInit()
+{
+    return GLFW_TRUE;
+}
+
+void glfwTerminate()
+{
+}
+
+void glfwWindowHint(int, int)
+{
+}
+
+GLFWwindow* glfwCreateWindow(int width, int height, const char*, GLFWmonitor*, GLFWwindow*)
+{
+    return new GLFWwindow{ width, height, nullptr, nullptr };
+}
+
+void glfwDestroyWindow(GLFWwindow* window)
+{
+    delete window;
+}
+
+void glfwSetWindowUserPointer(GLFWwindow* window, void* pointer)
+{
+    window->userPointer = pointer;
+}
+
+void* glfwGetWindowUserPointer(GLFWwindow* window)
+{
+    return window->userPointer;
+}
+
+GLFWframebuffersizefun glfwSetFramebufferSizeCallback(GLFWwindow* window, GLFWframebuffersizefun callback)
+{
+    std::swap(window->framebufferSizeCallback, callback);
+    return callback;
+}
+
+int glfwWindowShouldClose(GLFWwindow*)
+{
+    return GLFW_FALSE;
+}
+
+void glfwSetWindowTitle(GLFWwindow*, const char*)
+{
+}
+
+void glfwPollEvents()
+{
+}
+
+void glfwWaitEvents()
+{
+}
+
+void glfwGetFramebufferSize(GLFWwindow* window, int* width, int* height)
+{
+    *width  = window->width;
+    *height = window->height;
+}
+
+const char** glfwGetRequiredInstanceExtensions(uint32_t* count)
+{
+    static const char* extensions[] = { VK_KHR_SURFACE_EXTENSION_NAME };
+    *count = 1;
+    return extensions;
+}
+
+VkResult glfwCreateWindowSurface(VkInstance, GLFWwindow* window, const VkAllocationCallbacks*, VkSurfaceKHR* surface)
+{
+    NULL_BACKEND_CALL();
+    NullObject* object = new NullObject();
+    object->extent = { static_cast<uint32_t>(window->width), static_cast<uint32_t>(window->height) };
+    *surface = toHandle<VkSurfaceKHR>(object);
+    return VK_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "PipelineCompiler.h"
+#include "Common.h"
+#include "HostAllocator.h"
+
+#include <fstream>
+#include <stdexcept>
+
+
+// -------------------<<  Pipeline Compiler  >>------------------------
+
+PipelineCompiler::PipelineCompiler() :
+    m_device(VK_NULL_HANDLE),
+    m_pipelineCache(VK_NULL_HANDLE),
+    m_jobSystem(nullptr)
+{
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+    clean();
+}
+
+void PipelineCompiler::init(VkDevice device, const std::string& cachePath, JobSystem& jobSystem)
+{
+    m_device    = device;
+    m_cachePath = cachePath;
+    m_jobSystem = &jobSystem;
+
+    loadPipelineCache();
+
+    PRINTLN("Created Pipeline Compiler");
+}
+
+void PipelineCompiler::clean()
+{
+    if (m_device == VK_NULL_HANDLE)
+        return;
+
+    // the remaining builds finish before the cache goes away
+    m_jobSystem->wait(m_pendingBuilds);
+
+    savePipelineCache();
+    vkDestroyPipelineCache(m_device, m_pipelineCache, HostAllocator::getCallbacks());
+
+    m_pipelineCache = VK_NULL_HANDLE;
+    m_device        = VK_NULL_HANDLE;
+    m_jobSystem     = nullptr;
+}
+
+std::shared_future<VkPipeline> PipelineCompiler::compile(BuildFunction buildFunction, JobCounter* dependency)
+{
+    if (m_device == VK_NULL_HANDLE)
+        throw std::runtime_error("pipeline compiler is not running!");
+
+    // the request outlives this call, and is too large to be stored in a job
+    auto request = std::make_shared<BuildRequest>();
+    request->buildFunction = std::move(buildFunction);
+    std::shared_future<VkPipeline> future = request->promise.get_future().share();
+
+    auto buildJob = [this, request]() { build(*request); };
+    if (dependency != nullptr)
+        m_jobSystem->schedule(buildJob, &m_pendingBuilds, { dependency });
+    else
+        m_jobSystem->schedule(buildJob, &m_pendingBuilds);
+
+    return future;
+}
+
+void PipelineCompiler::build(BuildRequest& request)
+{
+    // exceptions (i.e. shader compile errors) are passed to the requester
+    try
+    {
+        request.promise.set_value(request.buildFunction(m_pipelineCache));
+    }
+    catch (...)
+    {
+        request.promise.set_exception(std::current_exception());
+    }
+}
+
+
+// ------------------------<<  Pipeline Cache  >>----------------------------
+//
+//  Driver-side cache of the compiled pipeline state. Saving it to the disk
+//  makes the next launch skip most of the compilation. The driver ignores
+//  the data that doesn't match the device (validated with the header).
+//
+// --------------------------------------------------------------------------
+
+void PipelineCompiler::loadPipelineCache()
+{
+    std::vector<char> cacheData;
+    std::ifstream file(m_cachePath, std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        cacheData.resize((size_t) file.tellg());
+        file.seekg(0);
+        file.read(cacheData.data(), cacheData.size());
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+    pipelineCacheCreateInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+    pipelineCacheCreateInfo.pInitialData    = cacheData.empty() ? nullptr : cacheData.data();
+
+    if (vkCreatePipelineCache(m_device, &pipelineCacheCreateInfo, HostAllocator::getCallbacks(), &m_pipelineCache) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline cache!");
+
+    PRINTLN_VERBOSE("Loaded pipeline cache (" << cacheData.size() << " bytes)");
+}
+
+void PipelineCompiler::savePipelineCache()
+{
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        return;
+
+    std::vector<char> cacheData(dataSize);
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+        return;
+
+    std::ofstream file(m_cachePath, std::ios::binary | std::ios::trunc);
+    if (file.is_open())
+        file.write(cacheData.data(), dataSize);
+}
@@ -0,0 +1,159 @@
+#include "Profiler.h"
+#include "Common.h"
+
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+
+// zones kept per thread, the oldest ones are overwritten
+#define PROFILER_ZONES_PER_THREAD 4096
+
+
+// -----------------------------< Internal >-----------------------------
+
+namespace
+{
+    struct ZoneRecord
+    {
+        const char* name;
+        uint64_t    startTime;
+        uint64_t    endTime;
+    };
+
+    struct ThreadZones
+    {
+        std::mutex  mutex;      // only contended while a report is taken
+        ZoneRecord  zones[PROFILER_ZONES_PER_THREAD];
+        uint64_t    n_recorded = 0;
+    };
+
+    // buffers of all the threads that ever recorded a zone. They are never
+    // released, so a report can still read the zones of finished threads.
+    struct ThreadZonesRegistry
+    {
+        std::mutex                                  mutex;
+        std::vector<std::unique_ptr<ThreadZones>>   threads;
+    };
+
+    ThreadZonesRegistry& getRegistry()
+    {
+        static ThreadZonesRegistry registry;
+        return registry;
+    }
+
+    ThreadZones& getThreadZones()
+    {
+        static thread_local ThreadZones* threadZones = nullptr;
+        if (threadZones == nullptr)
+        {
+            ThreadZonesRegistry& registry = getRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.threads.push_back(std::make_unique<ThreadZones>());
+            threadZones = registry.threads.back().get();
+        }
+        return *threadZones;
+    }
+}
+
+
+// -------------------------<<  Profiler  >>---------------------------
+
+uint64_t Profiler::now()
+{
+    // steady_clock rather than RDTSC: it is portable, and already backed by
+    // the TSC (through the vDSO) on the platforms we run on
+    static const auto s_originTime = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - s_originTime;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void Profiler::recordZone(const char* name, uint64_t startTime, uint64_t endTime)
+{
+    ThreadZones& threadZones = getThreadZones();
+
+    std::lock_guard<std::mutex> lock(threadZones.mutex);
+    ZoneRecord& zone = threadZones.zones[threadZones.n_recorded % PROFILER_ZONES_PER_THREAD];
+    zone.name       = name;
+    zone.startTime  = startTime;
+    zone.endTime    = endTime;
+    threadZones.n_recorded++;
+}
+
+void Profiler::printReport(const char* title, uint64_t startTime, const char* totalZoneName)
+{
+    struct ZoneSummary
+    {
+        const char* name;
+        uint32_t    count;
+        uint64_t    totalTime;
+        uint64_t    maxTime;
+    };
+    std::vector<ZoneSummary> summaries;
+
+    {
+        ThreadZonesRegistry& registry = getRegistry();
+        std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+        for (auto& threadZones : registry.threads)
+        {
+            std::lock_guard<std::mutex> lock(threadZones->mutex);
+
+            const uint64_t n_zones = std::min<uint64_t>(threadZones->n_recorded, PROFILER_ZONES_PER_THREAD);
+            for (uint64_t i = threadZones->n_recorded - n_zones; i < threadZones->n_recorded; ++i)
+            {
+                const ZoneRecord& zone = threadZones->zones[i % PROFILER_ZONES_PER_THREAD];
+                if (zone.startTime < startTime)
+                    continue;
+
+                // names are literals, but the same literal may have several addresses
+                auto summary = std::find_if(summaries.begin(), summaries.end(), [&zone](const ZoneSummary& s) {
+                    return std::strcmp(s.name, zone.name) == 0;
+                });
+                if (summary == summaries.end())
+                {
+                    summaries.push_back(ZoneSummary{ zone.name, 0, 0, 0 });
+                    summary = summaries.end() - 1;
+                }
+
+                const uint64_t duration = zone.endTime - zone.startTime;
+                summary->count++;
+                summary->totalTime += duration;
+                summary->maxTime    = std::max(summary->maxTime, duration);
+            }
+        }
+    }
+
+    std::sort(summaries.begin(), summaries.end(), [](const ZoneSummary& a, const ZoneSummary& b) {
+        return a.totalTime > b.totalTime;
+    });
+
+    uint64_t referenceTime = 0;
+    for (const auto& summary : summaries)
+        if (totalZoneName != nullptr && std::strcmp(summary.name, totalZoneName) == 0)
+            referenceTime = summary.totalTime;
+
+    PRINT_BAR_LINE();
+    PRINTLN(title);
+    PRINT_BAR_DOTS();
+    PRINTLN(std::left << std::setw(32) << "zone"
+            << std::right << std::setw(8) << "count"
+            << std::setw(12) << "total(ms)"
+            << std::setw(12) << "max(ms)"
+            << std::setw(8) << "%");
+    for (const auto& summary : summaries)
+    {
+        PRINT(std::left << std::setw(32) << summary.name
+              << std::right << std::setw(8) << summary.count
+              << std::fixed << std::setprecision(3)
+              << std::setw(12) << summary.totalTime / 1.0e6
+              << std::setw(12) << summary.maxTime / 1.0e6);
+        if (referenceTime > 0)
+            PRINT(std::setprecision(1) << std::setw(8) << 100.0 * summary.totalTime / referenceTime);
+        PRINTLN("" << std::defaultfloat);
+    }
+    PRINT_BAR_LINE();
+}
@@ -0,0 +1,546 @@
+#include "RenderGraph.h"
+#include "Common.h"
+#include "LinearArena.h"
+
+#include <stdexcept>
+#include <algorithm>     // std::max
+#include <cstdint>       // UINT32_MAX, INT64_MAX
+
+// accesses that produce data, to be made available to the next accesses
+#define WRITE_ACCESS_MASK   (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | \
+                             VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | \
+                             VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+
+
+const char* getImageUsageName(ImageUsage usage)
+{
+    switch (usage)
+    {
+    case ImageUsage::Undefined:                 return "undefined";
+    case ImageUsage::Acquired:                  return "acquired";
+    case ImageUsage::ColorAttachment:           return "color attachment";
+    case ImageUsage::ColorResolve:              return "color resolve";
+    case ImageUsage::DepthStencilAttachment:    return "depth attachment";
+    case ImageUsage::DepthStencilRead:          return "depth read";
+    case ImageUsage::SampledFragment:           return "sampled (fragment)";
+    case ImageUsage::SampledCompute:            return "sampled (compute)";
+    case ImageUsage::StorageCompute:            return "storage (compute)";
+    case ImageUsage::TransferSrc:               return "transfer src";
+    case ImageUsage::TransferDst:               return "transfer dst";
+    case ImageUsage::Present:                   return "present";
+    default:                                    return "unknown";
+    }
+}
+
+ImageState getImageUsageState(ImageUsage usage)
+{
+    switch (usage)
+    {
+    case ImageUsage::Acquired:
+        // the acquire semaphore is waited at the color output stage (see submitCommandBuffer),
+        // the transition must be ordered after it
+        return { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 };
+    case ImageUsage::ColorAttachment:
+    case ImageUsage::ColorResolve:      // written by the resolve at the end of the subpass, same stage
+        return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+    case ImageUsage::DepthStencilAttachment:
+        return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+    case ImageUsage::DepthStencilRead:
+        return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT };
+    case ImageUsage::SampledFragment:
+        return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+    case ImageUsage::SampledCompute:
+        return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+    case ImageUsage::StorageCompute:
+        return { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+    case ImageUsage::TransferSrc:
+        return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+    case ImageUsage::TransferDst:
+        return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+    case ImageUsage::Present:
+        // presentation is ordered by the render finished semaphore, nothing to make visible
+        return { VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+    case ImageUsage::Undefined:
+    default:
+        return { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0 };
+    }
+}
+
+ImageState getImageLayoutState(VkImageLayout layout)
+{
+    switch (layout)
+    {
+    case VK_IMAGE_LAYOUT_UNDEFINED:                         return getImageUsageState(ImageUsage::Undefined);
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:          return getImageUsageState(ImageUsage::ColorAttachment);
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:  return getImageUsageState(ImageUsage::DepthStencilAttachment);
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:   return getImageUsageState(ImageUsage::DepthStencilRead);
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:          return getImageUsageState(ImageUsage::SampledFragment);
+    case VK_IMAGE_LAYOUT_GENERAL:                           return getImageUsageState(ImageUsage::StorageCompute);
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:              return getImageUsageState(ImageUsage::TransferSrc);
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:              return getImageUsageState(ImageUsage::TransferDst);
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:                   return getImageUsageState(ImageUsage::Present);
+    default:
+        // correct, if not optimal
+        return { layout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT };
+    }
+}
+
+static bool isAttachmentUsage(ImageUsage usage)
+{
+    return usage == ImageUsage::ColorAttachment
+        || usage == ImageUsage::ColorResolve
+        || usage == ImageUsage::DepthStencilAttachment
+        || usage == ImageUsage::DepthStencilRead;
+}
+
+
+// --------------------------<<  Render Graph  >>----------------------------
+
+RenderGraph::RenderGraph() :
+    m_isCompiled(false),
+    m_finalBarriers{}
+{
+}
+
+void RenderGraph::reset()
+{
+    m_images.clear();
+    m_passes.clear();
+    m_passOrder.clear();
+    m_passBarriers.clear();
+    m_finalBarriers = {};
+    m_isCompiled = false;
+}
+
+RenderGraphImage RenderGraph::importImage(const char* name, VkImageAspectFlags aspectMask, ImageUsage initialUsage, ImageUsage finalUsage)
+{
+    Image image{};
+    image.name          = name;
+    image.image         = VK_NULL_HANDLE;   // see bindImage()
+    image.aspectMask    = aspectMask;
+    image.initialUsage  = initialUsage;
+    image.finalUsage    = finalUsage;
+    m_images.push_back(image);
+
+    m_isCompiled = false;
+    return static_cast<RenderGraphImage>(m_images.size() - 1);
+}
+
+RenderGraphPass RenderGraph::addPass(const char* name, RecordFunction record)
+{
+    Pass pass{};
+    pass.name   = name;
+    pass.record = std::move(record);
+    m_passes.push_back(std::move(pass));
+
+    m_isCompiled = false;
+    return static_cast<RenderGraphPass>(m_passes.size() - 1);
+}
+
+void RenderGraph::read(RenderGraphPass pass, RenderGraphImage image, ImageUsage usage)
+{
+    if (pass >= m_passes.size() || image >= m_images.size())
+        throw std::runtime_error("render graph: invalid pass or image!");
+
+    m_passes[pass].accesses.push_back(Access{ image, usage, false, false, false, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE });
+    m_isCompiled = false;
+}
+
+void RenderGraph::write(RenderGraphPass pass, RenderGraphImage image, ImageUsage usage, bool isCleared)
+{
+    if (pass >= m_passes.size() || image >= m_images.size())
+        throw std::runtime_error("render graph: invalid pass or image!");
+
+    const bool isOverwritten = isCleared || usage == ImageUsage::ColorResolve;
+    m_passes[pass].accesses.push_back(Access{ image, usage, true, isCleared, isOverwritten, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_STORE });
+    m_isCompiled = false;
+}
+
+bool RenderGraph::compile()
+{
+    orderPasses();
+    planBarriers();
+    deriveAttachmentOps();
+
+    m_isCompiled = true;
+    return true;
+}
+
+void RenderGraph::orderPasses()
+{
+    // A pass depends on the last pass (in declaration order) that wrote one
+    // of its images, and a write also on the reads since then. Among the
+    // passes that are ready, the one whose dependencies are the furthest
+    // behind goes first, so the producers get as much time as possible to
+    // finish before their consumers have to wait on a barrier.
+    const size_t n_passes = m_passes.size();
+
+    std::vector<std::vector<RenderGraphPass>> dependencies(n_passes);
+    {
+        const RenderGraphPass k_noPass = UINT32_MAX;
+        std::vector<RenderGraphPass>                lastWriters(m_images.size(), k_noPass);
+        std::vector<std::vector<RenderGraphPass>>   readers(m_images.size());
+
+        for (RenderGraphPass pass = 0; pass < n_passes; ++pass)
+        {
+            for (const Access& access : m_passes[pass].accesses)
+            {
+                if (lastWriters[access.image] != k_noPass && lastWriters[access.image] != pass)
+                    dependencies[pass].push_back(lastWriters[access.image]);
+                if (access.isWrite)
+                {
+                    for (RenderGraphPass reader : readers[access.image])
+                        if (reader != pass)
+                            dependencies[pass].push_back(reader);
+                }
+            }
+            // the pass' own accesses don't depend on each other
+            for (const Access& access : m_passes[pass].accesses)
+            {
+                if (access.isWrite)
+                {
+                    lastWriters[access.image] = pass;
+                    readers[access.image].clear();
+                }
+                else
+                    readers[access.image].push_back(pass);
+            }
+        }
+    }
+
+    // dependencies always point to earlier passes, there can't be cycles
+    std::vector<uint32_t>   positions(n_passes, UINT32_MAX);   // in m_passOrder
+    m_passOrder.clear();
+    m_passOrder.reserve(n_passes);
+    while (m_passOrder.size() < n_passes)
+    {
+        RenderGraphPass bestPass        = 0;
+        int64_t         bestPosition    = INT64_MAX;
+        for (RenderGraphPass pass = 0; pass < n_passes; ++pass)
+        {
+            if (positions[pass] != UINT32_MAX)
+                continue;
+
+            bool    isReady             = true;
+            int64_t dependencyPosition  = -1;   // of the latest dependency
+            for (RenderGraphPass dependency : dependencies[pass])
+            {
+                if (positions[dependency] == UINT32_MAX)
+                {
+                    isReady = false;
+                    break;
+                }
+                dependencyPosition = std::max<int64_t>(dependencyPosition, positions[dependency]);
+            }
+
+            if (isReady && dependencyPosition < bestPosition)
+            {
+                bestPass        = pass;
+                bestPosition    = dependencyPosition;
+            }
+        }
+
+        positions[bestPass] = static_cast<uint32_t>(m_passOrder.size());
+        m_passOrder.push_back(bestPass);
+    }
+}
+
+void RenderGraph::planBarriers()
+{
+    // initial state of the images
+    std::vector<ImageTracking> trackings(m_images.size());
+    for (RenderGraphImage image = 0; image < m_images.size(); ++image)
+    {
+        const Image&        info    = m_images[image];
+        const ImageState    initial = getImageUsageState(info.initialUsage);
+        ImageTracking&      tracking = trackings[image];
+
+        tracking = {};
+        tracking.layout             = initial.layout;
+        tracking.isContentDefined   = initial.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+        if (tracking.isContentDefined)
+        {
+            // made visible by whoever left it there (i.e. an upload)
+            tracking.readStageMask      = initial.stageMask;
+            tracking.syncedStageMask    = initial.stageMask;
+            tracking.visibleAccessMask  = initial.accessMask;
+        }
+        else
+            tracking.writeStageMask     = initial.stageMask;
+
+        // The previous execution of the graph (the previous frame) may still
+        // be using the image: the first access has to wait for the last ones.
+        // The swapchain images are ordered by the acquire semaphore instead.
+        if (info.initialUsage == ImageUsage::Acquired)
+            continue;
+        bool                    isWritten   = info.finalUsage != info.initialUsage;
+        VkPipelineStageFlags    stageMask   = 0;
+        VkAccessFlags           writeMask   = 0;
+        for (const Pass& pass : m_passes)
+        {
+            for (const Access& access : pass.accesses)
+            {
+                if (access.image != image)
+                    continue;
+                const ImageState state = getImageUsageState(access.usage);
+                isWritten   |= access.isWrite;
+                stageMask   |= state.stageMask;
+                writeMask   |= access.isWrite ? (state.accessMask & WRITE_ACCESS_MASK) : 0;
+            }
+        }
+        if (isWritten)
+        {
+            tracking.writeStageMask     |= stageMask;
+            tracking.writeAccessMask    |= writeMask;
+            tracking.syncedStageMask    = 0;
+            tracking.visibleAccessMask  = 0;
+        }
+    }
+
+    // walk through the passes in order, batching what each one needs
+    m_passBarriers.assign(m_passOrder.size(), BarrierBatch{});
+    for (size_t i = 0; i < m_passOrder.size(); ++i)
+    {
+        Pass& pass = m_passes[m_passOrder[i]];
+        for (Access& access : pass.accesses)
+        {
+            ImageTracking& tracking = trackings[access.image];
+
+            if (!access.isWrite && !tracking.isContentDefined)
+                PRINTLN("RenderGraph) pass " << pass.name << " reads undefined content of " << m_images[access.image].name);
+            access.loadOp = access.isCleared        ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                          : access.isOverwritten    ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                          : tracking.isContentDefined ? VK_ATTACHMENT_LOAD_OP_LOAD
+                          : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+            trackAccess(m_passBarriers[i], tracking, access.image, access.usage, access.isWrite, access.isOverwritten);
+        }
+    }
+
+    // leave the images as expected after the graph
+    m_finalBarriers = {};
+    for (RenderGraphImage image = 0; image < m_images.size(); ++image)
+    {
+        if (m_images[image].finalUsage != ImageUsage::Undefined)
+            trackAccess(m_finalBarriers, trackings[image], image, m_images[image].finalUsage, false, false);
+    }
+}
+
+void RenderGraph::trackAccess(BarrierBatch& batch, ImageTracking& tracking, RenderGraphImage image, ImageUsage usage, bool isWrite, bool isOverwritten) const
+{
+    const ImageState    state       = getImageUsageState(usage);
+    const VkAccessFlags writeMask   = isWrite ? (state.accessMask & WRITE_ACCESS_MASK) : 0;
+
+    const bool isTransition = state.layout != tracking.layout && state.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkPipelineStageFlags    srcStageMask    = 0;
+    bool                    isMemoryBarrier = false;
+    VkImageLayout           oldLayout       = tracking.layout;
+
+    if (isTransition)
+    {
+        // layout transition: a write, after all the previous accesses
+        srcStageMask    = tracking.writeStageMask | tracking.readStageMask;
+        isMemoryBarrier = true;
+        // the driver can skip preserving content that is overwritten anyway
+        if (isOverwritten || !tracking.isContentDefined)
+            oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    else if (isWrite)
+    {
+        // write after write/read in the same layout
+        srcStageMask    = tracking.writeStageMask | tracking.readStageMask;
+        isMemoryBarrier = tracking.writeAccessMask != 0;
+    }
+    else if (tracking.writeStageMask != 0
+             && ((state.stageMask & ~tracking.syncedStageMask) || (state.accessMask & ~tracking.visibleAccessMask)))
+    {
+        // read after write, not synchronized with this stage/access yet.
+        // Reads after reads don't need anything.
+        srcStageMask    = tracking.writeStageMask;
+        isMemoryBarrier = true;
+    }
+
+    const bool isBarrier = srcStageMask != 0 || isMemoryBarrier;
+    if (isBarrier)
+    {
+        if (srcStageMask == 0)
+            srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;   // nothing to wait for, the transition only
+        batch.srcStageMask |= srcStageMask;
+        batch.dstStageMask |= state.stageMask;
+        if (isMemoryBarrier)
+        {
+            Barrier barrier{};
+            barrier.image           = image;
+            barrier.usage           = usage;
+            barrier.oldLayout       = oldLayout;
+            barrier.newLayout       = isTransition ? state.layout : tracking.layout;
+            barrier.srcAccessMask   = tracking.writeAccessMask;
+            barrier.dstAccessMask   = state.accessMask;
+            batch.barriers.push_back(barrier);
+        }
+    }
+
+    // new state
+    if (isWrite || isTransition)
+    {
+        // only this access is ordered after the write (or the transition)
+        tracking.layout             = isTransition ? state.layout : tracking.layout;
+        tracking.writeStageMask     = state.stageMask;
+        tracking.writeAccessMask    = isWrite ? writeMask : tracking.writeAccessMask;
+        tracking.syncedStageMask    = state.stageMask;
+        tracking.visibleAccessMask  = state.accessMask;
+        tracking.readStageMask      = isWrite ? 0 : state.stageMask;
+    }
+    else
+    {
+        if (isBarrier)
+        {
+            tracking.syncedStageMask    |= state.stageMask;
+            tracking.visibleAccessMask  |= state.accessMask;
+        }
+        tracking.readStageMask |= state.stageMask;
+    }
+    tracking.isContentDefined |= isWrite;
+}
+
+void RenderGraph::deriveAttachmentOps()
+{
+    // backwards: an attachment is stored if a later access (or the final
+    // usage) needs its content. Clearing or resolving doesn't need it.
+    std::vector<bool> isContentNeeded(m_images.size());
+    for (RenderGraphImage image = 0; image < m_images.size(); ++image)
+        isContentNeeded[image] = m_images[image].finalUsage != ImageUsage::Undefined;
+
+    for (auto passIt = m_passOrder.rbegin(); passIt != m_passOrder.rend(); ++passIt)
+    {
+        Pass& pass = m_passes[*passIt];
+        for (Access& access : pass.accesses)
+        {
+            access.storeOp = isContentNeeded[access.image] ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+        for (Access& access : pass.accesses)
+            isContentNeeded[access.image] = !access.isOverwritten;
+    }
+}
+
+const RenderGraph::Access* RenderGraph::findAccess(RenderGraphPass pass, RenderGraphImage image) const
+{
+    if (pass >= m_passes.size())
+        return nullptr;
+    for (const Access& access : m_passes[pass].accesses)
+        if (access.image == image && isAttachmentUsage(access.usage))
+            return &access;
+    return nullptr;
+}
+
+VkAttachmentDescription RenderGraph::getAttachmentDescription(RenderGraphPass pass, RenderGraphImage image, VkFormat format,
+                                                              VkSampleCountFlagBits samples) const
+{
+    const Access* access = findAccess(pass, image);
+    if (!m_isCompiled || access == nullptr)
+        throw std::runtime_error("render graph: not an attachment of the pass (or not compiled)!");
+
+    const bool          hasStencil  = (m_images[image].aspectMask & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+    const VkImageLayout layout      = getImageUsageState(access->usage).layout;
+
+    VkAttachmentDescription attachmentDescription{};
+    attachmentDescription.format            = format;
+    attachmentDescription.samples           = samples;
+    attachmentDescription.loadOp            = access->loadOp;
+    attachmentDescription.storeOp           = access->storeOp;
+    attachmentDescription.stencilLoadOp     = hasStencil ? access->loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachmentDescription.stencilStoreOp    = hasStencil ? access->storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // transitions are the graph's barriers
+    attachmentDescription.initialLayout     = layout;
+    attachmentDescription.finalLayout       = layout;
+
+    return attachmentDescription;
+}
+
+uint32_t RenderGraph::getPipelineBarrierCount() const
+{
+    uint32_t count = m_finalBarriers.srcStageMask != 0 ? 1 : 0;
+    for (const BarrierBatch& batch : m_passBarriers)
+        count += batch.srcStageMask != 0 ? 1 : 0;
+    return count;
+}
+
+void RenderGraph::printPlan() const
+{
+    auto printBatch = [this](const char* name, const BarrierBatch& batch)
+    {
+        PRINTLN_VERBOSE("RenderGraph) " << name << ": " << batch.barriers.size() << " barrier(s)"
+                        << (batch.srcStageMask != 0 && batch.barriers.empty() ? ", execution dependency" : ""));
+        for (const Barrier& barrier : batch.barriers)
+            PRINTLN_VERBOSE("    " << m_images[barrier.image].name << " -> " << getImageUsageName(barrier.usage)
+                            << (barrier.oldLayout != barrier.newLayout ? " (layout transition)" : ""));
+    };
+
+    for (size_t i = 0; i < m_passOrder.size(); ++i)
+        printBatch(m_passes[m_passOrder[i]].name, m_passBarriers[i]);
+    printBatch("final", m_finalBarriers);
+}
+
+void RenderGraph::bindImage(RenderGraphImage image, VkImage vkImage)
+{
+    m_images[image].image = vkImage;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, LinearArena& arena)
+{
+    if (!m_isCompiled)
+        throw std::runtime_error("render graph: executed before compile()!");
+
+    for (size_t i = 0; i < m_passOrder.size(); ++i)
+    {
+        recordBarriers(commandBuffer, m_passBarriers[i], arena);
+        m_passes[m_passOrder[i]].record(commandBuffer);
+    }
+    recordBarriers(commandBuffer, m_finalBarriers, arena);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch, LinearArena& arena)
+{
+    if (batch.srcStageMask == 0)
+        return;     // nothing to wait for
+
+    const uint32_t n_barriers = static_cast<uint32_t>(batch.barriers.size());
+    VkImageMemoryBarrier* vkBarriers = arena.allocate<VkImageMemoryBarrier>(n_barriers);
+    for (uint32_t i = 0; i < n_barriers; ++i)
+    {
+        const Barrier& barrier = batch.barriers[i];
+        const Image& image = m_images[barrier.image];
+
+        VkImageMemoryBarrier& imageMemoryBarrier = vkBarriers[i];
+        imageMemoryBarrier = {};
+        imageMemoryBarrier.sType                = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageMemoryBarrier.srcAccessMask        = barrier.srcAccessMask;
+        imageMemoryBarrier.dstAccessMask        = barrier.dstAccessMask;
+        imageMemoryBarrier.oldLayout            = barrier.oldLayout;
+        imageMemoryBarrier.newLayout            = barrier.newLayout;
+        imageMemoryBarrier.srcQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.image                = image.image;
+        imageMemoryBarrier.subresourceRange.aspectMask      = image.aspectMask;
+        imageMemoryBarrier.subresourceRange.baseMipLevel    = 0;
+        imageMemoryBarrier.subresourceRange.levelCount      = VK_REMAINING_MIP_LEVELS;
+        imageMemoryBarrier.subresourceRange.baseArrayLayer  = 0;
+        imageMemoryBarrier.subresourceRange.layerCount      = VK_REMAINING_ARRAY_LAYERS;
+    }
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        batch.srcStageMask, batch.dstStageMask,
+        0,
+        0, nullptr,
+        0, nullptr,
+        n_barriers, vkBarriers
+    );
+}
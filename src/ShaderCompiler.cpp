@@ -0,0 +1,203 @@
+#include "ShaderCompiler.h"
+#include "Common.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdlib>
+
+#if defined(USE_SHADERC)
+#   include <shaderc/shaderc.hpp>
+#   define SHADER_COMPILER_ID   "shaderc -O"
+#else
+#   if !defined(GLSLC_EXECUTABLE)
+#       define GLSLC_EXECUTABLE "glslc"     // expected to be found in PATH
+#   endif
+#   define SHADER_COMPILER_ID   "glslc -O"
+#endif
+
+// how often the watched sources are checked for modification
+#define SHADER_POLL_INTERVAL_MS 500
+
+
+// -----------------------------< Utils >-----------------------------
+
+static bool readBinaryFile(const std::filesystem::path& path, std::vector<char>& outBuffer)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    size_t filesize = (size_t) file.tellg();
+    outBuffer.resize(filesize);
+
+    file.seekg(0);
+    file.read(outBuffer.data(), filesize);
+
+    return true;
+}
+
+static bool writeBinaryFile(const std::filesystem::path& path, const std::vector<char>& buffer)
+{
+    // write into a temporary file first, so that the cache never contains a
+    // partially written binary (e.g. when the app is killed in the middle)
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(buffer.data(), buffer.size());
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    return !error;
+}
+
+// 64-bit FNV-1a. Not cryptographic, but good enough to key a local cache.
+static uint64_t hashBytes(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+
+// -------------------<<  Shader Compiler  >>------------------------
+
+ShaderCompiler::ShaderCompiler(const std::string& shaderDir, const std::string& cacheDir) :
+    m_shaderDir(shaderDir),
+    m_cacheDir(cacheDir),
+    m_lastPollTime(std::chrono::steady_clock::now())
+{
+}
+
+std::vector<char> ShaderCompiler::loadSpirv(const std::string& shaderName)
+{
+    const std::filesystem::path sourcePath = m_shaderDir / shaderName;
+
+    // watch the source before reading it, so a modification in between is not missed
+    std::error_code error;
+    {
+        std::lock_guard<std::mutex> lock(m_watchMutex);
+        m_watchedShaders[shaderName] = WatchedShader{ sourcePath, std::filesystem::last_write_time(sourcePath, error) };
+    }
+
+    std::vector<char> source;
+    if (!readBinaryFile(sourcePath, source))
+        throw std::runtime_error("failed to open shader source - " + sourcePath.string());
+
+    // the cache key covers the source and how it is compiled
+    const std::string compilerId = SHADER_COMPILER_ID;
+    uint64_t hash = hashBytes(source.data(), source.size());
+    hash = hashBytes(compilerId.data(), compilerId.size(), hash);
+
+    const std::string cachePath = getCachePath(shaderName, hash);
+
+    std::vector<char> spirv;
+    if (readBinaryFile(cachePath, spirv) && !spirv.empty())
+    {
+        PRINTLN_VERBOSE("Shader) cache hit - " << shaderName);
+        return spirv;
+    }
+
+    spirv = compile(shaderName, source);
+
+    std::filesystem::create_directories(m_cacheDir, error);
+    if (!writeBinaryFile(cachePath, spirv))
+        PRINTLN("Shader) failed to write shader cache - " << cachePath);
+
+    PRINTLN("Shader) compiled - " << shaderName);
+
+    return spirv;
+}
+
+bool ShaderCompiler::pollChanges(std::vector<std::string>& outChangedShaders)
+{
+    outChangedShaders.clear();
+
+    // checking the file system every frame is a waste
+    auto currentTime = std::chrono::steady_clock::now();
+    if (currentTime - m_lastPollTime < std::chrono::milliseconds(SHADER_POLL_INTERVAL_MS))
+        return false;
+    m_lastPollTime = currentTime;
+
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    for (auto& watchedShader : m_watchedShaders)
+    {
+        std::error_code error;
+        auto writeTime = std::filesystem::last_write_time(watchedShader.second.sourcePath, error);
+        if (error || writeTime == watchedShader.second.writeTime)
+            continue;
+
+        watchedShader.second.writeTime = writeTime;
+        outChangedShaders.push_back(watchedShader.first);
+    }
+
+    return !outChangedShaders.empty();
+}
+
+std::vector<char> ShaderCompiler::compile(const std::string& shaderName, const std::vector<char>& source)
+{
+#if defined(USE_SHADERC)
+    // shader stage from the file extension, same as glslc does
+    const std::string extension = std::filesystem::path(shaderName).extension().string();
+    shaderc_shader_kind kind;
+    if (extension == ".vert")
+        kind = shaderc_vertex_shader;
+    else if (extension == ".frag")
+        kind = shaderc_fragment_shader;
+    else if (extension == ".comp")
+        kind = shaderc_compute_shader;
+    else
+        kind = shaderc_glsl_infer_from_source;
+
+    shaderc::Compiler       compiler;
+    shaderc::CompileOptions options;
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+    shaderc::SpvCompilationResult result =
+        compiler.CompileGlslToSpv(source.data(), source.size(), kind, shaderName.c_str(), options);
+
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+        throw std::runtime_error("failed to compile shader - " + result.GetErrorMessage());
+
+    const char* begin = reinterpret_cast<const char*>(result.cbegin());
+    const char* end   = reinterpret_cast<const char*>(result.cend());
+    return std::vector<char>(begin, end);
+#else
+    (void)source;   // glslc reads the source file by itself
+
+    const std::filesystem::path sourcePath = m_shaderDir / shaderName;
+    std::filesystem::path outputPath = m_cacheDir / shaderName;
+    outputPath += ".out.spv";
+
+    std::error_code error;
+    std::filesystem::create_directories(m_cacheDir, error);
+
+    std::string command = std::string(GLSLC_EXECUTABLE) + " -O \"" + sourcePath.string() +
+                          "\" -o \"" + outputPath.string() + "\"";
+    if (std::system(command.c_str()) != 0)
+        throw std::runtime_error("failed to compile shader - " + shaderName);
+
+    std::vector<char> spirv;
+    if (!readBinaryFile(outputPath, spirv))
+        throw std::runtime_error("failed to read compiled shader - " + outputPath.string());
+    std::filesystem::remove(outputPath, error);
+
+    return spirv;
+#endif
+}
+
+std::string ShaderCompiler::getCachePath(const std::string& shaderName, uint64_t hash) const
+{
+    std::ostringstream fileName;
+    fileName << shaderName << "." << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+    return (m_cacheDir / fileName.str()).string();
+}
@@ -0,0 +1,77 @@
+#include "SpriteBatch.h"
+
+#include <algorithm>
+
+
+// ----------------------------<<  Sprite Batch  >>---------------------------
+
+uint32_t makeSpriteColor(float r, float g, float b, float a)
+{
+    auto toByte = [](float value) { return static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16) | (toByte(a) << 24);
+}
+
+SpriteBatch::SpriteBatch()
+{
+}
+
+void SpriteBatch::submit(SpriteTexture texture, const SpriteRect& rect, const SpriteRect& uv, uint32_t color, float depth)
+{
+    // the texture is the material of the key, the sort groups the sprites by texture
+    m_order.push_back(SortedDraw{ makeDrawKey(0, 0, texture, 0, depth), static_cast<uint32_t>(m_sprites.size()) });
+    m_sprites.push_back(Sprite{ rect, uv, color, depth });
+}
+
+uint32_t SpriteBatch::flush(SpriteVertex* vertices, uint32_t maxSprites, std::vector<SpriteDraw>& outDraws)
+{
+    outDraws.clear();
+
+    radixSortDraws(m_order, m_sortScratch);
+
+    const uint32_t n_sprites = std::min(static_cast<uint32_t>(m_order.size()), maxSprites);
+    for (uint32_t i = 0; i < n_sprites; ++i)
+    {
+        const SpriteTexture texture = getDrawKeyFields(m_order[i].key).material;
+        if (outDraws.empty() || outDraws.back().texture != texture)
+            outDraws.push_back(SpriteDraw{ texture, i, 0 });
+        outDraws.back().spriteCount++;
+
+        // corners in the order of writeIndices. The buffer is write-combined
+        // memory, the vertices are written in sequence and never read.
+        const Sprite& sprite = m_sprites[m_order[i].drawIndex];
+        const float x0 = sprite.rect.x;
+        const float y0 = sprite.rect.y;
+        const float x1 = sprite.rect.x + sprite.rect.width;
+        const float y1 = sprite.rect.y + sprite.rect.height;
+        const float u0 = sprite.uv.x;
+        const float v0 = sprite.uv.y;
+        const float u1 = sprite.uv.x + sprite.uv.width;
+        const float v1 = sprite.uv.y + sprite.uv.height;
+
+        SpriteVertex* quad = vertices + i * 4;
+        quad[0] = SpriteVertex{ { x0, y0, sprite.depth }, { u0, v0 }, sprite.color };
+        quad[1] = SpriteVertex{ { x1, y0, sprite.depth }, { u1, v0 }, sprite.color };
+        quad[2] = SpriteVertex{ { x1, y1, sprite.depth }, { u1, v1 }, sprite.color };
+        quad[3] = SpriteVertex{ { x0, y1, sprite.depth }, { u0, v1 }, sprite.color };
+    }
+
+    m_sprites.clear();
+    m_order.clear();
+
+    return n_sprites;
+}
+
+void SpriteBatch::writeIndices(uint32_t* indices, uint32_t spriteCount)
+{
+    for (uint32_t i = 0; i < spriteCount; ++i)
+    {
+        const uint32_t vertex = i * 4;
+        uint32_t* quad = indices + i * 6;
+        quad[0] = vertex;
+        quad[1] = vertex + 1;
+        quad[2] = vertex + 2;
+        quad[3] = vertex + 2;
+        quad[4] = vertex + 3;
+        quad[5] = vertex;
+    }
+}
@@ -0,0 +1,4 @@
+// stb_image implementation, in its own translation unit: shared by the app
+// and the benchmarks, and not rebuilt along with the files that use it
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
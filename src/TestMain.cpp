@@ -0,0 +1,573 @@
+#include "TestRunner.h"
+#include "Common.h"
+#include "ImageCompare.h"
+#include "ImageProcessing.h"
+#include "ImageWriter.h"
+#include "JobSystem.h"
+#include "LinearArena.h"
+#include "TransformSystem.h"
+#include "TransientBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// the files the cases write, in the temporary directory, removed on exit
+#define TEST_OUTPUT_DIR     "hello_vulkan_tests"
+
+// one per run, ctest may run the groups in parallel (see main)
+static std::filesystem::path s_outputDirectory;
+
+static std::filesystem::path getTestPath(const std::string& fileName)
+{
+    std::filesystem::create_directories(s_outputDirectory);
+    return s_outputDirectory / fileName;
+}
+
+
+// -----------------------------<< Image Compare >>------------------------------
+
+// RGBA8, a horizontal gradient with a square of color in the middle
+static std::vector<uint8_t> makeTestImage(uint32_t width, uint32_t height, const uint8_t squareColor[3])
+{
+    std::vector<uint8_t> pixels(size_t(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+            const bool isSquare = x >= width / 4 && x < width * 3 / 4 && y >= height / 4 && y < height * 3 / 4;
+            for (uint32_t c = 0; c < 3; ++c)
+                pixel[c] = isSquare ? squareColor[c] : static_cast<uint8_t>(x * 255 / (width - 1));
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+static std::string writeTestImage(const std::string& fileName, uint32_t width, uint32_t height, const std::vector<uint8_t>& pixels)
+{
+    const std::string path = getTestPath(fileName).string();
+
+    ImageWriteDesc image;
+    image.width     = width;
+    image.height    = height;
+    image.rowPitch  = width * 4;
+    image.isBgra    = false;
+    image.pixels    = pixels.data();
+    if (!writePng(path.c_str(), image))
+        TEST_CHECK(!"failed to write the test image");
+    return path;
+}
+
+static void addImageCompareTests(TestRunner& runner)
+{
+    const uint8_t red[3]        = { 200, 40, 40 };
+    const uint8_t blue[3]       = { 40, 40, 200 };
+    const uint8_t nearRed[3]    = { 201, 40, 40 };      // below the just noticeable difference
+
+    runner.add("imageCompare/identical", [=]() {
+        const std::string path = writeTestImage("identical.png", 64, 48, makeTestImage(64, 48, red));
+        const std::string copy = writeTestImage("identical_copy.png", 64, 48, makeTestImage(64, 48, red));
+
+        const ImageCompareResult result = compareImages(path.c_str(), copy.c_str());
+        TEST_CHECK(result.error.empty());
+        TEST_CHECK(result.isMatching);
+        TEST_CHECK(result.width == 64 && result.height == 48);
+        TEST_CHECK(result.differentPixelCount == 0);
+        TEST_CHECK(result.maxDeltaE == 0.0f);
+    });
+
+    runner.add("imageCompare/belowThreshold", [=]() {
+        const std::string path      = writeTestImage("near.png", 64, 48, makeTestImage(64, 48, nearRed));
+        const std::string reference = writeTestImage("near_reference.png", 64, 48, makeTestImage(64, 48, red));
+
+        const ImageCompareResult result = compareImages(path.c_str(), reference.c_str());
+        TEST_CHECK(result.error.empty());
+        TEST_CHECK(result.isMatching);
+        TEST_CHECK(result.differentPixelCount == 0);
+        TEST_CHECK(result.maxDeltaE > 0.0f);
+    });
+
+    runner.add("imageCompare/different", [=]() {
+        const std::string path      = writeTestImage("different.png", 64, 48, makeTestImage(64, 48, blue));
+        const std::string reference = writeTestImage("different_reference.png", 64, 48, makeTestImage(64, 48, red));
+
+        // the square, a quarter of the pixels
+        const ImageCompareResult result = compareImages(path.c_str(), reference.c_str());
+        TEST_CHECK(result.error.empty());
+        TEST_CHECK(!result.isMatching);
+        TEST_CHECK(result.differentPixelCount == 32 * 24);
+        TEST_CHECK(result.differentRatio == 0.25f);
+        TEST_CHECK(result.maxDeltaE > 2.3f);
+    });
+
+    runner.add("imageCompare/sizeMismatch", [=]() {
+        const std::string path      = writeTestImage("small.png", 32, 24, makeTestImage(32, 24, red));
+        const std::string reference = writeTestImage("large.png", 64, 48, makeTestImage(64, 48, red));
+
+        const ImageCompareResult result = compareImages(path.c_str(), reference.c_str());
+        TEST_CHECK(!result.isMatching);
+        TEST_CHECK(!result.error.empty());
+    });
+
+    runner.add("imageCompare/missing", [=]() {
+        const std::string reference = writeTestImage("present.png", 64, 48, makeTestImage(64, 48, red));
+
+        const ImageCompareResult result = compareImages(getTestPath("missing.png").string().c_str(), reference.c_str());
+        TEST_CHECK(!result.isMatching);
+        TEST_CHECK(!result.error.empty());
+    });
+}
+
+
+// ---------------------------<< Image Processing >>-----------------------------
+
+// each dispatch reads what the previous one wrote, the first one the source
+static bool isChained(const std::vector<ImageDispatch>& dispatches, uint32_t width, uint32_t height)
+{
+    for (const ImageDispatch& dispatch : dispatches)
+    {
+        if (dispatch.constants.inputSize[0] != width || dispatch.constants.inputSize[1] != height)
+            return false;
+        if (dispatch.constants.outputSize[0] != dispatch.width || dispatch.constants.outputSize[1] != dispatch.height)
+            return false;
+        width   = dispatch.width;
+        height  = dispatch.height;
+    }
+    return true;
+}
+
+static void addImageProcessingTests(TestRunner& runner)
+{
+    runner.add("imageProcessing/empty", []() {
+        TEST_CHECK(planImageDispatches({}, 640, 480).empty());
+    });
+
+    // the ping-pong images are sized for the largest step: the smaller
+    // steps are in their corner, and the shader samples within inputSize
+    runner.add("imageProcessing/shrinkThenResize", []() {
+        const std::vector<ImageDispatch> dispatches = planImageDispatches({
+            ImageOperation::resize(2048, 2048),
+            ImageOperation::resize(512, 512),
+            ImageOperation::resize(256, 128),
+        }, 1024, 768);
+
+        TEST_CHECK(dispatches.size() == 3);
+        TEST_CHECK(isChained(dispatches, 1024, 768));
+        for (const ImageDispatch& dispatch : dispatches)
+        {
+            TEST_CHECK(dispatch.constants.spatialOp == uint32_t(ImageSpatialOp::Copy));
+            TEST_CHECK(dispatch.constants.pointOpCount == 0);
+        }
+        TEST_CHECK(dispatches[1].constants.inputSize[0] == 2048 && dispatches[1].width == 512);
+        TEST_CHECK(dispatches[2].constants.inputSize[0] == 512 && dispatches[2].constants.inputSize[1] == 512);
+        TEST_CHECK(dispatches.back().width == 256 && dispatches.back().height == 128);
+    });
+
+    runner.add("imageProcessing/fusedPointOps", []() {
+        const std::vector<ImageDispatch> dispatches = planImageDispatches({
+            ImageOperation::saturation(1.2f),       // nothing to fuse into: a copy
+            ImageOperation::resize(256, 256),
+            ImageOperation::contrast(1.1f),
+            ImageOperation::gamma(2.2f),
+            ImageOperation::blur(1.5f),
+            ImageOperation::brightness(0.1f),       // into the vertical pass
+        }, 512, 512);
+
+        TEST_CHECK(dispatches.size() == 4);
+        TEST_CHECK(isChained(dispatches, 512, 512));
+        TEST_CHECK(dispatches[0].constants.spatialOp == uint32_t(ImageSpatialOp::Copy));
+        TEST_CHECK(dispatches[0].width == 512 && dispatches[0].constants.pointOpCount == 1);
+        TEST_CHECK(dispatches[1].width == 256 && dispatches[1].constants.pointOpCount == 2);
+        TEST_CHECK(dispatches[1].constants.pointOps[0] == uint32_t(ImageOperationType::Contrast));
+        TEST_CHECK(dispatches[1].constants.pointOps[1] == uint32_t(ImageOperationType::Gamma));
+        TEST_CHECK(dispatches[2].constants.spatialOp == uint32_t(ImageSpatialOp::BlurHorizontal));
+        TEST_CHECK(dispatches[3].constants.spatialOp == uint32_t(ImageSpatialOp::BlurVertical));
+        TEST_CHECK(dispatches[3].constants.pointOpCount == 1);
+    });
+
+    runner.add("imageProcessing/fusedLimit", []() {
+        ImageOperationChain chain = { ImageOperation::sharpen(0.5f) };
+        for (uint32_t i = 0; i < IMAGE_MAX_FUSED_OPS + 1; ++i)
+            chain.push_back(ImageOperation::brightness(0.01f));
+
+        // the one over the limit in a copy of its own
+        const std::vector<ImageDispatch> dispatches = planImageDispatches(chain, 64, 64);
+        TEST_CHECK(dispatches.size() == 2);
+        TEST_CHECK(dispatches[0].constants.pointOpCount == IMAGE_MAX_FUSED_OPS);
+        TEST_CHECK(dispatches[1].constants.spatialOp == uint32_t(ImageSpatialOp::Copy));
+        TEST_CHECK(dispatches[1].constants.pointOpCount == 1);
+    });
+}
+
+
+// ------------------------------<< Transforms >>--------------------------------
+
+// the local transforms, kept aside to compute the world matrices the plain way
+struct TransformTestScene
+{
+    TransformSystem                 transforms;
+    std::vector<TransformHandle>    parents;
+    std::vector<glm::mat4>          locals;
+    std::mt19937                    random{ 1234 };
+
+    TransformHandle create(TransformHandle parent)
+    {
+        const TransformHandle node = transforms.create(parent);
+        parents.push_back(parent);
+        locals.push_back(glm::mat4(1.0f));
+        setRandomLocal(node);
+        return node;
+    }
+
+    void setRandomLocal(TransformHandle node)
+    {
+        std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+        const glm::vec3 position(distribution(random), distribution(random), distribution(random));
+        const glm::vec3 scale(1.5f + distribution(random), 1.5f + distribution(random), 1.5f + distribution(random));
+
+        float q[4] = { distribution(random), distribution(random), distribution(random), 1.0f };
+        const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        const glm::quat rotation(q[3] / length, q[0] / length, q[1] / length, q[2] / length);
+        transforms.setLocal(node, position, rotation, scale);
+
+        glm::mat4& local = locals[node];
+        local       = glm::mat4_cast(rotation);
+        local[0]   *= scale.x;
+        local[1]   *= scale.y;
+        local[2]   *= scale.z;
+        local[3]    = glm::vec4(position.x, position.y, position.z, 1.0f);
+    }
+
+    // the parents are created first
+    glm::mat4 getReferenceWorld(TransformHandle node) const
+    {
+        return parents[node] == INVALID_TRANSFORM ? locals[node] : getReferenceWorld(parents[node]) * locals[node];
+    }
+
+    bool isMatchingReference() const
+    {
+        for (TransformHandle node = 0; node < transforms.getNodeCount(); node++)
+        {
+            const glm::mat4 world       = transforms.getWorldMatrix(node);
+            const glm::mat4 reference   = getReferenceWorld(node);
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                for (uint32_t row = 0; row < 4; row++)
+                {
+                    if (std::abs(world[column][row] - reference[column][row]) > 1e-3f * (1.0f + std::abs(reference[column][row])))
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool isInSubtree(TransformHandle node, TransformHandle root) const
+    {
+        for (; node != INVALID_TRANSFORM; node = parents[node])
+        {
+            if (node == root)
+                return true;
+        }
+        return false;
+    }
+};
+
+// a few roots, each node under any node created before it
+static void createRandomHierarchy(TransformTestScene& scene, uint32_t nodeCount)
+{
+    for (uint32_t i = 0; i < nodeCount; i++)
+    {
+        const bool isRoot = i < 3;
+        scene.create(isRoot ? INVALID_TRANSFORM : static_cast<TransformHandle>(scene.random() % i));
+    }
+}
+
+static void addTransformTests(TestRunner& runner)
+{
+    runner.add("transforms/empty", []() {
+        TransformSystem transforms;
+        transforms.update();
+        TEST_CHECK(transforms.getNodeCount() == 0);
+        TEST_CHECK(transforms.getLevelCount() == 0);
+        TEST_CHECK(transforms.getUpdatedCount() == 0);
+    });
+
+    runner.add("transforms/matchesReference", []() {
+        TransformTestScene scene;
+        createRandomHierarchy(scene, 1000);
+        scene.transforms.update();
+
+        TEST_CHECK(scene.transforms.getUpdatedCount() == 1000);
+        TEST_CHECK(scene.transforms.getLevelCount() > 2);
+        TEST_CHECK(scene.isMatchingReference());
+        TEST_CHECK(scene.transforms.getParent(10) == scene.parents[10]);
+    });
+
+    runner.add("transforms/dirtySubtree", []() {
+        TransformTestScene scene;
+        createRandomHierarchy(scene, 1000);
+        scene.transforms.update();
+        scene.transforms.update();
+        TEST_CHECK(scene.transforms.getUpdatedCount() == 0);
+
+        const TransformHandle root = 20;
+        scene.setRandomLocal(root);
+        scene.transforms.update();
+
+        uint32_t subtreeCount = 0;
+        bool isChangedMatching = true;
+        for (TransformHandle node = 0; node < 1000; node++)
+        {
+            const bool isInSubtree = scene.isInSubtree(node, root);
+            subtreeCount += isInSubtree;
+            isChangedMatching &= scene.transforms.isWorldMatrixChanged(node) == isInSubtree;
+        }
+        TEST_CHECK(scene.transforms.getUpdatedCount() == subtreeCount);
+        TEST_CHECK(isChangedMatching);
+        TEST_CHECK(scene.isMatchingReference());
+    });
+
+    // the nodes are sorted again, the handles stay
+    runner.add("transforms/createAfterUpdate", []() {
+        TransformTestScene scene;
+        createRandomHierarchy(scene, 200);
+        scene.transforms.update();
+
+        for (uint32_t i = 0; i < 100; i++)
+            scene.create(static_cast<TransformHandle>(scene.random() % scene.parents.size()));
+        scene.create(INVALID_TRANSFORM);
+        scene.setRandomLocal(5);
+        scene.transforms.update();
+
+        TEST_CHECK(scene.transforms.getNodeCount() == 301);
+        TEST_CHECK(scene.isMatchingReference());
+    });
+
+    // levels larger than a job batch, split over the workers
+    runner.add("transforms/jobs", []() {
+        TransformTestScene scene;
+        const TransformHandle root = scene.create(INVALID_TRANSFORM);
+        for (uint32_t i = 0; i < 20000; i++)
+            scene.create(root);
+        for (uint32_t i = 0; i < 20000; i++)
+            scene.create(1 + scene.random() % 20000);
+
+        JobSystem jobSystem(2);
+        scene.transforms.update(&jobSystem);
+        TEST_CHECK(scene.transforms.getUpdatedCount() == 40001);
+        TEST_CHECK(scene.isMatchingReference());
+
+        scene.setRandomLocal(root);
+        scene.transforms.update(&jobSystem);
+        TEST_CHECK(scene.transforms.getUpdatedCount() == 40001);
+        TEST_CHECK(scene.isMatchingReference());
+    });
+}
+
+
+// -----------------------------<< Linear Arena >>-------------------------------
+
+static bool isAligned(const void* pointer, size_t alignment)
+{
+    return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+// the allocations of a frame, the same every time
+static bool allocateTestFrame(LinearArena& arena)
+{
+    bool isAlignedFrame = true;
+    for (size_t i = 0; i < 32; i++)
+    {
+        const size_t alignment = size_t(8) << (i % 5);     // 8 to 128
+        void* pointer = arena.allocate(40 + i * 8, alignment);
+        std::memset(pointer, 0xcd, 40 + i * 8);
+        isAlignedFrame &= isAligned(pointer, alignment);
+    }
+    return isAlignedFrame;
+}
+
+static void addLinearArenaTests(TestRunner& runner)
+{
+    runner.add("linearArena/overflowAlignment", []() {
+        LinearArena arena(64);
+        TEST_CHECK(isAligned(arena.allocate(40, 8), 8));
+        TEST_CHECK(arena.getOverflowCount() == 0);
+
+        // out of room: from the heap, still aligned
+        for (size_t alignment : { size_t(16), size_t(64), size_t(256), size_t(4096) })
+        {
+            void* pointer = arena.allocate(100, alignment);
+            std::memset(pointer, 0xcd, 100);
+            TEST_CHECK(isAligned(pointer, alignment));
+        }
+        TEST_CHECK(arena.getOverflowCount() == 4);
+
+        // no arena memory at all
+        LinearArena empty;
+        TEST_CHECK(isAligned(empty.allocate(24, 512), 512));
+        TEST_CHECK(empty.getOverflowCount() == 1);
+    });
+
+    runner.add("linearArena/growAfterOverflow", []() {
+        LinearArena arena(256);
+        TEST_CHECK(allocateTestFrame(arena));
+        TEST_CHECK(arena.getOverflowCount() > 0);
+
+        const size_t frameBytes = arena.getUsedBytes();
+        arena.reset();
+        TEST_CHECK(arena.getOverflowCount() == 0);
+        TEST_CHECK(arena.getUsedBytes() == 0);
+        TEST_CHECK(arena.getCapacity() >= frameBytes);
+
+        // the same frame fits now, and the arena doesn't grow any more
+        const size_t capacity = arena.getCapacity();
+        for (uint32_t frame = 0; frame < 3; frame++)
+        {
+            TEST_CHECK(allocateTestFrame(arena));
+            TEST_CHECK(arena.getOverflowCount() == 0);
+            arena.reset();
+        }
+        TEST_CHECK(arena.getCapacity() == capacity);
+    });
+}
+
+
+// ---------------------------<< Transient Buffer >>-----------------------------
+
+// the ring on a host array, no buffer: the offsets and pointers are checked
+struct TransientTestRing
+{
+    std::vector<uint8_t>    memory;
+    TransientBuffer         ring;
+
+    TransientTestRing(VkDeviceSize size, VkDeviceSize uniformAlignment) : memory(size)
+    {
+        ring.init(VK_NULL_HANDLE, memory.data(), size, uniformAlignment, 2);
+    }
+
+    bool isInMemory(const TransientAllocation& allocation, VkDeviceSize size) const
+    {
+        return allocation.data == memory.data() + allocation.offset && allocation.offset + size <= ring.getSize();
+    }
+};
+
+static void addTransientBufferTests(TestRunner& runner)
+{
+    runner.add("transientBuffer/wrapToStart", []() {
+        TransientTestRing test(1024, 256);
+        test.ring.beginFrame(1, 0);
+        const TransientAllocation first = test.ring.allocate(640, TransientUsage::Vertex);
+        TEST_CHECK(first.data != nullptr && first.offset == 0);
+
+        // frame 1 is done, 640 bytes don't fit before the end
+        test.ring.beginFrame(2, 1);
+        const TransientAllocation second = test.ring.allocate(640, TransientUsage::Vertex);
+        TEST_CHECK(second.data != nullptr && second.offset == 0);
+        TEST_CHECK(test.isInMemory(second, 640));
+    });
+
+    runner.add("transientBuffer/fullWhileInFlight", []() {
+        TransientTestRing test(1024, 256);
+        test.ring.beginFrame(1, 0);
+        TEST_CHECK(test.ring.allocate(640, TransientUsage::Vertex).data != nullptr);
+
+        // frame 1 is still in flight: the end of the buffer only
+        test.ring.beginFrame(2, 0);
+        TEST_CHECK(test.ring.allocate(640, TransientUsage::Vertex).data == nullptr);
+        const TransientAllocation tail = test.ring.allocate(368, TransientUsage::Vertex);
+        TEST_CHECK(tail.data != nullptr && tail.offset == 640);
+        TEST_CHECK(test.ring.allocate(32, TransientUsage::Vertex).data == nullptr);
+        TEST_CHECK(test.ring.allocate(2048, TransientUsage::Vertex).data == nullptr);
+        TEST_CHECK(test.ring.getUsedSize() == 1008);
+    });
+
+    runner.add("transientBuffer/reclaimCompleted", []() {
+        TransientTestRing test(1024, 256);
+        test.ring.beginFrame(1, 0);
+        TEST_CHECK(test.ring.allocate(640, TransientUsage::Vertex).data != nullptr);
+        test.ring.beginFrame(2, 0);
+        TEST_CHECK(test.ring.allocate(640, TransientUsage::Vertex).data == nullptr);
+
+        // frame 1 completed, its 640 bytes are free again
+        test.ring.beginFrame(3, 1);
+        TEST_CHECK(test.ring.getUsedSize() == 0);
+        const TransientAllocation allocation = test.ring.allocate(640, TransientUsage::Vertex);
+        TEST_CHECK(allocation.data != nullptr && allocation.offset == 0);
+        TEST_CHECK(test.isInMemory(allocation, 640));
+
+        // frame 3 still in flight
+        test.ring.beginFrame(4, 2);
+        TEST_CHECK(test.ring.allocate(640, TransientUsage::Vertex).data == nullptr);
+        test.ring.beginFrame(5, 4);
+        TEST_CHECK(test.ring.allocate(640, TransientUsage::Vertex).data != nullptr);
+    });
+
+    runner.add("transientBuffer/uniformAlignment", []() {
+        TransientTestRing test(1000, 256);
+        TEST_CHECK(test.ring.getSize() == 768);     // rounded down to the uniform alignment
+
+        test.ring.beginFrame(1, 0);
+        TEST_CHECK(test.ring.allocate(20, TransientUsage::Vertex).offset == 0);
+        TEST_CHECK(test.ring.allocate(2, TransientUsage::Index).offset == 20);
+        const TransientAllocation uniform = test.ring.allocate(64, TransientUsage::Uniform);
+        TEST_CHECK(uniform.data != nullptr && uniform.offset == 256);
+        TEST_CHECK(test.isInMemory(uniform, 64));
+        TEST_CHECK(test.ring.allocate(1, TransientUsage::Vertex).offset == 320);
+        TEST_CHECK(test.ring.allocate(1, TransientUsage::Uniform).offset == 512);
+
+        // a uniform alignment below the vertex one is raised to it
+        TransientTestRing small(1024, 4);
+        small.ring.beginFrame(1, 0);
+        small.ring.allocate(1, TransientUsage::Vertex);
+        TEST_CHECK(small.ring.allocate(4, TransientUsage::Uniform).offset == 16);
+    });
+}
+
+
+int main(int argc, char** argv)
+{
+    // Hello_Vulkan_tests [filter]
+    std::string filter;
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-' && filter.empty())
+            filter = argv[i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [filter]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::string outputName = std::string(TEST_OUTPUT_DIR "_") + (filter.empty() ? "all" : filter);
+    std::replace(outputName.begin(), outputName.end(), '/', '_');
+    s_outputDirectory = std::filesystem::temp_directory_path() / outputName;
+
+    TestRunner runner;
+    addImageCompareTests(runner);
+    addImageProcessingTests(runner);
+    addTransformTests(runner);
+    addLinearArenaTests(runner);
+    addTransientBufferTests(runner);
+
+    uint32_t runCount;
+    const uint32_t failedCount = runner.run(filter, runCount);
+
+    std::error_code error;
+    std::filesystem::remove_all(s_outputDirectory, error);
+
+    if (runCount == 0)
+    {
+        std::cerr << "no test matching \"" << filter << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+#include "TestRunner.h"
+#include "Common.h"
+
+#include <exception>
+
+// failed checks of the running case, the cases run one after the other
+static uint32_t s_failedCheckCount = 0;
+
+
+// -------------------------------<< Runner >>---------------------------------
+
+void TestRunner::add(const std::string& name, Function function)
+{
+    m_cases.push_back(Case{ name, std::move(function) });
+}
+
+uint32_t TestRunner::run(const std::string& filter, uint32_t& runCount) const
+{
+    uint32_t failedCount = 0;
+    runCount = 0;
+
+    PRINT_BAR_LINE();
+    for (const Case& test : m_cases)
+    {
+        if (!filter.empty() && test.name.find(filter) == std::string::npos)
+            continue;
+
+        s_failedCheckCount = 0;
+        try
+        {
+            test.function();
+        }
+        catch (const std::exception& e)
+        {
+            PRINTLN("    exception: " << e.what());
+            s_failedCheckCount++;
+        }
+
+        PRINTLN((s_failedCheckCount == 0 ? "PASS  " : "FAIL  ") << test.name);
+        failedCount += s_failedCheckCount != 0;
+        runCount++;
+    }
+    PRINT_BAR_DOTS();
+    PRINTLN(runCount - failedCount << " of " << runCount << " tests passed");
+    PRINT_BAR_LINE();
+
+    return failedCount;
+}
+
+void TestRunner::check(bool isPassing, const char* condition, const char* file, int line)
+{
+    if (isPassing)
+        return;
+
+    PRINTLN("    " << file << ":" << line << ": check failed: " << condition);
+    s_failedCheckCount++;
+}
@@ -0,0 +1,464 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+// SSE is baseline on x86-64, other targets (i.e. arm64) take the scalar path
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#   define TRANSFORM_USE_SSE
+#   include <xmmintrin.h>
+#endif
+
+// nodes per SIMD group, the levels are padded to a multiple of it
+#define TRANSFORM_GROUP_SIZE    4
+
+// nodes per job, the smaller levels are updated on the calling thread
+#define TRANSFORM_JOB_BATCH_SIZE    8192
+
+// the parent of the roots, and of the padding nodes: every lane is identity
+alignas(16) static const float k_identityValues[12][TRANSFORM_GROUP_SIZE] = {
+    {1.0f, 1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f},
+    {0.0f, 0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f, 0.0f},
+    {0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f, 1.0f},
+    {0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f},
+};
+
+// values[i] of slot i taken from the slot sourceSlots[i] (INVALID_TRANSFORM: padding)
+template <typename T>
+static void sortValues(std::vector<T>& values, const std::vector<uint32_t>& sourceSlots, T padding)
+{
+    std::vector<T> sorted(sourceSlots.size());
+    for (size_t i = 0; i < sourceSlots.size(); i++)
+        sorted[i] = sourceSlots[i] == INVALID_TRANSFORM ? padding : values[sourceSlots[i]];
+    values.swap(sorted);
+}
+
+
+// -------------------------<<  Transform System  >>--------------------------
+
+TransformSystem::TransformSystem() :
+    m_isSorted(true),
+    m_updatedCount(0),
+    m_levelOffsets(1, 0)
+{
+}
+
+TransformHandle TransformSystem::create(TransformHandle parent)
+{
+    if (parent != INVALID_TRANSFORM && parent >= m_slots.size())
+        throw std::invalid_argument("transform parent must be created before its children!");
+
+    // at the end until the next update() sorts the nodes by level
+    const uint32_t slot = static_cast<uint32_t>(m_parents.size());
+    m_parents.push_back(INVALID_TRANSFORM);
+    m_positionX.push_back(0.0f);
+    m_positionY.push_back(0.0f);
+    m_positionZ.push_back(0.0f);
+    m_rotationX.push_back(0.0f);
+    m_rotationY.push_back(0.0f);
+    m_rotationZ.push_back(0.0f);
+    m_rotationW.push_back(1.0f);
+    m_scaleX.push_back(1.0f);
+    m_scaleY.push_back(1.0f);
+    m_scaleZ.push_back(1.0f);
+    m_isDirty.push_back(1);
+    m_isWorldChanged.push_back(0);
+    if (slot % TRANSFORM_GROUP_SIZE == 0)
+    {
+        m_worldGroups.emplace_back();
+        std::copy(&k_identityValues[0][0], &k_identityValues[0][0] + 12 * TRANSFORM_GROUP_SIZE, &m_worldGroups.back().values[0][0]);
+    }
+
+    const TransformHandle node = static_cast<TransformHandle>(m_slots.size());
+    m_slots.push_back(slot);
+    m_parentHandles.push_back(parent);
+    m_isSorted = false;
+    return node;
+}
+
+void TransformSystem::clear()
+{
+    m_isSorted      = true;
+    m_updatedCount  = 0;
+    m_slots.clear();
+    m_parentHandles.clear();
+    m_levelOffsets.assign(1, 0);
+    m_parents.clear();
+    m_positionX.clear();
+    m_positionY.clear();
+    m_positionZ.clear();
+    m_rotationX.clear();
+    m_rotationY.clear();
+    m_rotationZ.clear();
+    m_rotationW.clear();
+    m_scaleX.clear();
+    m_scaleY.clear();
+    m_scaleZ.clear();
+    m_isDirty.clear();
+    m_isWorldChanged.clear();
+    m_worldGroups.clear();
+}
+
+void TransformSystem::reserve(uint32_t nodeCount)
+{
+    m_slots.reserve(nodeCount);
+    m_parentHandles.reserve(nodeCount);
+
+    // without the padding of the levels
+    m_parents.reserve(nodeCount);
+    m_positionX.reserve(nodeCount);
+    m_positionY.reserve(nodeCount);
+    m_positionZ.reserve(nodeCount);
+    m_rotationX.reserve(nodeCount);
+    m_rotationY.reserve(nodeCount);
+    m_rotationZ.reserve(nodeCount);
+    m_rotationW.reserve(nodeCount);
+    m_scaleX.reserve(nodeCount);
+    m_scaleY.reserve(nodeCount);
+    m_scaleZ.reserve(nodeCount);
+    m_isDirty.reserve(nodeCount);
+    m_isWorldChanged.reserve(nodeCount);
+    m_worldGroups.reserve((nodeCount + TRANSFORM_GROUP_SIZE - 1) / TRANSFORM_GROUP_SIZE);
+}
+
+void TransformSystem::setPosition(TransformHandle node, const glm::vec3& position)
+{
+    const uint32_t slot = m_slots[node];
+    m_positionX[slot]   = position.x;
+    m_positionY[slot]   = position.y;
+    m_positionZ[slot]   = position.z;
+    m_isDirty[slot]     = 1;
+}
+
+void TransformSystem::setRotation(TransformHandle node, const glm::quat& rotation)
+{
+    const uint32_t slot = m_slots[node];
+    m_rotationX[slot]   = rotation.x;
+    m_rotationY[slot]   = rotation.y;
+    m_rotationZ[slot]   = rotation.z;
+    m_rotationW[slot]   = rotation.w;
+    m_isDirty[slot]     = 1;
+}
+
+void TransformSystem::setScale(TransformHandle node, const glm::vec3& scale)
+{
+    const uint32_t slot = m_slots[node];
+    m_scaleX[slot]      = scale.x;
+    m_scaleY[slot]      = scale.y;
+    m_scaleZ[slot]      = scale.z;
+    m_isDirty[slot]     = 1;
+}
+
+void TransformSystem::setLocal(TransformHandle node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    setPosition(node, position);
+    setRotation(node, rotation);
+    setScale(node, scale);
+}
+
+glm::mat4 TransformSystem::getWorldMatrix(TransformHandle node) const
+{
+    const uint32_t      slot    = m_slots[node];
+    const WorldGroup&   group   = m_worldGroups[slot / TRANSFORM_GROUP_SIZE];
+    const uint32_t      lane    = slot % TRANSFORM_GROUP_SIZE;
+
+    glm::mat4 world(1.0f);
+    for (uint32_t column = 0; column < 4; column++)
+    {
+        for (uint32_t row = 0; row < 3; row++)
+            world[column][row] = group.values[column * 3 + row][lane];
+    }
+    return world;
+}
+
+void TransformSystem::sortByLevel()
+{
+    PROFILE_FUNCTION();
+
+    const uint32_t nodeCount = static_cast<uint32_t>(m_slots.size());
+
+    // << Children >> of each node in creation order, the roots those of nodeCount
+    std::vector<uint32_t> childOffsets(nodeCount + 2, 0);
+    for (uint32_t node = 0; node < nodeCount; node++)
+    {
+        const TransformHandle parent = m_parentHandles[node];
+        childOffsets[(parent == INVALID_TRANSFORM ? nodeCount : parent) + 1]++;
+    }
+    for (uint32_t node = 0; node <= nodeCount; node++)
+        childOffsets[node + 1] += childOffsets[node];
+
+    std::vector<TransformHandle> children(nodeCount);
+    std::vector<uint32_t> childCursors(childOffsets.begin(), childOffsets.end() - 1);
+    for (uint32_t node = 0; node < nodeCount; node++)
+    {
+        const TransformHandle parent = m_parentHandles[node];
+        children[childCursors[parent == INVALID_TRANSFORM ? nodeCount : parent]++] = node;
+    }
+
+    // << Levels >> breadth first: each level is the children of the previous one, in order
+    std::vector<TransformHandle> order;     // by slot, INVALID_TRANSFORM for the padding
+    order.reserve(nodeCount + nodeCount / 2);
+    order.insert(order.end(), children.begin() + childOffsets[nodeCount], children.begin() + childOffsets[nodeCount + 1]);
+
+    m_levelOffsets.clear();
+    uint32_t levelBegin = 0;
+    while (order.size() > levelBegin)
+    {
+        m_levelOffsets.push_back(levelBegin);
+        while (order.size() % TRANSFORM_GROUP_SIZE != 0)
+            order.push_back(INVALID_TRANSFORM);
+
+        const uint32_t levelEnd = static_cast<uint32_t>(order.size());
+        for (uint32_t slot = levelBegin; slot < levelEnd; slot++)
+        {
+            const TransformHandle node = order[slot];
+            if (node != INVALID_TRANSFORM)
+                order.insert(order.end(), children.begin() + childOffsets[node], children.begin() + childOffsets[node + 1]);
+        }
+        levelBegin = levelEnd;
+    }
+    m_levelOffsets.push_back(static_cast<uint32_t>(order.size()));
+
+    // << Node arrays >> moved to their new slots, every node is recomputed
+    std::vector<uint32_t> sourceSlots(order.size());
+    for (size_t slot = 0; slot < order.size(); slot++)
+        sourceSlots[slot] = order[slot] == INVALID_TRANSFORM ? INVALID_TRANSFORM : m_slots[order[slot]];
+
+    sortValues(m_positionX, sourceSlots, 0.0f);
+    sortValues(m_positionY, sourceSlots, 0.0f);
+    sortValues(m_positionZ, sourceSlots, 0.0f);
+    sortValues(m_rotationX, sourceSlots, 0.0f);
+    sortValues(m_rotationY, sourceSlots, 0.0f);
+    sortValues(m_rotationZ, sourceSlots, 0.0f);
+    sortValues(m_rotationW, sourceSlots, 1.0f);
+    sortValues(m_scaleX, sourceSlots, 1.0f);
+    sortValues(m_scaleY, sourceSlots, 1.0f);
+    sortValues(m_scaleZ, sourceSlots, 1.0f);
+
+    for (size_t slot = 0; slot < order.size(); slot++)
+    {
+        if (order[slot] != INVALID_TRANSFORM)
+            m_slots[order[slot]] = static_cast<uint32_t>(slot);
+    }
+
+    m_parents.resize(order.size());
+    m_isDirty.resize(order.size());
+    m_isWorldChanged.assign(order.size(), 0);
+    for (size_t slot = 0; slot < order.size(); slot++)
+    {
+        const TransformHandle node      = order[slot];
+        const TransformHandle parent    = node == INVALID_TRANSFORM ? INVALID_TRANSFORM : m_parentHandles[node];
+        m_parents[slot] = parent == INVALID_TRANSFORM ? INVALID_TRANSFORM : m_slots[parent];
+        m_isDirty[slot] = node != INVALID_TRANSFORM;
+    }
+    m_worldGroups.resize(order.size() / TRANSFORM_GROUP_SIZE);
+
+    m_isSorted = true;
+}
+
+void TransformSystem::update(JobSystem* jobSystem)
+{
+    PROFILE_FUNCTION();
+
+    if (!m_isSorted)
+        sortByLevel();
+
+    // A level only reads the world matrices of the previous one, its
+    // groups are independent.
+    m_updatedCount = 0;
+    for (size_t level = 0; level + 1 < m_levelOffsets.size(); level++)
+    {
+        const uint32_t first    = m_levelOffsets[level];
+        const uint32_t end      = m_levelOffsets[level + 1];
+        if (jobSystem == nullptr || end - first <= TRANSFORM_JOB_BATCH_SIZE)
+        {
+            m_updatedCount += updateGroups(first, end);
+            continue;
+        }
+
+        std::atomic<uint32_t> updatedCount(0);
+        jobSystem->parallelFor((end - first) / TRANSFORM_GROUP_SIZE, TRANSFORM_JOB_BATCH_SIZE / TRANSFORM_GROUP_SIZE,
+            [this, first, &updatedCount](size_t beginGroup, size_t endGroup) {
+                const uint32_t count = updateGroups(first + static_cast<uint32_t>(beginGroup) * TRANSFORM_GROUP_SIZE,
+                                                    first + static_cast<uint32_t>(endGroup) * TRANSFORM_GROUP_SIZE);
+                updatedCount.fetch_add(count, std::memory_order_relaxed);
+            });
+        m_updatedCount += updatedCount.load(std::memory_order_relaxed);
+    }
+}
+
+uint32_t TransformSystem::updateGroups(uint32_t first, uint32_t end)
+{
+    const uint32_t* parents     = m_parents.data();
+    uint8_t*        isDirty     = m_isDirty.data();
+    uint8_t*        isChanged   = m_isWorldChanged.data();
+
+    uint32_t updatedCount = 0;
+    for (; first < end; first += TRANSFORM_GROUP_SIZE)
+    {
+        // the parents are in the previous level, done.
+        // The padding nodes are never dirty and have no parent.
+        const uint32_t* groupParents = &parents[first];
+        uint32_t changed;   // a byte per lane, 0 or 1
+        if (groupParents[0] == groupParents[1] && groupParents[0] == groupParents[2] && groupParents[0] == groupParents[3])
+        {
+            // one parent, the usual case: the 4 flags at once
+            std::memcpy(&changed, &isDirty[first], sizeof(changed));
+            if (groupParents[0] != INVALID_TRANSFORM)
+                changed |= isChanged[groupParents[0]] * 0x01010101u;
+        }
+        else
+        {
+            uint8_t laneChanged[TRANSFORM_GROUP_SIZE];
+            for (uint32_t lane = 0; lane < TRANSFORM_GROUP_SIZE; lane++)
+            {
+                const uint32_t parent = groupParents[lane];
+                laneChanged[lane] = isDirty[first + lane] | (parent == INVALID_TRANSFORM ? 0 : isChanged[parent]);
+            }
+            std::memcpy(&changed, laneChanged, sizeof(changed));
+        }
+        std::memcpy(&isChanged[first], &changed, sizeof(changed));
+        std::memset(&isDirty[first], 0, TRANSFORM_GROUP_SIZE);
+        const uint32_t changedCount = (changed * 0x01010101u) >> 24;     // sum of the bytes
+
+        // clean subtree. Otherwise the whole group is computed, the
+        // unchanged lanes get the same matrices again.
+        if (changedCount == 0)
+            continue;
+
+        composeWorldMatrices(first);
+        updatedCount += changedCount;
+    }
+    return updatedCount;
+}
+
+#ifdef TRANSFORM_USE_SSE
+
+// row r of the parent's 3x3 times the local column (x, y, z), for each lane
+static inline __m128 transformRow(__m128 parent0, __m128 parent1, __m128 parent2, __m128 x, __m128 y, __m128 z)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(parent0, x), _mm_mul_ps(parent1, y)), _mm_mul_ps(parent2, z));
+}
+
+void TransformSystem::composeWorldMatrices(uint32_t first)
+{
+    // << Local matrices >> of the 4 nodes, one per lane
+    const __m128 px = _mm_loadu_ps(&m_positionX[first]);
+    const __m128 py = _mm_loadu_ps(&m_positionY[first]);
+    const __m128 pz = _mm_loadu_ps(&m_positionZ[first]);
+    const __m128 qx = _mm_loadu_ps(&m_rotationX[first]);
+    const __m128 qy = _mm_loadu_ps(&m_rotationY[first]);
+    const __m128 qz = _mm_loadu_ps(&m_rotationZ[first]);
+    const __m128 qw = _mm_loadu_ps(&m_rotationW[first]);
+    const __m128 sx = _mm_loadu_ps(&m_scaleX[first]);
+    const __m128 sy = _mm_loadu_ps(&m_scaleY[first]);
+    const __m128 sz = _mm_loadu_ps(&m_scaleZ[first]);
+
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // rotation (unit quaternion) to matrix
+    const __m128 qx2 = _mm_add_ps(qx, qx);
+    const __m128 qy2 = _mm_add_ps(qy, qy);
+    const __m128 qz2 = _mm_add_ps(qz, qz);
+    const __m128 xx = _mm_mul_ps(qx, qx2);
+    const __m128 yy = _mm_mul_ps(qy, qy2);
+    const __m128 zz = _mm_mul_ps(qz, qz2);
+    const __m128 xy = _mm_mul_ps(qx, qy2);
+    const __m128 xz = _mm_mul_ps(qx, qz2);
+    const __m128 yz = _mm_mul_ps(qy, qz2);
+    const __m128 wx = _mm_mul_ps(qw, qx2);
+    const __m128 wy = _mm_mul_ps(qw, qy2);
+    const __m128 wz = _mm_mul_ps(qw, qz2);
+
+    // element r of column c, for each lane (the last row is (0, 0, 0, 1))
+    const __m128 c0r0 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+    const __m128 c0r1 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+    const __m128 c0r2 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+    const __m128 c1r0 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+    const __m128 c1r1 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+    const __m128 c1r2 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+    const __m128 c2r0 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+    const __m128 c2r1 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+    const __m128 c2r2 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+
+    // << Parent matrices >> the same way, one per lane
+    const float* parentValues[TRANSFORM_GROUP_SIZE];    // element i of the parent at [i * TRANSFORM_GROUP_SIZE]
+    for (uint32_t lane = 0; lane < TRANSFORM_GROUP_SIZE; lane++)
+    {
+        const uint32_t parent = m_parents[first + lane];
+        parentValues[lane] = parent == INVALID_TRANSFORM
+            ? &k_identityValues[0][lane]
+            : &m_worldGroups[parent / TRANSFORM_GROUP_SIZE].values[0][parent % TRANSFORM_GROUP_SIZE];
+    }
+
+    __m128 parent[12];
+    if (parentValues[0] == parentValues[1] && parentValues[0] == parentValues[2] && parentValues[0] == parentValues[3])
+    {
+        // siblings are next to each other: often one parent for the group
+        for (uint32_t i = 0; i < 12; i++)
+            parent[i] = _mm_set1_ps(parentValues[0][i * TRANSFORM_GROUP_SIZE]);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < 12; i++)
+        {
+            const uint32_t offset = i * TRANSFORM_GROUP_SIZE;
+            parent[i] = _mm_setr_ps(parentValues[0][offset], parentValues[1][offset], parentValues[2][offset], parentValues[3][offset]);
+        }
+    }
+
+    // << World matrices >> parent * local, 4 at a time
+    float (*world)[TRANSFORM_GROUP_SIZE] = m_worldGroups[first / TRANSFORM_GROUP_SIZE].values;
+    _mm_store_ps(world[0],  transformRow(parent[0], parent[3], parent[6], c0r0, c0r1, c0r2));
+    _mm_store_ps(world[1],  transformRow(parent[1], parent[4], parent[7], c0r0, c0r1, c0r2));
+    _mm_store_ps(world[2],  transformRow(parent[2], parent[5], parent[8], c0r0, c0r1, c0r2));
+    _mm_store_ps(world[3],  transformRow(parent[0], parent[3], parent[6], c1r0, c1r1, c1r2));
+    _mm_store_ps(world[4],  transformRow(parent[1], parent[4], parent[7], c1r0, c1r1, c1r2));
+    _mm_store_ps(world[5],  transformRow(parent[2], parent[5], parent[8], c1r0, c1r1, c1r2));
+    _mm_store_ps(world[6],  transformRow(parent[0], parent[3], parent[6], c2r0, c2r1, c2r2));
+    _mm_store_ps(world[7],  transformRow(parent[1], parent[4], parent[7], c2r0, c2r1, c2r2));
+    _mm_store_ps(world[8],  transformRow(parent[2], parent[5], parent[8], c2r0, c2r1, c2r2));
+    _mm_store_ps(world[9],  _mm_add_ps(transformRow(parent[0], parent[3], parent[6], px, py, pz), parent[9]));
+    _mm_store_ps(world[10], _mm_add_ps(transformRow(parent[1], parent[4], parent[7], px, py, pz), parent[10]));
+    _mm_store_ps(world[11], _mm_add_ps(transformRow(parent[2], parent[5], parent[8], px, py, pz), parent[11]));
+}
+
+#else
+
+void TransformSystem::composeWorldMatrices(uint32_t first)
+{
+    WorldGroup& world = m_worldGroups[first / TRANSFORM_GROUP_SIZE];
+    for (uint32_t lane = 0; lane < TRANSFORM_GROUP_SIZE; lane++)
+    {
+        const uint32_t node = first + lane;
+
+        const glm::quat rotation(m_rotationW[node], m_rotationX[node], m_rotationY[node], m_rotationZ[node]);
+        glm::mat4 local = glm::mat4_cast(rotation);
+        local[0]       *= m_scaleX[node];
+        local[1]       *= m_scaleY[node];
+        local[2]       *= m_scaleZ[node];
+        local[3]        = glm::vec4(m_positionX[node], m_positionY[node], m_positionZ[node], 1.0f);
+
+        const uint32_t parent = m_parents[node];
+        const float* parentValues = parent == INVALID_TRANSFORM
+            ? &k_identityValues[0][lane]
+            : &m_worldGroups[parent / TRANSFORM_GROUP_SIZE].values[0][parent % TRANSFORM_GROUP_SIZE];
+
+        for (uint32_t column = 0; column < 4; column++)
+        {
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                float value = column == 3 ? parentValues[(9 + row) * TRANSFORM_GROUP_SIZE] : 0.0f;
+                for (uint32_t i = 0; i < 3; i++)
+                    value += parentValues[(i * 3 + row) * TRANSFORM_GROUP_SIZE] * local[column][i];
+                world.values[column * 3 + row][lane] = value;
+            }
+        }
+    }
+}
+
+#endif
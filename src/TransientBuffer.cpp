@@ -0,0 +1,78 @@
+#include "TransientBuffer.h"
+
+#include <algorithm>
+
+#define TRANSIENT_VERTEX_ALIGNMENT  16      // any vertex attribute format
+
+
+// -------------------------<<  Transient Buffer  >>-------------------------
+
+TransientBuffer::TransientBuffer() :
+    m_buffer(VK_NULL_HANDLE),
+    m_mappedData(nullptr),
+    m_size(0),
+    m_uniformAlignment(TRANSIENT_VERTEX_ALIGNMENT),
+    m_head(0),
+    m_tail(0),
+    m_frameSlot(0)
+{
+}
+
+void TransientBuffer::init(VkBuffer buffer, void* mappedData, VkDeviceSize size, VkDeviceSize uniformAlignment, uint32_t framesInFlight)
+{
+    m_buffer            = buffer;
+    m_mappedData        = static_cast<uint8_t*>(mappedData);
+    m_uniformAlignment  = std::max<VkDeviceSize>(uniformAlignment, TRANSIENT_VERTEX_ALIGNMENT);
+    // the offsets are aligned on the running total, the same as in the buffer then
+    m_size              = size - size % m_uniformAlignment;
+    m_head              = 0;
+    m_tail              = 0;
+    m_frames.assign(std::max(1u, framesInFlight), FrameRange{ 0, 0 });
+    m_frameSlot         = 0;
+}
+
+void TransientBuffer::beginFrame(uint64_t frameNumber, uint64_t completedFrame)
+{
+    // the space of the completed frames is free again. A slot overwritten
+    // before its frame completed only delays that, the later frames end after it.
+    for (const FrameRange& frame : m_frames)
+    {
+        if (frame.frameNumber != 0 && frame.frameNumber <= completedFrame)
+            m_tail = std::max(m_tail, frame.end);
+    }
+
+    m_frameSlot = static_cast<uint32_t>(frameNumber % m_frames.size());
+    if (m_frames[m_frameSlot].frameNumber != frameNumber)
+        m_frames[m_frameSlot] = FrameRange{ frameNumber, m_head };
+}
+
+TransientAllocation TransientBuffer::allocate(VkDeviceSize size, TransientUsage usage)
+{
+    const VkDeviceSize alignment = getAlignment(usage);
+
+    uint64_t start = (m_head + alignment - 1) / alignment * alignment;
+    // doesn't fit before the end of the buffer, starts over from the beginning
+    if (start % m_size + size > m_size)
+        start = (start / m_size + 1) * m_size;
+
+    // would overwrite the data of a frame in flight
+    if (size > m_size || start + size - m_tail > m_size)
+        return TransientAllocation{ nullptr, m_buffer, 0 };
+
+    m_head = start + size;
+    m_frames[m_frameSlot].end = m_head;
+
+    const VkDeviceSize offset = start % m_size;
+    return TransientAllocation{ m_mappedData + offset, m_buffer, offset };
+}
+
+VkDeviceSize TransientBuffer::getAlignment(TransientUsage usage) const
+{
+    switch (usage)
+    {
+    case TransientUsage::Index:     return sizeof(uint32_t);
+    case TransientUsage::Uniform:   return m_uniformAlignment;
+    case TransientUsage::Vertex:
+    default:                        return TRANSIENT_VERTEX_ALIGNMENT;
+    }
+}
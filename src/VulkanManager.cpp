@@ -1,5 +1,9 @@
 #include "VulkanManager.h"
+#include "ShaderTypes.h"
+#include "ImageWriter.h"
 #include "Common.h"
+#include "Profiler.h"
+#include "HostAllocator.h"
 
 // required for window surface (by Vulkan)
 // reference) https://www.khronos.org/registry/vulkan/specs/1.2-extensions/html/vkspec.html#vkCreateMacOSSurfaceMVK
@@ -20,13 +24,10 @@
 #endif  // defined(_WIN32) || defined(_WIN64)
 #include <GLFW/glfw3native.h>
 
-// glm
-#define GLM_FORCE_RADIANS   // use radians by default on any parameters
-#include <glm/glm.hpp>
+// glm (see VulkanManager.h)
 #include <glm/gtc/matrix_transform.hpp>
 
-// stb
-#define STB_IMAGE_IMPLEMENTATION
+// stb (implemented in StbImage.cpp)
 #include "stb_image.h"
 
 // std
@@ -38,12 +39,31 @@
 #include <fstream>
 #include <array>
 #include <chrono>
+#include <exception>    // std::exception_ptr
+#include <cstring>      // strcmp, memcpy
 
 
 // --------------------------< Internal build options >--------------------------
 
-#define MAX_FRAMES_IN_FLIGHT 2
+#define DEFAULT_MAX_FRAMES_IN_FLIGHT 2     // see setMaxFramesInFlight()
+#define DEFAULT_MSAA_SAMPLES    4          // see setMsaaSamples(), clamped to the device's maximum
+#define MAX_DRAW_INSTANCES      1024       // world matrices per instance buffer, see createInstanceBuffers()
+#define MAX_SPRITES_PER_FRAME   131072     // the rest is dropped, see createSpriteResources()
+#define MAX_SPRITE_TEXTURES     64         // descriptor sets, see addSpriteTexture()
+#define FRAME_ARENA_SIZE        (64 * 1024) // initial, grows to the biggest frame (see LinearArena)
+#define TRANSIENT_BUFFER_FRAME_SIZE (16 * 1024 * 1024)  // per frame in flight, see createTransientBuffer()
 #define USE_STAGING_BUFFER    // see createVertexBuffer()
+#define SHADER_DIR          "../src/shaders/"   // GLSL sources, see createGraphicsPipeline()
+#define SHADER_CACHE_DIR    "shader_cache/"     // compiled SPIR-V, relative to the working directory
+#define VERT_SHADER         "shader.vert"
+#define FRAG_SHADER         "shader.frag"
+#define IMAGE_OPS_SHADER    "image_ops.comp"    // see processImage()
+#define SPRITE_VERT_SHADER  "sprite.vert"
+#define SPRITE_FRAG_SHADER  "sprite.frag"
+#define PIPELINE_CACHE_FILE "pipeline_cache.bin"    // see PipelineCompiler
+#define MEMORY_REPORT_INTERVAL_SEC  30      // periodic GPU memory report, 0 to disable (see MemoryTracker)
+#define USE_PIPELINE_STATISTICS     // GPU counters per pass, when supported (see GpuStats)
+// #define USE_OCCLUSION_QUERIES    // samples passed per draw group (see GpuStats)
 
 // ---------------------------< Struct definitions >-----------------------------
 
@@ -64,107 +84,25 @@ struct SwapchainSupportDetails
    std::vector<VkPresentModeKHR> presentModes;
 };
 
-struct Vertex
-{
-    glm::vec2 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-
-    // Vertex Binding: describes at which rate the vertex data should be loaded.
-    static VkVertexInputBindingDescription getBindingDesc()
-    {
-        VkVertexInputBindingDescription vertexInputBindingDesc{};
-        vertexInputBindingDesc.binding      = 0;    // index of the binding
-        vertexInputBindingDesc.stride       = sizeof(Vertex);
-        // available options are:
-        // VK_VERTEX_INPUT_RATE_VERTEX: move to next data entry after each vertex
-        // VK_VERTEX_INPUT_RATE_INSTANCE: move to next data entry after each instance
-        vertexInputBindingDesc.inputRate    = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return vertexInputBindingDesc;
-    }
-
-    // Attribute Binding: how to extract a chunk of attribute vertex data
-    // from binding description. Here we have 3: position, color, textCoord
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDesc()
-    {
-        std::array<VkVertexInputAttributeDescription, 3> vertexInputAttributeDesc{};
-        const int iPos      = 0;
-        const int iColor    = 1;
-        const int iTex      = 2;
-
-        vertexInputAttributeDesc[iPos].binding  = 0;    // from which binding per-vertex comes from
-        vertexInputAttributeDesc[iPos].location = 0;    // in the shader, (location = x)
-        // common formats:
-        // float: VK_FORMAT_R32_SFLOAT
-        // vec2: VK_FORMAT_R32G32_SFLOAT
-        // vec3: VK_FORMAT_R32G32B32_SFLOAT
-        // vec4: VK_FORMAT_R32G32B32A32_SFLOAT
-        vertexInputAttributeDesc[iPos].format   = VK_FORMAT_R32G32_SFLOAT;
-        vertexInputAttributeDesc[iPos].offset   = offsetof(Vertex, pos);
-
-        vertexInputAttributeDesc[iColor].binding  = 0;    // from which binding per-vertex comes from
-        vertexInputAttributeDesc[iColor].location = 1;    // in the shader, (location = x)
-        vertexInputAttributeDesc[iColor].format   = VK_FORMAT_R32G32B32_SFLOAT;
-        vertexInputAttributeDesc[iColor].offset   = offsetof(Vertex, color);
-
-        vertexInputAttributeDesc[iTex].binding  = 0;    // from which binding per-vertex comes from
-        vertexInputAttributeDesc[iTex].location = 2;    // in the shader, (location = x)
-        vertexInputAttributeDesc[iTex].format   = VK_FORMAT_R32G32_SFLOAT;
-        vertexInputAttributeDesc[iTex].offset   = offsetof(Vertex, texCoord);
-
-        return vertexInputAttributeDesc;
-    }
-};
-
-struct UniformBufferObject
-{
-    // Data alignment: Vulkan requires the memory to be aligned in a specific way:
-    // scalar(4) vec2(8) vec3/vec4/mat4(16), nested struct(x*16) in bytes
-    // So, here we use the alignas(C++11 feature) to make sure mat4 is aligned 16.
-    // It doesn't matter just like this (i.e already aligned 16,16,16 bytes) but it
-    // can be easily broken down by adding any other components such as vec2.
-    alignas(16)
-    glm::mat4 model;
-    alignas(16)
-    glm::mat4 view;
-    alignas(16)
-    glm::mat4 proj;
-};
-
+// Vertex, InstanceData and UniformBufferObject are in ShaderTypes.h
 
-// -----------------------------< Utils >-----------------------------
-
-static std::vector<char> readFile(const std::string& filename)
-{
-    // ate: start reading at the end, binary: read as binary file
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    PRINTLN("open file - " + filename);
-
-    if (!file.is_open())
-        throw std::runtime_error("failed to open file - " + filename + "");
-
-    // as we read at the end, we can instantly determine the size of the file'
-    size_t filesize = (size_t) file.tellg();
-    std::vector<char> buffer(filesize);
-
-    // go back to the beginning and read all at once
-    file.seekg(0);
-    file.read(buffer.data(), filesize);
-
-    file.close();
-
-    return buffer;
-}
 
 // -----------------------------< Hard-coded >-----------------------------
 
 const std::vector<Vertex> vertices
 {                                       // Normalized Device Coordiante (NDC):
-    { {-0.5, -0.5}, {1.0, 0.0, 0.0}, {1.0, 0.0} },  // [-1,-1]-------------[1,-1]
-    { {0.5, -0.5}, {0.0, 1.0, 0.0}, {0.0, 0.0} },   //    |                  |
-    { {0.5, 0.5}, {0.0, 1.0, 0.0}, {0.0, 1.0} },    //    |                  |
-    { {-0.5, 0.5}, {0.0, 0.0, 1.0}, {1.0, 1.0} }    // [-1, 1]-------------[1, 1]
+    { {-0.5, -0.5, 0.0}, {1.0, 0.0, 0.0}, {1.0, 0.0} },  // [-1,-1]-------------[1,-1]
+    { {0.5, -0.5, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0} },   //    |                  |
+    { {0.5, 0.5, 0.0}, {0.0, 1.0, 0.0}, {0.0, 1.0} },    //    |                  |
+    { {-0.5, 0.5, 0.0}, {0.0, 0.0, 1.0}, {1.0, 1.0} }    // [-1, 1]-------------[1, 1]
+};
+
+// the quad, drawn at these heights (overlapping, see sortOpaqueDraws) as
+// children of the rotating scene root
+const std::vector<float> quadHeights
+{
+    0.0f,
+    -0.5f
 };
 
 const std::vector<uint32_t> indices
@@ -185,11 +123,70 @@ VulkanManager::VulkanManager() :
     m_device(VK_NULL_HANDLE),
     m_validationLayers({ "VK_LAYER_KHRONOS_validation" }),
     m_deviceExtensions({ VK_KHR_SWAPCHAIN_EXTENSION_NAME, "VK_KHR_portability_subset" }),
-    m_curretFrameIndex(0),
-    m_frameBufferResized(false)
+    m_swapchain(VK_NULL_HANDLE),
+    m_isCaptureSupported(false),
+    m_recordingCapture(nullptr),
+    m_imageProcessingSetLayout(VK_NULL_HANDLE),
+    m_imageProcessingPipelineLayout(VK_NULL_HANDLE),
+    m_imageProcessingPipeline(VK_NULL_HANDLE),
+    m_imageProcessingSampler(VK_NULL_HANDLE),
+    m_graphicsPipeline(VK_NULL_HANDLE),
+    m_isGraphicsPipelineOutdated(false),
+    m_shaderCompiler(SHADER_DIR, SHADER_CACHE_DIR),
+    m_depthFormat(VK_FORMAT_UNDEFINED),
+    m_depthImage(VK_NULL_HANDLE),
+    m_depthImageMemory(VK_NULL_HANDLE),
+    m_depthImageView(VK_NULL_HANDLE),
+    m_requestedMsaaSamples(DEFAULT_MSAA_SAMPLES),
+    m_msaaSamples(static_cast<VkSampleCountFlagBits>(0)),   // see createColorResources()
+    m_colorImage(VK_NULL_HANDLE),
+    m_colorImageMemory(VK_NULL_HANDLE),
+    m_colorImageView(VK_NULL_HANDLE),
+    m_sceneRoot(INVALID_TRANSFORM),
+    m_viewMatrix(1.0f),
+    m_animationTime(-1.0f),
+    m_spriteSetLayout(VK_NULL_HANDLE),
+    m_spritePipelineLayout(VK_NULL_HANDLE),
+    m_spritePipeline(VK_NULL_HANDLE),
+    m_spriteDescriptorPool(VK_NULL_HANDLE),
+    m_spriteIndexBuffer(VK_NULL_HANDLE),
+    m_spriteIndexBufferMemory(VK_NULL_HANDLE),
+    m_spriteVertexOffset(0),
+    m_transientVkBuffer(VK_NULL_HANDLE),
+    m_transientBufferMemory(VK_NULL_HANDLE),
+    m_recordingFrameIndex(0),
+    m_maxFramesInFlight(DEFAULT_MAX_FRAMES_IN_FLIGHT),
+    m_frameBufferResized(false),
+    m_frameTimeline(VK_NULL_HANDLE),
+    m_frameCounter(0),
+    m_completedFrame(0)
 {
 };
 
+void VulkanManager::setMaxFramesInFlight(uint32_t maxFramesInFlight)
+{
+    // the per-frame semaphores are created in createSyncObjects(), so this
+    // can only be changed before the initialization.
+    if (m_device != VK_NULL_HANDLE)
+        throw std::runtime_error("max frames in flight must be set before initVulkan()");
+
+    m_maxFramesInFlight = std::max(1u, maxFramesInFlight);
+}
+
+void VulkanManager::setAnimationTime(float seconds)
+{
+    m_animationTime = seconds;
+}
+
+void VulkanManager::setMsaaSamples(uint32_t sampleCount)
+{
+    // the render pass and the pipeline are created with it
+    if (m_device != VK_NULL_HANDLE)
+        throw std::runtime_error("MSAA samples must be set before initVulkan()");
+
+    m_requestedMsaaSamples = std::max(1u, sampleCount);
+}
+
 
 void VulkanManager::initVulkan(GLFWwindow* window)
 {
@@ -198,8 +195,51 @@ void VulkanManager::initVulkan(GLFWwindow* window)
 
     m_window = window;
 
+    const uint64_t initStartTime = Profiler::now();
     bool result = true;
 
+    // Initialization is a dependency graph rather than a sequence. The device
+    // gates everything else, then the steps that don't depend on each other
+    // (asset loading and upload, shaders and pipelines) run as jobs while the
+    // main thread builds the swapchain related objects. Startup is then bounded
+    // by the longest chain, not by the sum of all the steps.
+    //
+    //  instance - device - command pool -+- texture image - texture view -+
+    //                                    +- texture sampler --------------+
+    //                                    +- vertex buffer ----------------+
+    //                                    +- index buffer -----------------+
+    //                                    |                                +- descriptor sets, command buffers
+    //                                    +- (main) swapchain, render pass, pipeline layout, uniform buffers...
+    //  shader sources ------------------------------ graphics pipeline (see createGraphicsPipeline)
+    //
+    // NOTE: GLFW and the swapchain stay on the main thread (window system calls).
+
+    // errors in the jobs are rethrown here, on the main thread
+    std::atomic<bool>   isInitJobFailed(false);
+    std::exception_ptr  initJobError;
+    std::mutex          initJobErrorMutex;
+    auto runInitJob = [&](bool (VulkanManager::*initStep)())
+    {
+        if (isInitJobFailed)
+            return;     // a step it depends on may have failed
+        try
+        {
+            if (!(this->*initStep)())
+                isInitJobFailed = true;
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(initJobErrorMutex);
+            if (!initJobError)
+                initJobError = std::current_exception();
+            isInitJobFailed = true;
+        }
+    };
+
+    // Shaders
+    // no Vulkan object is involved, compiling them overlaps the instance/device creation
+    m_jobSystem.schedule([this]() { prefetchShaders(); }, &m_shadersLoaded);
+
     // Initial Setup
     result &= createVulkanInstance();
     result &= createDebugMessenger();
@@ -209,35 +249,71 @@ void VulkanManager::initVulkan(GLFWwindow* window)
     result &= createWindowSurface();
     result &= loadPhysicalDevice();
     result &= createLogicalDevice();
+    result &= createCommandPool();      // used by the upload jobs
     PRINT_BAR_DOTS();
+
+    // Assets
+    JobCounter textureLoaded;
+    JobCounter assetsLoaded;
+    // the jobs reference this stack frame, don't leave it (i.e. on exception) before they are done
+    struct AssetsLoadedGuard
+    {
+        JobSystem&  jobSystem;
+        JobCounter& counter;
+        ~AssetsLoadedGuard() { jobSystem.wait(counter); }
+    } assetsLoadedGuard{ m_jobSystem, assetsLoaded };
+    m_jobSystem.schedule([&runInitJob]() { runInitJob(&VulkanManager::createTextureImage); }, &textureLoaded);
+    m_jobSystem.schedule([&runInitJob]() { runInitJob(&VulkanManager::createTextureImageView); }, &assetsLoaded, { &textureLoaded });
+    m_jobSystem.schedule([&runInitJob]() { runInitJob(&VulkanManager::createTextureSampler); }, &assetsLoaded);
+    m_jobSystem.schedule([&runInitJob]() { runInitJob(&VulkanManager::createVertexBuffer); }, &assetsLoaded);
+    m_jobSystem.schedule([&runInitJob]() { runInitJob(&VulkanManager::createIndexBuffer); }, &assetsLoaded);
+
     result &= createSwapChain();
     result &= createImageViews();
+    result &= createColorResources();
+    result &= createDepthResources();
     PRINT_BAR_DOTS();
 
     // Graphics Pipeline
+    // pipelines are built on worker threads, the rest of the initialization
+    // goes on while the driver compiles them.
+    {
+        PROFILE_ZONE("initPipelineCompiler");
+        m_pipelineCompiler.init(m_device, PIPELINE_CACHE_FILE, m_jobSystem);
+    }
+    result &= createRenderGraph();
     result &= createRenderPass();
     result &= createDescriptorSetLayout();
+    result &= createPipelineLayout();
+    result &= createTransientBuffer();
+    result &= createSpriteResources();
     result &= createGraphicsPipeline();
     PRINT_BAR_DOTS();
 
     // Drawing
     result &= createFrameBuffers();
-    result &= createCommandPool();
-
-    result &= createTextureImage();
-    result &= createTextureImageView();
-    result &= createTextureSampler();
-
-    result &= createVertexBuffer();
-    result &= createIndexBuffer();
     result &= createUniformBuffers();
     result &= createDescriptorPool();
+
+    // the rest needs the assets
+    {
+        PROFILE_ZONE("waitForAssets");
+        m_jobSystem.wait(assetsLoaded);
+    }
+    if (initJobError)
+        std::rethrow_exception(initJobError);
+    result &= !isInitJobFailed;
+
     result &= createDescriptorSets();
+    result &= createSpriteTextures();
+    result &= createDrawList();
+    result &= createInstanceBuffers();
     result &= createCommandBuffers();
     PRINT_BAR_DOTS();
 
     // Rendering & Presentation
     result &= createSyncObjects();
+    Profiler::recordZone("initVulkan", initStartTime, Profiler::now());
 
     PRINT_BAR_DOTS();
     if (result)
@@ -245,39 +321,142 @@ void VulkanManager::initVulkan(GLFWwindow* window)
     else
         PRINTLN("Vulkan Manager initialization finished with errors");
     PRINT_BAR_LINE();
+
+    // where the startup time goes. Pipelines still compiling in the background
+    // are not included, they show up once they are done.
+    Profiler::printReport("Startup timings", initStartTime, "initVulkan");
+    m_memoryTracker.printReport();
+    HostAllocator::printReport();
+    m_lastMemoryReportTime = std::chrono::steady_clock::now();
 }
 
 void VulkanManager::drawFrame()
 {
-    m_curretFrameIndex = (m_curretFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
-    uint32_t imgIndex;
-    acquireNextImageIndex(m_curretFrameIndex, imgIndex);
+    PROFILE_FUNCTION();
+
+    {
+        PROFILE_ZONE("drawFrame.updatePipelines");
+        // hot reload: rebuild the pipeline if one of its shaders has been modified
+        reloadChangedShaders();
+        // swap in the pipelines that finished compiling
+        updateGraphicsPipeline();
+    }
 
-    updateUniformBuffer(imgIndex);
+    // frame numbers start from 1, so the timeline value 0 means "nothing submitted yet"
+    const uint64_t frameNumber  = m_frameCounter + 1;
+    const uint32_t frameIndex   = static_cast<uint32_t>(frameNumber % m_maxFramesInFlight);
 
     // CPU - GPU syncronization.
     // Normally at this point, GPU work speed cannot follow up the CPU work
     // submission speed, ending up submission queue growing by time. Validation
     // Layer raises an error or warning about this if enbled.
     // There are two ways you can handle this:
+    {
+        PROFILE_ZONE("drawFrame.frameWait");
 #if 0
-    // Quick & lazy way
-    vkQueueWaitIdle(m_presentationQueue);   // no need of any fences
+        // Quick & lazy way
+        vkQueueWaitIdle(m_presentationQueue);   // no need of any fences
 #else
-    // Frames in Flight
-    // check if the previous image is using this image
-    if (m_imagesInFlight[imgIndex] != VK_NULL_HANDLE)
-        // Wait for any or all of the passed fences (VK_TRUE means wait for ALL of them).
-        vkWaitForFences(m_device, 1, &m_imagesInFlight[imgIndex], VK_TRUE, UINT64_MAX);
-    // mark current frame is using this image
-    m_imagesInFlight[imgIndex] = m_inFlightFences[m_curretFrameIndex];
-
-    // Reset fences into 'unsignaled' state
-    vkResetFences(m_device, 1, &m_inFlightFences[m_curretFrameIndex]);
+        // Frames in Flight
+        // the semaphores of this frame slot were last used by (frameNumber - maxFramesInFlight)
+        if (frameNumber > m_maxFramesInFlight)
+            waitForFrame(frameNumber - m_maxFramesInFlight);
 #endif
+    }
+
+    // the previous frame of the slot is done with what it allocated
+    LinearArena& frameArena = m_frameArenas[frameIndex];
+    frameArena.reset();
+    m_transientBuffer.beginFrame(frameNumber, getCompletedFrame());
+
+    {
+        PROFILE_ZONE("drawFrame.gpuStats");
+        // the previous frame of the slot is complete, its queries are reused
+        m_gpuStats.collect(frameIndex);
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.captures");
+        // the captures of the completed frames are written by jobs
+        processCaptures();
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.deletionQueue");
+        // the command pool is shared with the single time commands
+        std::lock_guard<std::mutex> lock(m_singleTimeCommandsMutex);
+        m_deletionQueue.flush(getCompletedFrame());
+    }
+
+    uint32_t imgIndex;
+    {
+        PROFILE_ZONE("drawFrame.acquire");
+        if (!acquireNextImageIndex(frameIndex, imgIndex))
+            return;     // swapchain has been recreated, skip this frame
+    }
+
+    // check if a previous frame is still using this image, then mark
+    // current frame is using this image
+    {
+        PROFILE_ZONE("drawFrame.imageWait");
+        waitForFrame(m_imageFrameNumbers[imgIndex]);
+        m_imageFrameNumbers[imgIndex] = frameNumber;
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.updateUniformBuffer");
+        updateUniformBuffer(imgIndex);
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.updateTransforms");
+        m_transforms.update(&m_jobSystem);
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.sortOpaqueDraws");
+        sortOpaqueDraws(frameArena);
+        updateInstanceBuffer(imgIndex);
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.updateSpriteBuffer");
+        updateSpriteBuffer();
+    }
 
-    submitCommandBuffer(m_curretFrameIndex, imgIndex);
-    submitPresentation(m_curretFrameIndex, imgIndex);
+    // not in use anymore, recorded every frame with the sorted draws
+    {
+        PROFILE_ZONE("drawFrame.recordCommandBuffer");
+        m_recordingCapture      = nullptr;
+        m_recordingFrameIndex   = frameIndex;
+        if (!m_captureRequests.empty())
+            beginCapture(frameIndex);
+        recordCommandBuffer(imgIndex);
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.submit");
+        submitCommandBuffer(frameIndex, imgIndex, frameNumber);
+        m_frameCounter = frameNumber;
+        if (m_recordingCapture)
+            m_recordingCapture->frameNumber = frameNumber;
+    }
+
+    {
+        PROFILE_ZONE("drawFrame.present");
+        submitPresentation(frameIndex, imgIndex);
+    }
+
+#if MEMORY_REPORT_INTERVAL_SEC > 0
+    auto currentTime = std::chrono::steady_clock::now();
+    if (currentTime - m_lastMemoryReportTime > std::chrono::seconds(MEMORY_REPORT_INTERVAL_SEC))
+    {
+        m_memoryTracker.printReport();
+        HostAllocator::printReport();
+        m_gpuStats.printReport(uint64_t(m_swapchainExtent.width) * m_swapchainExtent.height);
+        m_lastMemoryReportTime = currentTime;
+    }
+#endif
 }
 
 
@@ -290,6 +469,8 @@ void VulkanManager::drawFrame()
 
 bool VulkanManager::createVulkanInstance()
 {
+    PROFILE_FUNCTION();
+
     // in vulkan, in many cases, data is passed through different structs
     // instead of function parameters. Each vulkan struct requires to specify
     // the type into the member 'sType'.
@@ -301,7 +482,7 @@ bool VulkanManager::createVulkanInstance()
     vkAppInfo.applicationVersion  = VK_MAKE_VERSION(1, 0, 0);
     vkAppInfo.pEngineName         = "No Engine";
     vkAppInfo.engineVersion       = VK_MAKE_VERSION(1, 0, 0);
-    vkAppInfo.apiVersion          = VK_API_VERSION_1_0;
+    vkAppInfo.apiVersion          = VK_API_VERSION_1_2;  // timeline semaphores are core in 1.2
 
     // struct: vulkan instance information
     VkInstanceCreateInfo vkCreateInfo{};
@@ -337,9 +518,9 @@ bool VulkanManager::createVulkanInstance()
 
     // this is a general pattern of creating a vulkan object:
     VkResult result = vkCreateInstance(
-        &vkCreateInfo,  // pointer to a struct that defines the object
-        nullptr,        // pointer to custom allocator callbacks
-        &m_VkInstance   // pointer to a variable that will store the object
+        &vkCreateInfo,                  // pointer to a struct that defines the object
+        HostAllocator::getCallbacks(),  // pointer to custom allocator callbacks (see HostAllocator)
+        &m_VkInstance                   // pointer to a variable that will store the object
     );
 
     if (result != VK_SUCCESS)
@@ -431,6 +612,8 @@ std::vector<const char*> VulkanManager::loadVKExtensions()
 // for much more different ways to setup debug messenger.
 bool VulkanManager::createDebugMessenger()
 {
+    PROFILE_FUNCTION();
+
     if (!enableValidationLayers)
         return true;
 
@@ -449,7 +632,7 @@ bool VulkanManager::createDebugMessenger()
     createInfo.pUserData        = nullptr;
 
     // create messenger via vkCreateDebugUtilsMessengerEXT
-    if (createDebugUtilsMessengerEXT(m_VkInstance, &createInfo, nullptr, &m_debugMessenger) != VK_SUCCESS)
+    if (createDebugUtilsMessengerEXT(m_VkInstance, &createInfo, HostAllocator::getCallbacks(), &m_debugMessenger) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed set up debug messenger!");
         return false;
@@ -541,6 +724,8 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanManager::debugCallback(
 
 bool VulkanManager::loadPhysicalDevice()
 {
+    PROFILE_FUNCTION();
+
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(m_VkInstance, &deviceCount, nullptr);
     std::vector<VkPhysicalDevice> devices(deviceCount);
@@ -631,17 +816,44 @@ bool VulkanManager::isDeviceSuitable(VkPhysicalDevice device)
             PRINTLN("Extension) Swapchain supported for this device");
     }
 
-    VkPhysicalDeviceFeatures supportedFeatures;
-    vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+    // timeline semaphores (frame syncronization) requires Vulkan 1.2
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+        return false;
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
 
     return  indices.isComplete() &&
             extensionSupported &&
             swapchainAdequate &&
-            supportedFeatures.samplerAnisotropy;
+            supportedFeatures.features.samplerAnisotropy &&
+            timelineFeatures.timelineSemaphore;
 }
 
 // this will check whether the physical device supports everything
 // that is required, defined in our vector m_deviceExtensions
+bool VulkanManager::isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName)
+{
+    uint32_t n_extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &n_extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(n_extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &n_extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (strcmp(extension.extensionName, extensionName) == 0)
+            return true;
+    }
+    return false;
+}
+
 bool VulkanManager::checkDeviceExtensionSupport(VkPhysicalDevice device)
 {
     uint32_t n_extensionCount;
@@ -689,7 +901,8 @@ QueueFamilyIndices VulkanManager::findQueueFamilies(VkPhysicalDevice device)
         VkBool32 presentationSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_windowSurface, &presentationSupport);
 
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        // compute too, for the image processing (at least one graphics family supports both)
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
             indices.graphicsFamily = i;
         if (presentationSupport)
             indices.presentationFamily = i;
@@ -716,6 +929,8 @@ QueueFamilyIndices VulkanManager::findQueueFamilies(VkPhysicalDevice device)
 
 bool VulkanManager::createLogicalDevice()
 {
+    PROFILE_FUNCTION();
+
     // 1. specify the queue to be created
     QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
 
@@ -745,17 +960,36 @@ bool VulkanManager::createLogicalDevice()
     // using 'VkPhysicalDeviceFeatures' (e.g. geometry shaders)
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // optional ones, for the GPU stats
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+#ifdef USE_PIPELINE_STATISTICS
+    deviceFeatures.pipelineStatisticsQuery  = supportedFeatures.pipelineStatisticsQuery;
+#endif
+#ifdef USE_OCCLUSION_QUERIES
+    deviceFeatures.occlusionQueryPrecise    = supportedFeatures.occlusionQueryPrecise;
+#endif
+    // features that are not part of VkPhysicalDeviceFeatures are chained through pNext
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore  = VK_TRUE;
 
     // 3. Create the logical device
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType                      = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceCreateInfo.pNext                      = &timelineFeatures;
     deviceCreateInfo.pQueueCreateInfos          = queueCreateInfos.data();
     deviceCreateInfo.queueCreateInfoCount       = static_cast<uint32_t>(queueCreateInfos.size());
     deviceCreateInfo.pEnabledFeatures           = &deviceFeatures;
 
     // device extensions
-    deviceCreateInfo.enabledExtensionCount      = static_cast<uint32_t>(m_deviceExtensions.size());
-    deviceCreateInfo.ppEnabledExtensionNames    = m_deviceExtensions.data();
+    // optional ones are enabled on top of the required ones, when supported
+    std::vector<const char*> enabledExtensions = m_deviceExtensions;
+    const bool isMemoryBudgetSupported = isDeviceExtensionSupported(m_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (isMemoryBudgetSupported)
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    deviceCreateInfo.enabledExtensionCount      = static_cast<uint32_t>(enabledExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames    = enabledExtensions.data();
 
     // notice that we've already set the extension & validation layers for VkInstance.
     // we do the same thing for the physical device, which is actually not necessary
@@ -770,7 +1004,7 @@ bool VulkanManager::createLogicalDevice()
         deviceCreateInfo.enabledLayerCount = 0;
 
     // 4. Instantiate logical device!
-    if (vkCreateDevice(m_physicalDevice, &deviceCreateInfo, nullptr, &m_device) != VK_SUCCESS)
+    if (vkCreateDevice(m_physicalDevice, &deviceCreateInfo, HostAllocator::getCallbacks(), &m_device) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create Vulkan logical device");
         return false;
@@ -783,6 +1017,19 @@ bool VulkanManager::createLogicalDevice()
     vkGetDeviceQueue(m_device, indices.graphicsFamily.value(), k_queueIndex, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentationFamily.value(), k_queueIndex, &m_presentationQueue);
 
+    // 6. Every allocation goes through the memory tracker from now on
+    m_memoryTracker.init(m_physicalDevice, isMemoryBudgetSupported);
+    m_deletionQueue.init(m_device, &m_memoryTracker);
+
+    // 7. Queries of the frames in flight
+#ifdef USE_OCCLUSION_QUERIES
+    const bool isOcclusionEnabled = true;
+#else
+    const bool isOcclusionEnabled = false;
+#endif
+    m_gpuStats.init(m_device, m_maxFramesInFlight, deviceFeatures.pipelineStatisticsQuery == VK_TRUE,
+                    isOcclusionEnabled, deviceFeatures.occlusionQueryPrecise == VK_TRUE);
+
     PRINTLN("Created logical device");
 
     return true;
@@ -799,11 +1046,13 @@ bool VulkanManager::createLogicalDevice()
 
 bool VulkanManager::createWindowSurface()
 {
+    PROFILE_FUNCTION();
+
     // Normally, you would create an Vulkan object for surface creation
     // (eg. VkWin32SurfaceCreateInfoKHR createInfo{} ...)
     // however, glfw automatically handles this.
 
-    if (glfwCreateWindowSurface(m_VkInstance, m_window, nullptr, &m_windowSurface) != VK_SUCCESS)
+    if (glfwCreateWindowSurface(m_VkInstance, m_window, HostAllocator::getCallbacks(), &m_windowSurface) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create window surface");
         return false;
@@ -825,6 +1074,8 @@ bool VulkanManager::createWindowSurface()
 
 bool VulkanManager::createSwapChain()
 {
+    PROFILE_FUNCTION();
+
     SwapchainSupportDetails swapChainSupport = querySwapChainSupport(m_physicalDevice);
 
     // load main swapchain settings
@@ -854,6 +1105,10 @@ bool VulkanManager::createSwapChain()
     // VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT - render directly
     // VK_IMAGE_USAGE_TRANSFER_DST_BIT - render separately (i.e need to use this for post-processing)
     swapchainCreateInfo.imageUsage          = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // VK_IMAGE_USAGE_TRANSFER_SRC_BIT - copied from by the frame captures (see captureFrame)
+    m_isCaptureSupported = (swapChainSupport.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+    if (m_isCaptureSupported)
+        swapchainCreateInfo.imageUsage     |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
 
     // Specify how to handle swapchain images that will be used across multiple queue families.
@@ -892,15 +1147,21 @@ bool VulkanManager::createSwapChain()
     // clip (do not draw) if the pixel is covered by another window
     swapchainCreateInfo.clipped = VK_TRUE;  // clip it
 
-    // A bit complex topic, in case the program fails and need to create the swapchain
-    // again from scratch, should Vulkan should keep the old swapchain as a reference.
-    swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;  // no. only create one swapchain ever.
+    // When the swapchain is re-created (i.e. window resize), the old one is passed
+    // along. The driver can reuse its resources, and the presents already queued
+    // on it still go through while the new one is being used.
+    const VkSwapchainKHR oldSwapchain = m_swapchain;
+    swapchainCreateInfo.oldSwapchain = oldSwapchain;    // VK_NULL_HANDLE the first time
 
 
     // Finally, create swapchain
-    if (vkCreateSwapchainKHR(m_device, &swapchainCreateInfo, nullptr, &m_swapchain) != VK_SUCCESS)
+    if (vkCreateSwapchainKHR(m_device, &swapchainCreateInfo, HostAllocator::getCallbacks(), &m_swapchain) != VK_SUCCESS)
         throw std::runtime_error("Failed to create swapcahin!");
 
+    // the old one is retired: no more acquire, destroyed after the frames that used it
+    if (oldSwapchain != VK_NULL_HANDLE)
+        m_deletionQueue.releaseSwapchain(getReleaseFrame(), oldSwapchain);
+
     // retr ieve swapchain images
     vkGetSwapchainImagesKHR(m_device, m_swapchain, &n_ImageCount, nullptr);
     m_swapchainImages.resize(n_ImageCount);
@@ -916,6 +1177,8 @@ bool VulkanManager::createSwapChain()
 
 bool VulkanManager::recreateSwapChain()
 {
+    PROFILE_FUNCTION();
+
     // Swapchain information can be outdated such when window size has changed.
     // In that case, we will need to create a new swapchain.
 
@@ -929,17 +1192,49 @@ bool VulkanManager::recreateSwapChain()
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(m_device);
+    // No device wait here. The frames in flight keep rendering to the old
+    // swapchain with the old objects, which are released to the deletion
+    // queue and destroyed once those frames are complete. The old swapchain
+    // itself is handed over to the new one (see createSwapChain).
+    retireSwapChain();
 
-    cleanSwapChain();
+    const VkFormat prevImageFormat = m_swapchainImageFormat;
 
     bool result = true;
     result &= createSwapChain();
+    // the new images are not used by any frame yet
+    m_imageFrameNumbers.assign(m_swapchainImages.size(), 0);
     result &= createImageViews();
-    result &= createRenderPass();
-    result &= createGraphicsPipeline();
+    result &= createColorResources();
+    result &= createDepthResources();
+
+    // viewport and scissor are dynamic states, so the render pass and the
+    // pipeline only need to be re-created if the image format has changed
+    if (m_swapchainImageFormat != prevImageFormat)
+    {
+        // a pending build references the old render pass
+        for (std::shared_future<VkPipeline>* pendingPipeline : { &m_pendingGraphicsPipeline, &m_pendingSpritePipeline })
+        {
+            if (!pendingPipeline->valid())
+                continue;
+            try { m_deletionQueue.releasePipeline(getReleaseFrame(), pendingPipeline->get()); }
+            catch (const std::exception&) {}
+            *pendingPipeline = {};
+        }
+        if (m_graphicsPipeline != VK_NULL_HANDLE)
+            m_deletionQueue.releasePipeline(getReleaseFrame(), m_graphicsPipeline);
+        if (m_spritePipeline != VK_NULL_HANDLE)
+            m_deletionQueue.releasePipeline(getReleaseFrame(), m_spritePipeline);
+        m_deletionQueue.releaseRenderPass(getReleaseFrame(), m_renderPass);
+        m_graphicsPipeline  = VK_NULL_HANDLE;   // skip drawing until the new ones are ready
+        m_spritePipeline    = VK_NULL_HANDLE;
+
+        result &= createRenderPass();
+        result &= createGraphicsPipeline();
+    }
     result &= createFrameBuffers();
     result &= createUniformBuffers();
+    result &= createInstanceBuffers();
     result &= createDescriptorPool();
     result &= createDescriptorSets();
     result &= createCommandBuffers();
@@ -947,6 +1242,48 @@ bool VulkanManager::recreateSwapChain()
     return result;
 }
 
+void VulkanManager::retireSwapChain()
+{
+    // same as cleanSwapChain(), through the deletion queue. The swapchain
+    // handle is kept as the oldSwapchain of the next one.
+    const uint64_t releaseFrame = getReleaseFrame();
+
+    for (auto framebuffer : m_swapchainFrameBuffers)
+        m_deletionQueue.releaseFramebuffer(releaseFrame, framebuffer);
+    for (auto commandBuffer : m_commandBuffers)
+        m_deletionQueue.releaseCommandBuffer(releaseFrame, m_commandPool, commandBuffer);
+    for (auto imageView : m_swapchainImageViews)
+        m_deletionQueue.releaseImageView(releaseFrame, imageView);
+    for (size_t i = 0; i < m_uniformBuffers.size(); ++i)
+        m_deletionQueue.releaseBuffer(releaseFrame, m_uniformBuffers[i], m_uniformBuffersMemory[i]);
+    for (size_t i = 0; i < m_instanceBuffers.size(); ++i)
+        m_deletionQueue.releaseBuffer(releaseFrame, m_instanceBuffers[i], m_instanceBuffersMemory[i]);     // unmapped by vkFreeMemory
+    m_deletionQueue.releaseDescriptorPool(releaseFrame, m_descriptorPool);
+    m_deletionQueue.releaseImageView(releaseFrame, m_depthImageView);
+    m_deletionQueue.releaseImage(releaseFrame, m_depthImage, m_depthImageMemory);
+    if (m_colorImage != VK_NULL_HANDLE)
+    {
+        m_deletionQueue.releaseImageView(releaseFrame, m_colorImageView);
+        m_deletionQueue.releaseImage(releaseFrame, m_colorImage, m_colorImageMemory);
+    }
+
+    m_swapchainFrameBuffers.clear();
+    m_commandBuffers.clear();
+    m_swapchainImageViews.clear();
+    m_uniformBuffers.clear();
+    m_uniformBuffersMemory.clear();
+    m_instanceBuffers.clear();
+    m_instanceBuffersMemory.clear();
+    m_instanceBuffersMapped.clear();
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_depthImageView    = VK_NULL_HANDLE;
+    m_depthImage        = VK_NULL_HANDLE;
+    m_depthImageMemory  = VK_NULL_HANDLE;
+    m_colorImageView    = VK_NULL_HANDLE;
+    m_colorImage        = VK_NULL_HANDLE;
+    m_colorImageMemory  = VK_NULL_HANDLE;
+}
+
 SwapchainSupportDetails VulkanManager::querySwapChainSupport(VkPhysicalDevice device)
 {
     SwapchainSupportDetails details;
@@ -1053,13 +1390,15 @@ VkExtent2D VulkanManager::chooseExtent2D(const VkSurfaceCapabilitiesKHR& capabil
 
 bool VulkanManager::createImageViews()
 {
+    PROFILE_FUNCTION();
+
     // 1. resize the array into the size of our needs. As of now,
     // the only VkImage we have is in the swapchain.
     m_swapchainImageViews.resize(m_swapchainImages.size());
 
     for (int i = 0; i < m_swapchainImageViews.size(); i++)
     {
-        if (!createImageView(m_swapchainImages[i], m_swapchainImageFormat, &m_swapchainImageViews[i]))
+        if (!createImageView(m_swapchainImages[i], m_swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, &m_swapchainImageViews[i]))
         {
             throw std::runtime_error("failed to create image views!");
             return false;
@@ -1072,8 +1411,10 @@ bool VulkanManager::createImageViews()
 
 bool VulkanManager::createTextureImageView()
 {
+    PROFILE_FUNCTION();
+
     bool result = true;
-    if (!createImageView(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, &m_textureImageView))
+    if (!createImageView(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, &m_textureImageView))
     {
         throw std::runtime_error("failed to create texture image view!");
         result = false;
@@ -1082,7 +1423,7 @@ bool VulkanManager::createTextureImageView()
     return result;
 }
 
-bool VulkanManager::createImageView(VkImage image, VkFormat format,  VkImageView* outImageView)
+bool VulkanManager::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectMask, VkImageView* outImageView)
 {
     // How shader will read the images.
     // Recall that images are read through VkImageView rather than directly
@@ -1100,15 +1441,145 @@ bool VulkanManager::createImageView(VkImage image, VkFormat format,  VkImageView
     imageViewCreateInfo.components.a    = VK_COMPONENT_SWIZZLE_IDENTITY;
     // [subresourceRange] field defines the image's purpose and which
     // part of the image is accessed.
-    imageViewCreateInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.aspectMask     = aspectMask;     // color, or depth (and stencil)
     imageViewCreateInfo.subresourceRange.baseMipLevel   = 0;
     imageViewCreateInfo.subresourceRange.levelCount     = 1;
     imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
     imageViewCreateInfo.subresourceRange.layerCount     = 1;
 
-    if (vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, outImageView) != VK_SUCCESS)
+    if (vkCreateImageView(m_device, &imageViewCreateInfo, HostAllocator::getCallbacks(), outImageView) != VK_SUCCESS)
+        return false;
+
+    return true;
+}
+
+
+// -----------------------<<  Depth Buffer  >>------------------------
+//
+//  Fragments are tested against the depth of the closest one so far,
+//  hidden ones are discarded. With the draws sorted front-to-back,
+//  most of the hidden fragments are rejected before being shaded
+//  (early depth test), which is where overlapping geometry costs.
+//
+// --------------------------------------------------------------------
+
+static bool hasStencilComponent(VkFormat format)
+{
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
+}
+
+VkFormat VulkanManager::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+{
+    // the first candidate supporting the features, in the given tiling
+    for (VkFormat format : candidates)
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+
+        const VkFormatFeatureFlags supportedFeatures = tiling == VK_IMAGE_TILING_LINEAR ? formatProperties.linearTilingFeatures
+                                                                                        : formatProperties.optimalTilingFeatures;
+        if ((supportedFeatures & features) == features)
+            return format;
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool VulkanManager::createDepthResources()
+{
+    PROFILE_FUNCTION();
+
+    // the format is chosen once, the render pass and the pipeline depend on it
+    if (m_depthFormat == VK_FORMAT_UNDEFINED)
+    {
+        // in order of precision. D24S8 is the common one where D32 is missing,
+        // D16 is always supported.
+        m_depthFormat = findSupportedFormat(
+            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM },
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        if (m_depthFormat == VK_FORMAT_UNDEFINED)
+        {
+            throw std::runtime_error("failed to find a supported depth format!");
+            return false;
+        }
+        PRINTLN("Depth format: " << m_depthFormat);
+    }
+
+    // same size and sample count as the color attachment. The layout is handled
+    // by the render graph. Never stored, so transient (see createColorResources).
+    createImage(m_swapchainExtent.width, m_swapchainExtent.height, m_msaaSamples, m_depthFormat,
+                VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, MemoryCategory::Attachment,
+                m_depthImage, m_depthImageMemory);
+
+    if (!createImageView(m_depthImage, m_depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, &m_depthImageView))
+    {
+        throw std::runtime_error("failed to create depth image view!");
+        return false;
+    }
+
+    PRINTLN("Created Depth Buffer");
+    return true;
+}
+
+
+// -----------------------<<  Multisampling  >>-----------------------
+//
+//  The main pass renders into a multisampled color image, resolved
+//  into the swapchain image at the end of the subpass. The multisample
+//  images (color & depth) are neither loaded nor stored: on tile-based
+//  GPUs they only ever live in tile memory, and with lazily allocated
+//  memory they are not even backed by a full-size allocation.
+//
+// --------------------------------------------------------------------
+
+VkSampleCountFlagBits VulkanManager::getMaxUsableSampleCount()
+{
+    // supported by both the color and the depth attachments
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+
+    const VkSampleCountFlags counts = deviceProperties.limits.framebufferColorSampleCounts
+                                    & deviceProperties.limits.framebufferDepthSampleCounts;
+    for (uint32_t count = VK_SAMPLE_COUNT_64_BIT; count > VK_SAMPLE_COUNT_1_BIT; count >>= 1)
+    {
+        if (counts & count)
+            return static_cast<VkSampleCountFlagBits>(count);
+    }
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+bool VulkanManager::createColorResources()
+{
+    PROFILE_FUNCTION();
+
+    // the sample count is chosen once: the largest supported one not above the requested one
+    if (m_msaaSamples == 0)
+    {
+        uint32_t sampleCount = std::min<uint32_t>(m_requestedMsaaSamples, getMaxUsableSampleCount());
+        while (sampleCount & (sampleCount - 1))     // power of two
+            sampleCount &= sampleCount - 1;
+        m_msaaSamples = static_cast<VkSampleCountFlagBits>(sampleCount);
+        PRINTLN("MSAA: " << m_msaaSamples << "x");
+    }
+
+    // without multisampling, the main pass renders to the swapchain image directly
+    if (m_msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+        return true;
+
+    createImage(m_swapchainExtent.width, m_swapchainExtent.height, m_msaaSamples, m_swapchainImageFormat,
+                VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, MemoryCategory::Attachment,
+                m_colorImage, m_colorImageMemory);
+
+    if (!createImageView(m_colorImage, m_swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, &m_colorImageView))
+    {
+        throw std::runtime_error("failed to create multisample color image view!");
         return false;
+    }
 
+    PRINTLN("Created Multisample Color Buffer");
     return true;
 }
 
@@ -1124,6 +1595,8 @@ bool VulkanManager::createImageView(VkImage image, VkFormat format,  VkImageView
 
 bool VulkanManager::createTextureSampler()
 {
+    PROFILE_FUNCTION();
+
     VkSamplerCreateInfo samplerCreateInfo{};
     samplerCreateInfo.sType     = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     // interpolation types when magified/minified. available types are:
@@ -1158,7 +1631,7 @@ bool VulkanManager::createTextureSampler()
     samplerCreateInfo.minLod        = 0.0f;
     samplerCreateInfo.maxLod        = 0.0f;
 
-    if(vkCreateSampler(m_device, &samplerCreateInfo, nullptr, &m_textureSampler) != VK_SUCCESS)
+    if(vkCreateSampler(m_device, &samplerCreateInfo, HostAllocator::getCallbacks(), &m_textureSampler) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create texture sampler!");
         return false;
@@ -1181,10 +1654,9 @@ bool VulkanManager::createTextureSampler()
 
 bool VulkanManager::createRenderPass()
 {
+    PROFILE_FUNCTION();
+
     // 1. Attachment description
-    VkAttachmentDescription colorAttachmentDescription{};
-    colorAttachmentDescription.format   = m_swapchainImageFormat;   // should match with swapchain images
-    colorAttachmentDescription.samples  = VK_SAMPLE_COUNT_1_BIT;    // no multi-sample
     // these two speficies what to do with the data attachment before/after loading
     //  [loadOP]
     //      _LOAD: preserve the existing contents of the attachment
@@ -1193,54 +1665,68 @@ bool VulkanManager::createRenderPass()
     //  [storeOp]
     //      _STORE: store in memory so it can be read later
     //      _DONT_CARE: contents of the framebuffer will remain undefined
-    colorAttachmentDescription.loadOp           = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachmentDescription.storeOp          = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachmentDescription.stencilLoadOp    = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachmentDescription.stencilStoreOp   = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     // the textures and framebuffers are represented by VkImage objects in certain pixel formats,
     // however this can be changed in the middle based on what you are trying to do.
     //  _COLOR_ATTACHMENT_OPTIMAL: used for color attachment
     //  _PRESENT_SRC_KHR: presented in the swapchain
     //  _TRANSFER_DST_OPTIMAL: used for memory copy operation
-    colorAttachmentDescription.initialLayout    = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentDescription.finalLayout      = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Both are derived by the render graph from how the image is used before/after
+    // the pass. The graph also does the layout transitions with its barriers, the
+    // attachment stays in the same layout throughout the render pass.
+    // With multisampling, the swapchain image is the resolve attachment:
+    //  [0] multisample color   [1] depth   [2] swapchain (resolve)
+    // otherwise:
+    //  [0] swapchain           [1] depth
+    const bool isMultisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+    std::vector<VkAttachmentDescription> attachmentDescriptions;
+    attachmentDescriptions.push_back(
+        m_renderGraph.getAttachmentDescription(m_mainPass, isMultisampled ? m_graphColorImage : m_graphSwapchainImage,
+                                               m_swapchainImageFormat, m_msaaSamples)); // should match with swapchain images
+    attachmentDescriptions.push_back(
+        m_renderGraph.getAttachmentDescription(m_mainPass, m_graphDepthImage,
+                                               m_depthFormat, m_msaaSamples));          // not stored, only used during the pass
+    if (isMultisampled)
+        attachmentDescriptions.push_back(
+            m_renderGraph.getAttachmentDescription(m_mainPass, m_graphSwapchainImage,
+                                                   m_swapchainImageFormat));            // single sample
 
     // 2. Subpasses
     // All subpasses references one or more VkAttachmentDescription
     VkAttachmentReference colorAttachmentReference{};
-    colorAttachmentReference.attachment  = 0;    // attachment index. our case, we only have one, therefore 0
+    colorAttachmentReference.attachment  = 0;    // attachment index, in attachmentDescriptions
     colorAttachmentReference.layout      = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; // we want layout as color buffer, in best optimized
 
+    VkAttachmentReference depthAttachmentReference{};
+    depthAttachmentReference.attachment  = 1;
+    depthAttachmentReference.layout      = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference resolveAttachmentReference{};
+    resolveAttachmentReference.attachment   = 2;
+    resolveAttachmentReference.layout       = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpassDescription{};
     subpassDescription.pipelineBindPoint     = VK_PIPELINE_BIND_POINT_GRAPHICS; // in case vulkan supports compute subpasses
     subpassDescription.colorAttachmentCount  = 1;   // index of this array is directly referenced by the fragment shader via layout(location = 0)
     subpassDescription.pColorAttachments     = &colorAttachmentReference;
+    subpassDescription.pDepthStencilAttachment  = &depthAttachmentReference;  // a subpass can only use a single one
+    // resolved at the end of the subpass, one per color attachment
+    subpassDescription.pResolveAttachments      = isMultisampled ? &resolveAttachmentReference : nullptr;
 
-    // This specifies memory and execution dependencies between subpasses
-    // including the start/end. Although, these have built-in dependencies.
-    VkSubpassDependency subpassDependency{};
-    // indices of the dependency and the dependent subpass
-    subpassDependency.srcSubpass    = VK_SUBPASS_EXTERNAL;  // before/after the renderpass
-    subpassDependency.dstSubpass    = 0;    // first pass (the only one is our case)
-    // operation to wait and in which stage that occurs
-    // here, we wait for swapchain to finish reading the image before we access it
-    subpassDependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.srcAccessMask = 0;
-    // color attatchment write - will wait until the "dstStageMask" stage
-    subpassDependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    // No subpass dependency: the dependencies with what comes before/after the
+    // render pass (i.e. waiting for the swapchain to finish reading the image)
+    // are the barriers of the render graph.
 
     // 3. Render Passes
     VkRenderPassCreateInfo renderPassCreateInfo{};
     renderPassCreateInfo.sType              = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassCreateInfo.attachmentCount    = 1;
-    renderPassCreateInfo.pAttachments       = &colorAttachmentDescription;
+    renderPassCreateInfo.attachmentCount    = static_cast<uint32_t>(attachmentDescriptions.size());
+    renderPassCreateInfo.pAttachments       = attachmentDescriptions.data();
     renderPassCreateInfo.subpassCount       = 1;
     renderPassCreateInfo.pSubpasses         = &subpassDescription;
-    renderPassCreateInfo.dependencyCount    = 1;
-    renderPassCreateInfo.pDependencies      = &subpassDependency;
+    renderPassCreateInfo.dependencyCount    = 0;
+    renderPassCreateInfo.pDependencies      = nullptr;
 
-    if (vkCreateRenderPass(m_device, &renderPassCreateInfo, nullptr, &m_renderPass) != VK_SUCCESS)
+    if (vkCreateRenderPass(m_device, &renderPassCreateInfo, HostAllocator::getCallbacks(), &m_renderPass) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create render pass!");
         return false;
@@ -1251,6 +1737,65 @@ bool VulkanManager::createRenderPass()
     return true;
 }
 
+bool VulkanManager::createRenderGraph()
+{
+    PROFILE_FUNCTION();
+
+    // The passes of a frame and the images they use. The barriers, layout
+    // transitions and load/store ops are derived from it (see RenderGraph).
+    // The frames that are captured execute their own graph, with the copy.
+    if (!buildRenderGraph(m_renderGraph, false) || !buildRenderGraph(m_captureGraph, true))
+    {
+        throw std::runtime_error("failed to compile render graph!");
+        return false;
+    }
+    m_renderGraph.printPlan();
+
+    PRINTLN("Created Render Graph (" << m_renderGraph.getPassOrder().size() << " passes, "
+            << m_renderGraph.getPipelineBarrierCount() << " barriers)");
+
+    return true;
+}
+
+bool VulkanManager::buildRenderGraph(RenderGraph& graph, bool isCapturing)
+{
+    // Both graphs are built in the same order, the handles are the same.
+    graph.reset();
+
+    // the images are bound when recording (see recordCommandBuffer)
+    m_graphSwapchainImage   = graph.importImage("swapchain", VK_IMAGE_ASPECT_COLOR_BIT,
+                                                ImageUsage::Acquired, ImageUsage::Present);
+    m_graphTextureImage     = graph.importImage("texture", VK_IMAGE_ASPECT_COLOR_BIT,     // left for sampling by the upload
+                                                ImageUsage::SampledFragment, ImageUsage::SampledFragment);
+    // the content is not needed after the pass (not even stored, see createRenderPass)
+    m_graphDepthImage       = graph.importImage("depth",
+                                                VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencilComponent(m_depthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0),
+                                                ImageUsage::Undefined, ImageUsage::Undefined);
+
+    m_mainPass = graph.addPass("main", [this](VkCommandBuffer commandBuffer) { recordMainPass(commandBuffer); });
+    if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+    {
+        // rendered multisampled, resolved into the swapchain image
+        m_graphColorImage = graph.importImage("msaa color", VK_IMAGE_ASPECT_COLOR_BIT,
+                                              ImageUsage::Undefined, ImageUsage::Undefined);
+        graph.write(m_mainPass, m_graphColorImage, ImageUsage::ColorAttachment, true);
+        graph.write(m_mainPass, m_graphSwapchainImage, ImageUsage::ColorResolve);
+    }
+    else
+        graph.write(m_mainPass, m_graphSwapchainImage, ImageUsage::ColorAttachment, true);
+    graph.write(m_mainPass, m_graphDepthImage, ImageUsage::DepthStencilAttachment, true);
+    graph.read(m_mainPass, m_graphTextureImage, ImageUsage::SampledFragment);
+
+    // the final image, copied to the readback buffer of the capture
+    if (isCapturing)
+    {
+        m_capturePass = graph.addPass("capture", [this](VkCommandBuffer commandBuffer) { recordCapturePass(commandBuffer); });
+        graph.read(m_capturePass, m_graphSwapchainImage, ImageUsage::TransferSrc);
+    }
+
+    return graph.compile();
+}
+
 // -----------------------<<  Descriptor Layout  >>--------------------------
 //
 //  A 'Descriptor', lets Shaders to freely access resources, such as buffers
@@ -1263,6 +1808,8 @@ bool VulkanManager::createRenderPass()
 
 bool VulkanManager::createDescriptorSetLayout()
 {
+    PROFILE_FUNCTION();
+
     // Uniform Buffer Object (UBO)
     //
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
@@ -1293,7 +1840,7 @@ bool VulkanManager::createDescriptorSetLayout()
     descriptorSetLayoutInfo.bindingCount    = bindings.size();
     descriptorSetLayoutInfo.pBindings       = bindings.data();
 
-    if (vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutInfo, nullptr, &m_descriptorSetLayout)
+    if (vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutInfo, HostAllocator::getCallbacks(), &m_descriptorSetLayout)
         != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create descriptor set layout!");
@@ -1307,6 +1854,8 @@ bool VulkanManager::createDescriptorSetLayout()
 
 bool VulkanManager::createDescriptorPool()
 {
+    PROFILE_FUNCTION();
+
     // Descriptor Pool
     //
     // Descriptor Sets CANNOT be created directly, it needs to be allocated through a pool
@@ -1324,7 +1873,7 @@ bool VulkanManager::createDescriptorPool()
     descriptorPoolInfo.pPoolSizes       = descriptorPoolSizes.data();
     descriptorPoolInfo.maxSets          = static_cast<uint32_t>(m_swapchainImages.size());
 
-    if (vkCreateDescriptorPool(m_device, &descriptorPoolInfo, nullptr, &m_descriptorPool)
+    if (vkCreateDescriptorPool(m_device, &descriptorPoolInfo, HostAllocator::getCallbacks(), &m_descriptorPool)
         != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create descriptor pool!");
@@ -1338,6 +1887,8 @@ bool VulkanManager::createDescriptorPool()
 
 bool VulkanManager::createDescriptorSets()
 {
+    PROFILE_FUNCTION();
+
     bool result = true;
 
     std::vector<VkDescriptorSetLayout> layouts(m_swapchainImages.size(), m_descriptorSetLayout);
@@ -1414,17 +1965,163 @@ bool VulkanManager::createDescriptorSets()
 //
 // --------------------------------------------------------------------------
 
-bool VulkanManager::createGraphicsPipeline()
+bool VulkanManager::createPipelineLayout()
 {
-    // 1. Load shaders
-    auto vertShader = readFile("../src/shaders/vert.spv");
-    auto fragShader = readFile("../src/shaders/frag.spv");
+    PROFILE_FUNCTION();
 
-    // 2. Create shader moduless
-    VkShaderModule vertShaderModule = createShaderModule(vertShader);
-    VkShaderModule fragShaderModule = createShaderModule(fragShader);
+    // Pipeline layout
+    // this allows you to pass 'uniform' constants to the shaders.
+    // In practice, transform matrices are usually passed through this.
+    // It does not depend on the swapchain, so it outlives the pipelines
+    // that are re-created on resize or shader reload.
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+    pipelineLayoutCreateInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutCreateInfo.setLayoutCount         = 1;        // optional
+    pipelineLayoutCreateInfo.pSetLayouts            = &m_descriptorSetLayout;  // optional
+    // the world matrix of each draw is a vertex attribute, see InstanceData
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+    pipelineLayoutCreateInfo.pPushConstantRanges    = nullptr;
 
-    // 3. Stage shaders into the pipeline stage
+    // this is a manatory field to register even though we leave blank, so
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, HostAllocator::getCallbacks(), &m_pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+        return false;
+    }
+
+    PRINTLN("Created Graphics Pipeline Layout");
+
+    return true;
+}
+
+bool VulkanManager::createGraphicsPipeline()
+{
+    PROFILE_FUNCTION();
+
+    // Pipeline creation is the most expensive call in here, so it is handed
+    // over to the pipeline compiler and doesn't block. Until it's ready, the
+    // command buffers are recorded without the draw calls (or with the
+    // previous pipeline, for a reload). See updateGraphicsPipeline().
+    // The sprite pipeline goes along, it depends on the same render pass.
+    if (m_pendingGraphicsPipeline.valid() || m_pendingSpritePipeline.valid())
+    {
+        // the pending ones would be outdated, request again once they're done
+        m_isGraphicsPipelineOutdated = true;
+        return true;
+    }
+
+    // binding 0: per vertex, binding 1: per instance
+    GraphicsPipelineDesc mainDesc;
+    mainDesc.vertShader         = VERT_SHADER;
+    mainDesc.fragShader         = FRAG_SHADER;
+    mainDesc.layout             = m_pipelineLayout;
+    mainDesc.vertexBindings     = { Vertex::getBindingDesc(), InstanceData::getBindingDesc() };
+    for (const auto& attributeDesc : Vertex::getAttributeDesc())
+        mainDesc.vertexAttributes.push_back(attributeDesc);
+    for (const auto& attributeDesc : InstanceData::getAttributeDesc())
+        mainDesc.vertexAttributes.push_back(attributeDesc);
+    mainDesc.cullMode           = VK_CULL_MODE_BACK_BIT;
+    mainDesc.depthCompareOp     = VK_COMPARE_OP_LESS;       // lower depth = closer
+    mainDesc.isBlended          = true;
+
+    // 2D, either winding. At equal depth the last submitted sprite wins.
+    GraphicsPipelineDesc spriteDesc;
+    spriteDesc.vertShader       = SPRITE_VERT_SHADER;
+    spriteDesc.fragShader       = SPRITE_FRAG_SHADER;
+    spriteDesc.layout           = m_spritePipelineLayout;
+    spriteDesc.vertexBindings   = { { 0, sizeof(SpriteVertex), VK_VERTEX_INPUT_RATE_VERTEX } };
+    spriteDesc.vertexAttributes =
+    {
+        { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(SpriteVertex, position) },
+        { 1, 0, VK_FORMAT_R32G32_SFLOAT,    offsetof(SpriteVertex, texCoord) },
+        { 2, 0, VK_FORMAT_R8G8B8A8_UNORM,   offsetof(SpriteVertex, color) },
+    };
+    spriteDesc.cullMode         = VK_CULL_MODE_NONE;
+    spriteDesc.depthCompareOp   = VK_COMPARE_OP_LESS_OR_EQUAL;
+    spriteDesc.isBlended        = false;                    // alpha tested
+
+    // render pass is captured by value, it must outlive the build. The build
+    // starts once the shader sources have been prefetched (see initVulkan).
+    const VkRenderPass renderPass = m_renderPass;
+    m_pendingGraphicsPipeline = m_pipelineCompiler.compile(
+        [this, mainDesc, renderPass](VkPipelineCache pipelineCache)
+        {
+            return buildGraphicsPipeline(mainDesc, renderPass, pipelineCache);
+        },
+        &m_shadersLoaded);
+    m_pendingSpritePipeline = m_pipelineCompiler.compile(
+        [this, spriteDesc, renderPass](VkPipelineCache pipelineCache)
+        {
+            return buildGraphicsPipeline(spriteDesc, renderPass, pipelineCache);
+        },
+        &m_shadersLoaded);
+    m_isGraphicsPipelineOutdated = false;
+
+    PRINTLN("Requested Graphics Pipelines");
+
+    return true;
+}
+
+bool VulkanManager::updateGraphicsPipeline()
+{
+    bool isUpdated = updatePipeline(m_pendingGraphicsPipeline, m_graphicsPipeline, "Graphics");
+    isUpdated     |= updatePipeline(m_pendingSpritePipeline, m_spritePipeline, "Sprite");
+
+    if (m_isGraphicsPipelineOutdated && !m_pendingGraphicsPipeline.valid() && !m_pendingSpritePipeline.valid())
+        createGraphicsPipeline();
+
+    return isUpdated;
+}
+
+bool VulkanManager::updatePipeline(std::shared_future<VkPipeline>& pendingPipeline, VkPipeline& pipeline, const char* name)
+{
+    // polls the pending build, and replaces the current pipeline if done
+    if (!pendingPipeline.valid() ||
+        pendingPipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+
+    VkPipeline builtPipeline = VK_NULL_HANDLE;
+    try
+    {
+        builtPipeline = pendingPipeline.get();
+    }
+    catch (const std::exception& e)
+    {
+        // i.e. a broken shader on hot reload. keep the previous pipeline
+        PRINTLN(name << " pipeline build failed - " << e.what());
+    }
+    pendingPipeline = {};
+
+    if (builtPipeline != VK_NULL_HANDLE)
+    {
+        // the frames in flight still use the old pipeline. The command buffers
+        // are recorded every frame (see drawFrame), the next one uses the new one.
+        if (pipeline != VK_NULL_HANDLE)
+            m_deletionQueue.releasePipeline(getReleaseFrame(), pipeline);
+        pipeline = builtPipeline;
+
+        PRINTLN("Created " << name << " Pipeline");
+    }
+
+    return builtPipeline != VK_NULL_HANDLE;
+}
+
+VkPipeline VulkanManager::buildGraphicsPipeline(const GraphicsPipelineDesc& desc, VkRenderPass renderPass, VkPipelineCache pipelineCache)
+{
+    PROFILE_FUNCTION();
+
+    // NOTE: this runs on a pipeline compiler worker thread.
+
+    // 1. Load shaders
+    // GLSL sources are compiled at runtime, see ShaderCompiler
+    auto vertShader = m_shaderCompiler.loadSpirv(desc.vertShader);
+    auto fragShader = m_shaderCompiler.loadSpirv(desc.fragShader);
+
+    // 2. Create shader moduless
+    VkShaderModule vertShaderModule = createShaderModule(vertShader);
+    VkShaderModule fragShaderModule = createShaderModule(fragShader);
+
+    // 3. Stage shaders into the pipeline stage
     VkPipelineShaderStageCreateInfo vertShaderStageCreateInfo{};
     vertShaderStageCreateInfo.sType     = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageCreateInfo.stage     = VK_SHADER_STAGE_VERTEX_BIT;   // vertex shader
@@ -1448,14 +2145,13 @@ bool VulkanManager::createGraphicsPipeline()
     //    usually these were set with default values in other GraphicsAPI, but not for Vulkan, so...
 
     // 4.1 Vertex input
-    auto vertexBindingDesc = Vertex::getBindingDesc();
-    auto vertexAttributeDescs = Vertex::getAttributeDesc();
+    // see createGraphicsPipeline() for the bindings of each pipeline
     VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{};
     vertexInputStateCreateInfo.sType                            = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputStateCreateInfo.vertexBindingDescriptionCount    = 1;
-    vertexInputStateCreateInfo.pVertexBindingDescriptions       = &vertexBindingDesc;
-    vertexInputStateCreateInfo.vertexAttributeDescriptionCount  = vertexAttributeDescs.size();
-    vertexInputStateCreateInfo.pVertexAttributeDescriptions     = vertexAttributeDescs.data();
+    vertexInputStateCreateInfo.vertexBindingDescriptionCount    = static_cast<uint32_t>(desc.vertexBindings.size());
+    vertexInputStateCreateInfo.pVertexBindingDescriptions       = desc.vertexBindings.data();
+    vertexInputStateCreateInfo.vertexAttributeDescriptionCount  = static_cast<uint32_t>(desc.vertexAttributes.size());
+    vertexInputStateCreateInfo.pVertexAttributeDescriptions     = desc.vertexAttributes.data();
 
     // 4.2 Input Aseembly
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo{};
@@ -1465,26 +2161,16 @@ bool VulkanManager::createGraphicsPipeline()
 
     // 4.3 Viewport
     // the region of the framebuffer that will be rendered out. Almost always (0,0) ~ (width, height)
-    VkViewport viewport{};
-    viewport.x          = 0.0f;
-    viewport.y          = 0.0f;
-    viewport.width      = (float) m_swapchainExtent.width;
-    viewport.height     = (float) m_swapchainExtent.height;
-    viewport.minDepth   = 0.0f; // range of depth value in the framebuffer.
-    viewport.maxDepth   = 1.0f; // always within (0,1), but min value can be greater than max
-
     // 4.4 Scissors
     // define in which regions of pixels will be rendered, then it will be discarded by the rasterizer
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};    // cover from the beginning
-    scissor.extent = m_swapchainExtent; // to full size of the swapchain
-
+    // Both are dynamic states (see 4.9) set in recordMainPass(), so that
+    // the pipeline doesn't depend on the swapchain extent.
     VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
     viewportStateCreateInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportStateCreateInfo.viewportCount   = 1;
-    viewportStateCreateInfo.pViewports      = &viewport;
+    viewportStateCreateInfo.pViewports      = nullptr;  // dynamic
     viewportStateCreateInfo.scissorCount    = 1;
-    viewportStateCreateInfo.pScissors       = &scissor;
+    viewportStateCreateInfo.pScissors       = nullptr;  // dynamic
 
     // 4.5 Rasterizer
     VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
@@ -1493,7 +2179,7 @@ bool VulkanManager::createGraphicsPipeline()
     rasterizationStateCreateInfo.rasterizerDiscardEnable    = VK_FALSE;                 // don't let geometry to pass the rasterizer, and won't display on framebuffer
     rasterizationStateCreateInfo.polygonMode                = VK_POLYGON_MODE_FILL;     // _LINE / _POINT (these two requires GPU feature)
     rasterizationStateCreateInfo.lineWidth                  = 1.0f;                     // thickness of lines covering the fragment. Larger than 1.0 requires GPU feature
-    rasterizationStateCreateInfo.cullMode                   = VK_CULL_MODE_BACK_BIT;    // back-face culling
+    rasterizationStateCreateInfo.cullMode                   = desc.cullMode;            // i.e. back-face culling
     rasterizationStateCreateInfo.frontFace                  = VK_FRONT_FACE_COUNTER_CLOCKWISE;  // vertex oreder of the front face
     rasterizationStateCreateInfo.depthBiasEnable            = VK_FALSE;                 // set true - adjust depth values through the values below
     rasterizationStateCreateInfo.depthBiasConstantFactor    = 0.0f;
@@ -1504,7 +2190,7 @@ bool VulkanManager::createGraphicsPipeline()
     VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo{};
     multisampleStateCreateInfo.sType                    = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampleStateCreateInfo.sampleShadingEnable      = VK_FALSE;
-    multisampleStateCreateInfo.rasterizationSamples     = VK_SAMPLE_COUNT_1_BIT;
+    multisampleStateCreateInfo.rasterizationSamples     = m_msaaSamples;    // of the attachments (see createColorResources)
     multisampleStateCreateInfo.minSampleShading         = 1.0f; // optional
     multisampleStateCreateInfo.pSampleMask              = nullptr;  // optional
     multisampleStateCreateInfo.alphaToCoverageEnable    = VK_FALSE; // optional
@@ -1512,9 +2198,15 @@ bool VulkanManager::createGraphicsPipeline()
     // will come back.
 
     // 4.7 Depth/Stencil buffers
+    // keeps the closest fragment. Opaque draws are sorted front-to-back, the
+    // hidden fragments then fail the test before the fragment shader runs.
     VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo{};
-    depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    // to be continued.
+    depthStencilStateCreateInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilStateCreateInfo.depthTestEnable         = VK_TRUE;
+    depthStencilStateCreateInfo.depthWriteEnable        = VK_TRUE;
+    depthStencilStateCreateInfo.depthCompareOp          = desc.depthCompareOp;
+    depthStencilStateCreateInfo.depthBoundsTestEnable   = VK_FALSE;
+    depthStencilStateCreateInfo.stencilTestEnable       = VK_FALSE;
 
     // 4.8 Color blending
     // This happens when output of the fragment shader needs to be combined with the
@@ -1525,7 +2217,7 @@ bool VulkanManager::createGraphicsPipeline()
     VkPipelineColorBlendAttachmentState colorblendAttachmentState{};
     colorblendAttachmentState.colorWriteMask        = VK_COLOR_COMPONENT_R_BIT |    // colors that is actually passed through
                                                       VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorblendAttachmentState.blendEnable           = VK_TRUE;
+    colorblendAttachmentState.blendEnable           = desc.isBlended ? VK_TRUE : VK_FALSE;
     // below is optional, it's a sample config for alpha blending c1(a) * c2(1-a)
     colorblendAttachmentState.srcColorBlendFactor   = VK_BLEND_FACTOR_SRC_ALPHA;
     colorblendAttachmentState.dstAlphaBlendFactor   = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
@@ -1551,31 +2243,13 @@ bool VulkanManager::createGraphicsPipeline()
     // certain states can be changed without creating a whole new pipeline state (e.x viewport size, blend constants...)
     // simply fill the VkDynamicState structure. As a result, these value will be ignored at first
     // and required to be specify the data during the draw.
-    VkDynamicState dynamicState[] {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
+    VkDynamicState dynamicState[] {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
     VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
     dynamicStateCreateInfo.sType                = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     dynamicStateCreateInfo.dynamicStateCount    = 2;
     dynamicStateCreateInfo.pDynamicStates       = dynamicState;
 
-    // 4.10 Pipeline layout
-    // this allows you to pass 'uniform' constants to the shaders.
-    // In practice, transform matrices are usually passed through this.
-    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-    pipelineLayoutCreateInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount         = 1;        // optional
-    pipelineLayoutCreateInfo.pSetLayouts            = &m_descriptorSetLayout;  // optional
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;        // optional
-    pipelineLayoutCreateInfo.pPushConstantRanges    = nullptr;  // optional
-
-    // this is a manatory field to register even though we leave blank, so
-    bool result = false;
-    if (vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
-        throw std::runtime_error("failed to create pipeline layout!");
-    else
-    {
-        result = true;
-        PRINTLN("Created Graphics Pipeline Layout");
-    }
+    // 4.10 Pipeline layout - see createPipelineLayout()
 
     // 5. Graphics Pipeline
     VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
@@ -1588,12 +2262,12 @@ bool VulkanManager::createGraphicsPipeline()
     graphicsPipelineCreateInfo.pViewportState       = &viewportStateCreateInfo;
     graphicsPipelineCreateInfo.pRasterizationState  = &rasterizationStateCreateInfo;
     graphicsPipelineCreateInfo.pMultisampleState    = &multisampleStateCreateInfo;
-    graphicsPipelineCreateInfo.pDepthStencilState   = nullptr;  // optional
+    graphicsPipelineCreateInfo.pDepthStencilState   = &depthStencilStateCreateInfo;
     graphicsPipelineCreateInfo.pColorBlendState     = &colorblendStateCreateInfo;
-    graphicsPipelineCreateInfo.pDynamicState        = nullptr;  // optional
+    graphicsPipelineCreateInfo.pDynamicState        = &dynamicStateCreateInfo;
 
-    graphicsPipelineCreateInfo.layout               = m_pipelineLayout;
-    graphicsPipelineCreateInfo.renderPass           = m_renderPass;
+    graphicsPipelineCreateInfo.layout               = desc.layout;
+    graphicsPipelineCreateInfo.renderPass           = renderPass;
     graphicsPipelineCreateInfo.subpass              = 0;    // index of the subpass
 
     // vulkan allows to create a new pipeline from an existing pipeline, as this is
@@ -1602,20 +2276,19 @@ bool VulkanManager::createGraphicsPipeline()
     graphicsPipelineCreateInfo.basePipelineHandle   = VK_NULL_HANDLE;
     graphicsPipelineCreateInfo.basePipelineIndex    = -1;
 
-    if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo,
-                                  nullptr, &m_graphicsPipeline)
-        != VK_SUCCESS)
-        throw std::runtime_error("failed to creat graphics pipeline!");
-    else
-        result &= true;
+    // the pipeline cache is shared by all the builds (internally synchronized)
+    VkPipeline graphicsPipeline;
+    VkResult pipelineResult = vkCreateGraphicsPipelines(m_device, pipelineCache, 1, &graphicsPipelineCreateInfo,
+                                                        HostAllocator::getCallbacks(), &graphicsPipeline);
 
     // shader module cleanup
-    vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
-    vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
+    vkDestroyShaderModule(m_device, vertShaderModule, HostAllocator::getCallbacks());
+    vkDestroyShaderModule(m_device, fragShaderModule, HostAllocator::getCallbacks());
 
-    PRINTLN("Created Graphics Pipeline");
+    if (pipelineResult != VK_SUCCESS)
+        throw std::runtime_error("failed to creat graphics pipeline!");
 
-    return result;
+    return graphicsPipeline;
 };
 
 VkShaderModule VulkanManager::createShaderModule(const std::vector<char> &code)
@@ -1632,13 +2305,57 @@ VkShaderModule VulkanManager::createShaderModule(const std::vector<char> &code)
     shaderModuleCreateInfo.pCode        = reinterpret_cast<const u_int32_t*>(code.data());
 
     VkShaderModule shaderModule;
-    if (vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &shaderModule)
+    if (vkCreateShaderModule(m_device, &shaderModuleCreateInfo, HostAllocator::getCallbacks(), &shaderModule)
         != VK_SUCCESS)
         throw std::runtime_error("failed to create shader module!");
 
     return shaderModule;
 }
 
+void VulkanManager::prefetchShaders()
+{
+    PROFILE_FUNCTION();
+
+    // NOTE: this runs on a job. It only fills the SPIR-V cache, so that the
+    // pipeline builds don't compile the same sources again.
+    std::vector<const char*> shaders = { VERT_SHADER, FRAG_SHADER, SPRITE_VERT_SHADER, SPRITE_FRAG_SHADER };
+    if (!m_textureProcessing.empty())
+        shaders.push_back(IMAGE_OPS_SHADER);
+    for (const char* shader : shaders)
+    {
+        try
+        {
+            m_shaderCompiler.loadSpirv(shader);
+        }
+        catch (const std::exception& e)
+        {
+            // reported again by the pipeline build, which keeps drawing without it
+            PRINTLN("Shader) prefetch failed - " << e.what());
+        }
+    }
+}
+
+bool VulkanManager::reloadChangedShaders()
+{
+    if (!m_shaderCompiler.pollChanges(m_changedShaders))
+        return false;
+
+    // only rebuild the pipelines that use the modified shaders
+    bool isGraphicsPipelineAffected = false;
+    for (const auto& shader : m_changedShaders)
+    {
+        PRINTLN("Shader) modified - " << shader);
+        if (shader == VERT_SHADER || shader == FRAG_SHADER || shader == SPRITE_VERT_SHADER || shader == SPRITE_FRAG_SHADER)
+            isGraphicsPipelineAffected = true;
+    }
+    if (!isGraphicsPipelineAffected)
+        return false;
+
+    // the current pipeline is used until the new one is compiled, and a
+    // broken shader keeps it. See updateGraphicsPipeline()
+    return createGraphicsPipeline();
+}
+
 
 // -------------------------<<  Frame Buffers  >>---------------------------------
 //
@@ -1655,6 +2372,8 @@ VkShaderModule VulkanManager::createShaderModule(const std::vector<char> &code)
 
 bool VulkanManager::createFrameBuffers()
 {
+    PROFILE_FUNCTION();
+
     // resize as same as the swapchain imageViews
     m_swapchainFrameBuffers.resize(m_swapchainImageViews.size());
 
@@ -1662,20 +2381,25 @@ bool VulkanManager::createFrameBuffers()
     bool result = true;
     for (size_t i = 0; i < m_swapchainFrameBuffers.size(); i++)
     {
-        VkImageView attachments[] = {m_swapchainImageViews[i]};
+        // same depth (and multisample color) buffer for all, see createRenderPass for the order
+        std::vector<VkImageView> attachments;
+        if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+            attachments = {m_colorImageView, m_depthImageView, m_swapchainImageViews[i]};
+        else
+            attachments = {m_swapchainImageViews[i], m_depthImageView};
 
         VkFramebufferCreateInfo frameBufferCreateInfo{};
         frameBufferCreateInfo.sType             = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         frameBufferCreateInfo.renderPass        = m_renderPass; // compatible render pass
         // VkImageView objects to reference
-        frameBufferCreateInfo.attachmentCount   = 1;    // in our case, just color attachment
-        frameBufferCreateInfo.pAttachments      = attachments;
+        frameBufferCreateInfo.attachmentCount   = static_cast<uint32_t>(attachments.size());
+        frameBufferCreateInfo.pAttachments      = attachments.data();
         frameBufferCreateInfo.width             = m_swapchainExtent.width;
         frameBufferCreateInfo.height            = m_swapchainExtent.height;
         // number of layers in image arrays.
         frameBufferCreateInfo.layers            = 1;    // our swapchain images only has a single image
 
-        if (vkCreateFramebuffer(m_device, &frameBufferCreateInfo, nullptr, &m_swapchainFrameBuffers[i])
+        if (vkCreateFramebuffer(m_device, &frameBufferCreateInfo, HostAllocator::getCallbacks(), &m_swapchainFrameBuffers[i])
             != VK_SUCCESS)
         {
             throw std::runtime_error("failed to create framebuffer!");
@@ -1700,6 +2424,8 @@ bool VulkanManager::createFrameBuffers()
 
 bool VulkanManager::createVertexBuffer()
 {
+    PROFILE_FUNCTION();
+
     // 1. Create buffer
     //
     // We have two choice of creating the Vertex Buffer.
@@ -1720,12 +2446,14 @@ bool VulkanManager::createVertexBuffer()
                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,      // buffer can be used as a source in a memory transfer
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |  // host visible (CPU), as a temporary "staging"
                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Staging,
                  stagingBuffer,
                  stagingBufferMemory);
 #else
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,     // directly in GPU, accessible by CPU
-                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Vertex,
                  m_vertexBuffer,
                  m_vertexBufferMemory);
 #endif  // USE_STAGING_BUFFER
@@ -1773,13 +2501,14 @@ bool VulkanManager::createVertexBuffer()
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT |     // buffer can be used as destidation
                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,   // device local (GPU), inaccessible by CPU
+                 MemoryCategory::Vertex,
                  m_vertexBuffer,
                  m_vertexBufferMemory);
 
     copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
 
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+    // still read by the copy, destroyed once it's done
+    m_deletionQueue.releaseBuffer(getReleaseFrame(), stagingBuffer, stagingBufferMemory);
 #endif  // USE_STAGING_BUFFER
 
     PRINTLN("Created Vertex Buffer");
@@ -1788,6 +2517,15 @@ bool VulkanManager::createVertexBuffer()
 }
 
 uint32_t VulkanManager::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    std::optional<uint32_t> memoryType = queryMemoryType(typeFilter, properties);
+    if (!memoryType)
+        throw std::runtime_error("failed to find suitable memory type!");
+
+    return *memoryType;
+}
+
+std::optional<uint32_t> VulkanManager::queryMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
 {
     // VkPhysicalDeviceMemoryProperties has two arrays:
     //  - memoryHeaps: distinct memory resources, like VRAM, swap space (in RAM used when VRAM runs out)
@@ -1802,15 +2540,16 @@ uint32_t VulkanManager::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlag
         // 2. Can the memory handle the required properties? (In this example, can we write Vertex data to the memory?)
         if (typeFilter & (1 << i) &&    // corresponding bit == 1 ?
             (deviceMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
-            return i;
+            return static_cast<uint32_t>(i);
     }
 
-    throw std::runtime_error("failed to find suitable memory type!");
+    return std::nullopt;
 }
 
 bool VulkanManager::createBuffer(VkDeviceSize bufferSize,
                                  VkBufferUsageFlags bufferUsage,
                                  VkMemoryPropertyFlags memoryProperties,
+                                 MemoryCategory memoryCategory,
                                  VkBuffer& buffer,
                                  VkDeviceMemory& bufferMemory)
 {
@@ -1824,7 +2563,7 @@ bool VulkanManager::createBuffer(VkDeviceSize bufferSize,
 
     bool result = true;
 
-    if (vkCreateBuffer(m_device, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
+    if (vkCreateBuffer(m_device, &bufferCreateInfo, HostAllocator::getCallbacks(), &buffer) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create buffer!");
         result = false;
@@ -1846,18 +2585,18 @@ bool VulkanManager::createBuffer(VkDeviceSize bufferSize,
     memoryAllocateInfo.allocationSize   = memoryRequirements.size;
     // Different GPUs offer different memory types to allocate. We need to gather
     //our buffer requirements & GPU capabilities to find the right memory type.
+    // (e.g. HOST_VISIBLE to write vertex data from the CPU, or DEVICE_LOCAL for the staged buffers)
     const uint32_t memTypeIdx = findMemoryType(memoryRequirements.memoryTypeBits,       // our memory type requirement
-                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |    // can we write Vertex data?
-                                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);   // use memory heap that is host coherent
+                                               memoryProperties);
     memoryAllocateInfo.memoryTypeIndex  = memTypeIdx;
 
     // NOTE: this (vkAllocateMemory) is not actually allowed in practice for every individual buffer.
     // usually the size is limited by maxMemoryAllocationCount, and supposed to create a custom
     // allocator that splits a single allocator to different objects
-    if (vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &bufferMemory)
+    if (m_memoryTracker.allocate(m_device, memoryAllocateInfo, memoryCategory, &bufferMemory)
         != VK_SUCCESS)
     {
-        std::runtime_error("failed to create vertex buffers!");
+        throw std::runtime_error("failed to allocate buffer memory!");
         result = false;
     }
 
@@ -1875,6 +2614,8 @@ bool VulkanManager::createBuffer(VkDeviceSize bufferSize,
 
 bool VulkanManager::createIndexBuffer()
 {
+    PROFILE_FUNCTION();
+
     VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
 #ifdef USE_STAGING_BUFFER
@@ -1883,12 +2624,14 @@ bool VulkanManager::createIndexBuffer()
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Staging,
                  stagingBuffer,
                  stagingBufferMemory);
 #else
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Index,
                  m_indexBuffer,
                  m_indexBufferMemory);
 #endif  // USE_STAGING_BUFFER
@@ -1916,12 +2659,13 @@ bool VulkanManager::createIndexBuffer()
     createBuffer(bufferSize,
                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 MemoryCategory::Index,
                  m_indexBuffer,
                  m_indexBufferMemory);
     copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
 
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+    // still read by the copy, destroyed once it's done
+    m_deletionQueue.releaseBuffer(getReleaseFrame(), stagingBuffer, stagingBufferMemory);
 #endif
 
     PRINTLN("Created Index Buffer");
@@ -1929,11 +2673,47 @@ bool VulkanManager::createIndexBuffer()
     return true;
 }
 
+bool VulkanManager::createDrawList()
+{
+    // a single mesh for now: the quad
+    m_meshes.clear();
+    m_meshes.push_back({m_vertexBuffer, m_indexBuffer});
+
+    // the scene: the quads under a root animated by updateUniformBuffer()
+    m_transforms.clear();
+    m_sceneRoot = m_transforms.create();
+
+    // the quad at each height, sorted every frame (see sortOpaqueDraws)
+    m_opaqueDraws.clear();
+    for (float height : quadHeights)
+    {
+        DrawItem draw{};
+        draw.transform  = m_transforms.create(m_sceneRoot);
+        m_transforms.setPosition(draw.transform, glm::vec3(0.0f, 0.0f, height));
+        draw.pipeline   = 0;
+        draw.material   = 0;
+        draw.mesh       = 0;
+        draw.firstIndex = 0;
+        draw.indexCount = static_cast<uint32_t>(indices.size());
+        m_opaqueDraws.push_back(draw);
+    }
+
+    if (m_opaqueDraws.size() > MAX_DRAW_INSTANCES)
+    {
+        throw std::runtime_error("too many draws for the instance buffers!");
+        return false;
+    }
+
+    PRINTLN("Created Draw List (" << m_opaqueDraws.size() << " draws)");
+    return true;
+}
+
 bool VulkanManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize deviceSize)
 {
     // Copies the buffer one to another.
 #ifdef USE_STAGING_BUFFER
-    VkCommandBuffer cmdBuffer = beginSingleTimeCommands();
+    std::unique_lock<std::mutex> commandsLock;
+    VkCommandBuffer cmdBuffer = beginSingleTimeCommands(commandsLock);
 
     // copy command
     VkBufferCopy copyRegion{};
@@ -1942,7 +2722,21 @@ bool VulkanManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceS
     copyRegion.dstOffset = 0;   // optional
     vkCmdCopyBuffer(cmdBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-    endSingleTimeCommands(cmdBuffer);
+    // the copy isn't waited for on the CPU anymore, so the reads of the next
+    // frames (vertex input, uniforms) need a barrier against it
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         1, &memoryBarrier,
+                         0, nullptr,
+                         0, nullptr);
+
+    endSingleTimeCommands(cmdBuffer, std::move(commandsLock));
 #endif
 
     return true;
@@ -1950,6 +2744,8 @@ bool VulkanManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceS
 
 bool VulkanManager::createUniformBuffers()
 {
+    PROFILE_FUNCTION();
+
     // Multiple Uniform Buffers are required, because multiple frames can be 'in flight'
     // and we shouldn't modify the buffer in preparation while the other is in use.
     // We can either create the Uniform Buffer per-frame or per-swapcahin image. However,
@@ -1964,6 +2760,7 @@ bool VulkanManager::createUniformBuffers()
         createBuffer(bufferSize,
                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     MemoryCategory::Uniform,
                      m_uniformBuffers[i],
                      m_uniformBuffersMemory[i]);
     }
@@ -1973,8 +2770,78 @@ bool VulkanManager::createUniformBuffers()
     return true;
 }
 
-VkCommandBuffer VulkanManager::beginSingleTimeCommands()
+bool VulkanManager::createInstanceBuffers()
 {
+    PROFILE_FUNCTION();
+
+    // Same as the uniform buffers, one per swapchain image. Written every
+    // frame, so mapped once for their whole lifetime.
+    m_instanceBuffers.resize(m_swapchainImages.size());
+    m_instanceBuffersMemory.resize(m_swapchainImages.size());
+    m_instanceBuffersMapped.resize(m_swapchainImages.size());
+
+    VkDeviceSize bufferSize = sizeof(glm::mat4) * MAX_DRAW_INSTANCES;
+    for (size_t i = 0; i < m_swapchainImages.size(); ++i)
+    {
+        createBuffer(bufferSize,
+                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     MemoryCategory::Vertex,
+                     m_instanceBuffers[i],
+                     m_instanceBuffersMemory[i]);
+
+        void* data;
+        if (vkMapMemory(m_device, m_instanceBuffersMemory[i], 0, bufferSize, 0, &data) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map instance buffer!");
+            return false;
+        }
+        m_instanceBuffersMapped[i] = static_cast<glm::mat4*>(data);
+    }
+
+    PRINTLN("Created Instance Buffer");
+
+    return true;
+}
+
+bool VulkanManager::createTransientBuffer()
+{
+    PROFILE_FUNCTION();
+
+    // One buffer for the data written every frame (see TransientBuffer.h),
+    // mapped once for its whole lifetime. Sized for the frames in flight,
+    // each of them may use up to TRANSIENT_BUFFER_FRAME_SIZE.
+    const VkDeviceSize bufferSize = VkDeviceSize(TRANSIENT_BUFFER_FRAME_SIZE) * m_maxFramesInFlight;
+    createBuffer(bufferSize,
+                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Transient,
+                 m_transientVkBuffer,
+                 m_transientBufferMemory);
+
+    void* data;
+    if (vkMapMemory(m_device, m_transientBufferMemory, 0, bufferSize, 0, &data) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to map transient buffer!");
+        return false;
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+    m_transientBuffer.init(m_transientVkBuffer, data, bufferSize,
+                           deviceProperties.limits.minUniformBufferOffsetAlignment, m_maxFramesInFlight);
+
+    PRINTLN("Created Transient Buffer");
+
+    return true;
+}
+
+VkCommandBuffer VulkanManager::beginSingleTimeCommands(std::unique_lock<std::mutex>& lock)
+{
+    // the command pool and the queue are externally synchronized, and uploads
+    // may come from several init jobs. Held until endSingleTimeCommands().
+    lock = std::unique_lock<std::mutex>(m_singleTimeCommandsMutex);
+
     VkCommandBufferAllocateInfo cmdBufferAllocateInfo{};
     cmdBufferAllocateInfo.sType                 = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     cmdBufferAllocateInfo.level                 = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -1995,7 +2862,7 @@ VkCommandBuffer VulkanManager::beginSingleTimeCommands()
     return cmdBuffer;
 }
 
-void VulkanManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer)
+void VulkanManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer, std::unique_lock<std::mutex> lock)
 {
     vkEndCommandBuffer(cmdBuffer);
 
@@ -2006,11 +2873,12 @@ void VulkanManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer)
     submitInfo.pCommandBuffers      = &cmdBuffer;
     vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
 
-    // no other event to wait for here, execute immediately
-    vkQueueWaitIdle(m_graphicsQueue);   // or use vkWaitForFences
+    // No wait here. The commands are ordered before the next frame on the
+    // queue (the barriers recorded by the callers make their results visible),
+    // and the command buffer is freed once that frame is complete.
+    m_deletionQueue.releaseCommandBuffer(getReleaseFrame(), m_commandPool, cmdBuffer);
 
-    // cleanup command buffer
-    vkFreeCommandBuffers(m_device, m_commandPool, 1, &cmdBuffer);
+    lock.unlock();
 }
 
 
@@ -2026,6 +2894,8 @@ void VulkanManager::endSingleTimeCommands(VkCommandBuffer cmdBuffer)
 
 bool VulkanManager::createTextureImage()
 {
+    PROFILE_FUNCTION();
+
     // load image file
     int imgWidth, imgHeight, imgChannels;
     stbi_uc* pixels = stbi_load("../src/images/pizza.jpg", &imgWidth, &imgHeight, &imgChannels, STBI_rgb_alpha);
@@ -2047,6 +2917,7 @@ bool VulkanManager::createTextureImage()
     createBuffer(imgSize,
                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Staging,
                  stagingBuffer,
                  stagingBufferMemory);
 
@@ -2061,6 +2932,7 @@ bool VulkanManager::createTextureImage()
     // 1. Create Image
     //
     createImage(imgWidth, imgHeight,
+                VK_SAMPLE_COUNT_1_BIT,
                 VK_FORMAT_R8G8B8A8_SRGB,    // same foramt as 'pixels'
                 // two choice for tiling:
                 // - VK_IMAGE_TILING_LINEAR: texels in row-major, allowes direct access texels in the memory
@@ -2070,6 +2942,7 @@ bool VulkanManager::createTextureImage()
                 VK_IMAGE_USAGE_TRANSFER_DST_BIT | // our destination
                 VK_IMAGE_USAGE_SAMPLED_BIT,       // allow to access from the shader
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                MemoryCategory::Texture,
                 m_textureImage,
                 m_textureImageMemory);
 
@@ -2079,12 +2952,44 @@ bool VulkanManager::createTextureImage()
     transitionImageLayout(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
     // execute copy command
     copyBufferToImage(stagingBuffer, m_textureImage, static_cast<uint32_t>(imgWidth), static_cast<uint32_t>(imgHeight));
-    // another transition for shader access
-    transitionImageLayout(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // 3. Process (see setTextureProcessing)
+    //
+    const std::vector<ImageDispatch> dispatches = planImageDispatches(m_textureProcessing, imgWidth, imgHeight);
+    if (dispatches.empty())
+    {
+        // another transition for shader access
+        transitionImageLayout(m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    else
+    {
+        // the uploaded image is the source, the texture is the result (its size may differ)
+        VkImage         sourceImage         = m_textureImage;
+        VkDeviceMemory  sourceImageMemory   = m_textureImageMemory;
+        VkImageView     sourceImageView;
+        if (!createImageView(sourceImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, &sourceImageView))
+            result = false;
+
+        createImage(dispatches.back().width, dispatches.back().height,
+                    VK_SAMPLE_COUNT_1_BIT,
+                    VK_FORMAT_R8G8B8A8_SRGB,
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT |   // blitted to
+                    VK_IMAGE_USAGE_SAMPLED_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    MemoryCategory::Texture,
+                    m_textureImage,
+                    m_textureImageMemory);
+
+        result &= processImage(sourceImage, sourceImageView, m_textureImage, dispatches);
+
+        m_deletionQueue.releaseImageView(getReleaseFrame(), sourceImageView);
+        m_deletionQueue.releaseImage(getReleaseFrame(), sourceImage, sourceImageMemory);
+    }
 
     // cleanup
-    vkDestroyBuffer(m_device, stagingBuffer, nullptr);
-    vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+    // still read by the copy, destroyed once it's done
+    m_deletionQueue.releaseBuffer(getReleaseFrame(), stagingBuffer, stagingBufferMemory);
 
     if (result == true)
         PRINTLN("created texture");
@@ -2092,9 +2997,308 @@ bool VulkanManager::createTextureImage()
     return result;
 }
 
+
+// -------------------------<<  Image Processing  >>--------------------------
+//
+//  Chains of image operations (see ImageProcessing.h) run as compute
+//  dispatches, i.e. to preprocess the textures on load instead of on the CPU.
+//
+//  The intermediate results ping-pong between two RGBA16F storage images
+//  (storage on 8-bit sRGB formats is not supported), sized for the largest
+//  step. The last one is blitted into the destination, which encodes it
+//  back to sRGB. The barriers between the dispatches come from a render
+//  graph, as for the frames.
+//
+//  The work goes to the graphics queue (it supports compute, see
+//  findQueueFamilies), ordered before the first frame like the uploads.
+//
+// ---------------------------------------------------------------------------
+
+void VulkanManager::setTextureProcessing(const ImageOperationChain& chain)
+{
+    // the textures are processed as they are created
+    if (m_device != VK_NULL_HANDLE)
+        throw std::runtime_error("texture processing must be set before initVulkan()");
+
+    m_textureProcessing = chain;
+}
+
+bool VulkanManager::createImageProcessingPipeline()
+{
+    PROFILE_FUNCTION();
+
+    // input (sampled, to resample it with the hardware filter) and output
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding         = 0;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding         = 1;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+    descriptorSetLayoutInfo.sType           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutInfo.bindingCount    = 2;
+    descriptorSetLayoutInfo.pBindings       = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutInfo, HostAllocator::getCallbacks(), &m_imageProcessingSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image processing descriptor set layout!");
+        return false;
+    }
+
+    // the operations of a dispatch
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags    = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset        = 0;
+    pushConstantRange.size          = sizeof(ImageDispatchConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                    = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount           = 1;
+    pipelineLayoutInfo.pSetLayouts              = &m_imageProcessingSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount   = 1;
+    pipelineLayoutInfo.pPushConstantRanges      = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, HostAllocator::getCallbacks(), &m_imageProcessingPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image processing pipeline layout!");
+        return false;
+    }
+
+    VkShaderModule shaderModule = createShaderModule(m_shaderCompiler.loadSpirv(IMAGE_OPS_SHADER));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType          = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType    = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage    = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module   = shaderModule;
+    pipelineInfo.stage.pName    = "main";
+    pipelineInfo.layout         = m_imageProcessingPipelineLayout;
+
+    const VkResult pipelineResult = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, HostAllocator::getCallbacks(), &m_imageProcessingPipeline);
+    vkDestroyShaderModule(m_device, shaderModule, HostAllocator::getCallbacks());
+    if (pipelineResult != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image processing pipeline!");
+        return false;
+    }
+
+    // clamped, the resize must not wrap around the edges
+    VkSamplerCreateInfo samplerCreateInfo{};
+    samplerCreateInfo.sType         = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.magFilter     = VK_FILTER_LINEAR;
+    samplerCreateInfo.minFilter     = VK_FILTER_LINEAR;
+    samplerCreateInfo.addressModeU  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeV  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.addressModeW  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerCreateInfo.mipmapMode    = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerCreateInfo.maxLod        = 0.0f;
+
+    if (vkCreateSampler(m_device, &samplerCreateInfo, HostAllocator::getCallbacks(), &m_imageProcessingSampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image processing sampler!");
+        return false;
+    }
+
+    PRINTLN("Created Image Processing Pipeline");
+
+    return true;
+}
+
+bool VulkanManager::processImage(VkImage srcImage, VkImageView srcImageView, VkImage dstImage,
+                                 const std::vector<ImageDispatch>& dispatches)
+{
+    PROFILE_FUNCTION();
+
+    if (dispatches.empty())
+        return true;
+
+    // textures may be loaded by several jobs, the pipeline is created once
+    std::lock_guard<std::mutex> lock(m_imageProcessingMutex);
+    if (m_imageProcessingPipeline == VK_NULL_HANDLE && !createImageProcessingPipeline())
+        return false;
+
+    const uint32_t n_dispatches = static_cast<uint32_t>(dispatches.size());
+
+    // 1. Ping-pong images
+    //
+    uint32_t maxWidth   = 0;
+    uint32_t maxHeight  = 0;
+    for (const ImageDispatch& dispatch : dispatches)
+    {
+        maxWidth    = std::max(maxWidth, dispatch.width);
+        maxHeight   = std::max(maxHeight, dispatch.height);
+    }
+
+    const uint32_t  n_pingPongImages = std::min(n_dispatches, 2u);
+    VkImage         pingPongImages[2]       = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkDeviceMemory  pingPongImagesMemory[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkImageView     pingPongImageViews[2]   = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    for (uint32_t i = 0; i < n_pingPongImages; ++i)
+    {
+        createImage(maxWidth, maxHeight,
+                    VK_SAMPLE_COUNT_1_BIT,
+                    VK_FORMAT_R16G16B16A16_SFLOAT,      // storage and blit source support are mandatory
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    MemoryCategory::Texture,
+                    pingPongImages[i],
+                    pingPongImagesMemory[i]);
+        if (!createImageView(pingPongImages[i], VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, &pingPongImageViews[i]))
+            return false;
+    }
+
+    // 2. Descriptor sets
+    //
+    // one per dispatch: reads the previous result, writes to the other image
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type               = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount    = n_dispatches;
+    poolSizes[1].type               = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount    = n_dispatches;
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.poolSizeCount = 2;
+    descriptorPoolInfo.pPoolSizes    = poolSizes;
+    descriptorPoolInfo.maxSets       = n_dispatches;
+
+    VkDescriptorPool descriptorPool;
+    if (vkCreateDescriptorPool(m_device, &descriptorPoolInfo, HostAllocator::getCallbacks(), &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create image processing descriptor pool!");
+        return false;
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(n_dispatches, m_imageProcessingSetLayout);
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+    descriptorSetAllocateInfo.sType                 = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.descriptorPool        = descriptorPool;
+    descriptorSetAllocateInfo.descriptorSetCount    = n_dispatches;
+    descriptorSetAllocateInfo.pSetLayouts           = setLayouts.data();
+
+    std::vector<VkDescriptorSet> descriptorSets(n_dispatches);
+    if (vkAllocateDescriptorSets(m_device, &descriptorSetAllocateInfo, descriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate image processing descriptor sets!");
+        return false;
+    }
+
+    std::vector<VkDescriptorImageInfo>  imageInfos(n_dispatches * 2);
+    std::vector<VkWriteDescriptorSet>   descriptorWrites(n_dispatches * 2);
+    for (uint32_t i = 0; i < n_dispatches; ++i)
+    {
+        VkDescriptorImageInfo& inputInfo    = imageInfos[i * 2];
+        inputInfo.sampler                   = m_imageProcessingSampler;
+        inputInfo.imageView                 = i == 0 ? srcImageView : pingPongImageViews[(i - 1) % 2];
+        inputInfo.imageLayout               = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkDescriptorImageInfo& outputInfo   = imageInfos[i * 2 + 1];
+        outputInfo.imageView                = pingPongImageViews[i % 2];
+        outputInfo.imageLayout              = VK_IMAGE_LAYOUT_GENERAL;
+
+        for (uint32_t binding = 0; binding < 2; ++binding)
+        {
+            VkWriteDescriptorSet& descriptorWrite = descriptorWrites[i * 2 + binding];
+            descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet          = descriptorSets[i];
+            descriptorWrite.dstBinding      = binding;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.descriptorType  = binding == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrite.pImageInfo      = &imageInfos[i * 2 + binding];
+        }
+    }
+    vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    // 3. Passes
+    //
+    // the source is left as copied to (see createTextureImage), the destination
+    // ready to be sampled by the frames
+    RenderGraph graph;
+    const RenderGraphImage source       = graph.importImage("source", VK_IMAGE_ASPECT_COLOR_BIT, ImageUsage::TransferDst, ImageUsage::Undefined);
+    const RenderGraphImage destination  = graph.importImage("destination", VK_IMAGE_ASPECT_COLOR_BIT, ImageUsage::Undefined, ImageUsage::SampledFragment);
+    const RenderGraphImage pingPong[2]  =
+    {
+        graph.importImage("ping", VK_IMAGE_ASPECT_COLOR_BIT, ImageUsage::Undefined, ImageUsage::Undefined),
+        graph.importImage("pong", VK_IMAGE_ASPECT_COLOR_BIT, ImageUsage::Undefined, ImageUsage::Undefined),
+    };
+
+    for (uint32_t i = 0; i < n_dispatches; ++i)
+    {
+        const RenderGraphPass pass = graph.addPass("image op", [this, &dispatches, &descriptorSets, i](VkCommandBuffer commandBuffer)
+        {
+            const ImageDispatch& dispatch = dispatches[i];
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_imageProcessingPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_imageProcessingPipelineLayout,
+                                    0, 1, &descriptorSets[i], 0, nullptr);
+            vkCmdPushConstants(commandBuffer, m_imageProcessingPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                               0, sizeof(ImageDispatchConstants), &dispatch.constants);
+            vkCmdDispatch(commandBuffer,
+                          (dispatch.width + IMAGE_DISPATCH_GROUP - 1) / IMAGE_DISPATCH_GROUP,
+                          (dispatch.height + IMAGE_DISPATCH_GROUP - 1) / IMAGE_DISPATCH_GROUP,
+                          1);
+        });
+        graph.read(pass, i == 0 ? source : pingPong[(i - 1) % 2], ImageUsage::SampledCompute);
+        graph.write(pass, pingPong[i % 2], ImageUsage::StorageCompute, true);   // every pixel is written
+    }
+
+    // the result is in the corner of the last image, same size as the destination
+    const ImageDispatch& lastDispatch = dispatches.back();
+    const RenderGraphPass blitPass = graph.addPass("blit", [&](VkCommandBuffer commandBuffer)
+    {
+        VkImageBlit blit{};
+        blit.srcSubresource.aspectMask  = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.layerCount  = 1;
+        blit.srcOffsets[1]              = { static_cast<int32_t>(lastDispatch.width), static_cast<int32_t>(lastDispatch.height), 1 };
+        blit.dstSubresource             = blit.srcSubresource;
+        blit.dstOffsets[1]              = blit.srcOffsets[1];
+        vkCmdBlitImage(commandBuffer,
+                       pingPongImages[(n_dispatches - 1) % 2], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       1, &blit, VK_FILTER_NEAREST);
+    });
+    graph.read(blitPass, pingPong[(n_dispatches - 1) % 2], ImageUsage::TransferSrc);
+    graph.write(blitPass, destination, ImageUsage::TransferDst, true);
+
+    if (!graph.compile())
+        return false;
+
+    graph.bindImage(source, srcImage);
+    graph.bindImage(destination, dstImage);
+    graph.bindImage(pingPong[0], pingPongImages[0]);
+    graph.bindImage(pingPong[1], pingPongImages[1]);
+
+    // a one-off, the barriers don't need a frame's arena
+    LinearArena arena(4096);
+    std::unique_lock<std::mutex> commandsLock;
+    VkCommandBuffer cmdBuffer = beginSingleTimeCommands(commandsLock);
+    graph.execute(cmdBuffer, arena);
+    endSingleTimeCommands(cmdBuffer, std::move(commandsLock));
+
+    // cleanup
+    // still used by the dispatches, destroyed once they are done
+    for (uint32_t i = 0; i < n_pingPongImages; ++i)
+    {
+        m_deletionQueue.releaseImageView(getReleaseFrame(), pingPongImageViews[i]);
+        m_deletionQueue.releaseImage(getReleaseFrame(), pingPongImages[i], pingPongImagesMemory[i]);
+    }
+    m_deletionQueue.releaseDescriptorPool(getReleaseFrame(), descriptorPool);
+
+    PRINTLN_VERBOSE("Image Processing) " << n_dispatches << " dispatches, " << lastDispatch.width << "x" << lastDispatch.height);
+
+    return true;
+}
+
+
 void VulkanManager::createImage(uint32_t width, uint32_t height,
+                                VkSampleCountFlagBits samples,
                                 VkFormat format, VkImageTiling tiling,
                                 VkImageUsageFlags usage, VkMemoryPropertyFlags property,
+                                MemoryCategory memoryCategory,
                                 VkImage &image, VkDeviceMemory &imageMemory)
 {
     // create image
@@ -2111,10 +3315,10 @@ void VulkanManager::createImage(uint32_t width, uint32_t height,
     imageCreateInfo.initialLayout   = VK_IMAGE_LAYOUT_UNDEFINED;        // no need to pre-initialize and preserve texels in our case
     imageCreateInfo.usage           = usage;
     imageCreateInfo.sharingMode     = VK_SHARING_MODE_EXCLUSIVE;
-    imageCreateInfo.samples         = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.samples         = samples;  // > 1 only for attachments
     imageCreateInfo.flags           = 0;    // optional
 
-    if (vkCreateImage(m_device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS)
+    if (vkCreateImage(m_device, &imageCreateInfo, HostAllocator::getCallbacks(), &image) != VK_SUCCESS)
         throw std::runtime_error("failed to create image!");
 
     // memory allocation
@@ -2124,9 +3328,21 @@ void VulkanManager::createImage(uint32_t width, uint32_t height,
     VkMemoryAllocateInfo memoryAllocateInfo{};
     memoryAllocateInfo.sType            = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     memoryAllocateInfo.allocationSize   = memoryRequirements.size;
-    memoryAllocateInfo.memoryTypeIndex  = findMemoryType(memoryRequirements.memoryTypeBits, property);
+    try
+    {
+        memoryAllocateInfo.memoryTypeIndex  = findMemoryType(memoryRequirements.memoryTypeBits, property);
+    }
+    catch (const std::runtime_error&)
+    {
+        // lazily allocated memory (backed on demand, i.e. tile memory) only exists on
+        // tile-based GPUs. Fall back to regular memory for the transient attachments.
+        if (!(property & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+            throw;
+        memoryAllocateInfo.memoryTypeIndex  = findMemoryType(memoryRequirements.memoryTypeBits,
+                                                             property & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    }
 
-    if (vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &imageMemory) != VK_SUCCESS)
+    if (m_memoryTracker.allocate(m_device, memoryAllocateInfo, memoryCategory, &imageMemory) != VK_SUCCESS)
         throw std::runtime_error("failed to allocate image memory!");
 
     vkBindImageMemory(m_device, image, imageMemory, 0);
@@ -2136,7 +3352,8 @@ void VulkanManager::transitionImageLayout(VkImage image, VkFormat format, VkImag
 {
     // handle image to be placed in the right layout
 
-    VkCommandBuffer cmdBuffer = beginSingleTimeCommands();
+    std::unique_lock<std::mutex> commandsLock;
+    VkCommandBuffer cmdBuffer = beginSingleTimeCommands(commandsLock);
 
     // Image barrier is one way (and most common) to handle layout transitions.
     // Usually it is to sync. resource access (finish write before read), but here
@@ -2158,25 +3375,13 @@ void VulkanManager::transitionImageLayout(VkImage image, VkFormat format, VkImag
     imageMemoryBarrier.subresourceRange.baseArrayLayer  = 0;
     imageMemoryBarrier.subresourceRange.layerCount      = 1;
     // specify which type of operations will be done and needed to be waited before/after
-    // the barrier. We handle based on the layout type
-    VkPipelineStageFlags srcStage;
-    VkPipelineStageFlags dstStage;
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        imageMemoryBarrier.srcAccessMask    = 0;
-        imageMemoryBarrier.dstAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT;
-        srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        srcStage    = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dstStage    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else
-        throw std::invalid_argument("unsupported layout transition!");
+    // the barrier. Derived from the layouts, as the render graph does (see RenderGraph)
+    const ImageState srcState = getImageLayoutState(oldLayout);
+    const ImageState dstState = getImageLayoutState(newLayout);
+    imageMemoryBarrier.srcAccessMask    = srcState.accessMask;
+    imageMemoryBarrier.dstAccessMask    = dstState.accessMask;
+    VkPipelineStageFlags srcStage = srcState.stageMask;
+    VkPipelineStageFlags dstStage = dstState.stageMask;
 
     vkCmdPipelineBarrier(
         cmdBuffer,
@@ -2187,12 +3392,13 @@ void VulkanManager::transitionImageLayout(VkImage image, VkFormat format, VkImag
         1, &imageMemoryBarrier // image memory barriers
     );
 
-    endSingleTimeCommands(cmdBuffer);
+    endSingleTimeCommands(cmdBuffer, std::move(commandsLock));
 }
 
 void VulkanManager::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
 {
-    VkCommandBuffer cmdBuffer = beginSingleTimeCommands();
+    std::unique_lock<std::mutex> commandsLock;
+    VkCommandBuffer cmdBuffer = beginSingleTimeCommands(commandsLock);
 
     VkBufferImageCopy copyRegion{};
     // data padding
@@ -2216,7 +3422,7 @@ void VulkanManager::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t w
         &copyRegion
     );
 
-    endSingleTimeCommands(cmdBuffer);
+    endSingleTimeCommands(cmdBuffer, std::move(commandsLock));
 }
 
 
@@ -2232,6 +3438,8 @@ void VulkanManager::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t w
 
 bool VulkanManager::createCommandPool()
 {
+    PROFILE_FUNCTION();
+
     QueueFamilyIndices queueFamilyIndices = findQueueFamilies(m_physicalDevice);
     VkCommandPoolCreateInfo commandPoolCreateInfo{};
     commandPoolCreateInfo.sType             = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -2241,9 +3449,9 @@ bool VulkanManager::createCommandPool()
     // optional flag has two choices:
     //  - VK_COMMAND_POOL_CREATE_TRANSIENT_BIT: command buffers are recorded with new commands very often
     //  - VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT: allow command buffers to be recoreded individually
-    commandPoolCreateInfo.flags             = 0;    // neither in that case
+    commandPoolCreateInfo.flags             = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;  // re-recorded every frame
 
-    if (vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+    if (vkCreateCommandPool(m_device, &commandPoolCreateInfo, HostAllocator::getCallbacks(), &m_commandPool) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create command pool!");
         return false;
@@ -2256,6 +3464,8 @@ bool VulkanManager::createCommandPool()
 
 bool VulkanManager::createCommandBuffers()
 {
+    PROFILE_FUNCTION();
+
     // Here we record the drawing commands, which requires to bind into a correct VkFrameBuffer.
     // Therefore, we'll record the command for each swapchain images into the VkCommandBuffer objects.
     // Note that these command objects will be freed when the command pool is destroyed, so
@@ -2280,70 +3490,165 @@ bool VulkanManager::createCommandBuffers()
         result = false;
     }
 
-    for (size_t i = 0; i < m_commandBuffers.size(); i++)
+    // recorded every frame, see drawFrame
+
+    if (result == true)
+        PRINTLN("Created Command Buffers");
+
+    return result;
+}
+
+bool VulkanManager::recordCommandBuffer(uint32_t i)
+{
+    // records the drawing commands of one swapchain image. The command buffer must not be in use.
+    bool result = true;
+
+    // 1. Start recording command buffers
+    VkCommandBufferBeginInfo commandBufferBeginInfo{};
+    commandBufferBeginInfo.sType    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // optional flag specifying how the command buffers will be used
+    //  - VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT: will be recorded right after executing it once
+    //  - VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT: will be a secondary command buffer living in a single render pass
+    //  - VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT: will be able to be re-submitted even if it's in a pending state
+    commandBufferBeginInfo.flags            = 0;
+    commandBufferBeginInfo.pInheritanceInfo = nullptr;  // only relavent for secondary command buffers
+
+    if (vkBeginCommandBuffer(m_commandBuffers[i], &commandBufferBeginInfo) != VK_SUCCESS)
     {
-        // 1. Start recording command buffers
-        VkCommandBufferBeginInfo commandBufferBeginInfo{};
-        commandBufferBeginInfo.sType    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        // optional flag specifying how the command buffers will be used
-        //  - VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT: will be recorded right after executing it once
-        //  - VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT: will be a secondary command buffer living in a single render pass
-        //  - VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT: will be able to be re-submitted even if it's in a pending state
-        commandBufferBeginInfo.flags            = 0;
-        commandBufferBeginInfo.pInheritanceInfo = nullptr;  // only relavent for secondary command buffers
+        throw std::runtime_error("failed to begin command buffer!");
+        result = false;
+    }
 
-        if (vkBeginCommandBuffer(m_commandBuffers[i], &commandBufferBeginInfo) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to begin command buffer!");
-            result = false;
-        }
+    // the queries of the frame's slot, see GpuStats
+    m_gpuStats.beginFrame(m_commandBuffers[i], m_recordingFrameIndex, m_frameCounter + 1);
+
+    // 2. Passes
+    // the graph records the barriers between them (see createRenderGraph)
+    m_recordingImageIndex = i;
+    RenderGraph& graph = m_recordingCapture ? m_captureGraph : m_renderGraph;
+    graph.bindImage(m_graphSwapchainImage, m_swapchainImages[i]);
+    graph.bindImage(m_graphTextureImage, m_textureImage);
+    graph.bindImage(m_graphDepthImage, m_depthImage);
+    if (m_colorImage != VK_NULL_HANDLE)
+        graph.bindImage(m_graphColorImage, m_colorImage);
+    graph.execute(m_commandBuffers[i], m_frameArenas[m_recordingFrameIndex]);
+
+    // 3. Finish
+    if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to record command buffer!");
+        result = false;
+    }
 
-        // 2. Start render passes
-        VkRenderPassBeginInfo renderPassBeginInfo{};
-        renderPassBeginInfo.sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.renderPass  = m_renderPass;
-        renderPassBeginInfo.framebuffer = m_swapchainFrameBuffers[i];
-        // render area size
-        renderPassBeginInfo.renderArea.offset   = {0, 0};
-        renderPassBeginInfo.renderArea.extent   = m_swapchainExtent;
-        // clear color that will be used by VK_ATTACHMENT_LOAD_OP_CLEAR option we previouly set
-        VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-        renderPassBeginInfo.clearValueCount = 1;
-        renderPassBeginInfo.pClearValues    = &clearColor;
-
-        // Begin render pass
-        // last parameter: how the drawing command within the render pass will be provided.
-        //  - VK_SUBPASS_CONTENTS_INLINE: render pass commands will be embedded in the primary commnad buffer, no secondary command buffer execution happening
-        //  - VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: render pass commands are executed in the secondary command buffers
-        vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        // Bind graphics pipeline
-        vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);    // graphics or compute?
-        // In our example, only contains vertex data
-        VkBuffer vertexBuffers[] = {m_vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(m_commandBuffers[i], m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-        // 3. Record commands
-        // All the functions that record commands are prefixed with vkCmd
-        // (vertex count, instance count, first vertex, first instance)
-        vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1 , &m_descriptorSets[i], 0, nullptr);
-        vkCmdDrawIndexed(m_commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    return result;
+}
 
-        // 4. Finish
-        vkCmdEndRenderPass(m_commandBuffers[i]);
-        if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS)
+void VulkanManager::recordMainPass(VkCommandBuffer commandBuffer)
+{
+    // the swapchain image the command buffer is recorded for
+    const uint32_t i = m_recordingImageIndex;
+
+    // 1. Start render pass
+    VkRenderPassBeginInfo renderPassBeginInfo{};
+    renderPassBeginInfo.sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassBeginInfo.renderPass  = m_renderPass;
+    renderPassBeginInfo.framebuffer = m_swapchainFrameBuffers[i];
+    // render area size
+    renderPassBeginInfo.renderArea.offset   = {0, 0};
+    renderPassBeginInfo.renderArea.extent   = m_swapchainExtent;
+    // clear color used by VK_ATTACHMENT_LOAD_OP_CLEAR (the main pass clears the swapchain image, see createRenderGraph)
+    // in the order of the attachments. Depth is cleared to the far plane, the
+    // resolve attachment (if any) is not cleared.
+    VkClearValue clearValues[2]{};
+    clearValues[0].color        = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clearValues[1].depthStencil = {1.0f, 0};
+    renderPassBeginInfo.clearValueCount = 2;
+    renderPassBeginInfo.pClearValues    = clearValues;
+
+    // Begin render pass
+    // last parameter: how the drawing command within the render pass will be provided.
+    //  - VK_SUBPASS_CONTENTS_INLINE: render pass commands will be embedded in the primary commnad buffer, no secondary command buffer execution happening
+    //  - VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: render pass commands are executed in the secondary command buffers
+    // pipeline statistics can't start inside the render pass
+    m_gpuStats.beginPass(commandBuffer, "main");
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    // the pipeline is compiled asynchronously, the draw is skipped (clear only)
+    // until it's ready. Recorded again once it is (see updateGraphicsPipeline).
+    if (m_graphicsPipeline != VK_NULL_HANDLE)
+    {
+        // the state a draw refers to (see DrawItem)
+        const VkPipeline        pipelines[] = {m_graphicsPipeline};
+        const VkDescriptorSet   materials[] = {m_descriptorSets[i]};
+
+        // dynamic states of all the pipelines
+        VkViewport viewport{};
+        viewport.x          = 0.0f;
+        viewport.y          = 0.0f;
+        viewport.width      = (float) m_swapchainExtent.width;
+        viewport.height     = (float) m_swapchainExtent.height;
+        viewport.minDepth   = 0.0f; // range of depth value in the framebuffer.
+        viewport.maxDepth   = 1.0f; // always within (0,1), but min value can be greater than max
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};    // cover from the beginning
+        scissor.extent = m_swapchainExtent; // to full size of the swapchain
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        // 2. Record commands
+        // All the functions that record commands are prefixed with vkCmd
+        // Sorted by state (see sortOpaqueDraws), a state is only bound when
+        // it differs from the previous draw's.
+        // The world matrices are per instance, in the sorted order (see
+        // updateInstanceBuffer): the n-th draw is instance n.
+        m_gpuStats.beginOcclusion(commandBuffer, "opaque");
+        VkDeviceSize instanceOffset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 1, 1, &m_instanceBuffers[i], &instanceOffset);
+
+        uint32_t boundPipeline = UINT32_MAX;
+        uint32_t boundMaterial = UINT32_MAX;
+        uint32_t boundMesh     = UINT32_MAX;
+        for (uint32_t instance = 0; instance < m_opaqueDrawOrder.size(); instance++)
         {
-            throw std::runtime_error("failed to record command buffer!");
-            result = false;
+            const DrawItem& draw = m_opaqueDraws[m_opaqueDrawOrder[instance].drawIndex];
+
+            if (draw.pipeline != boundPipeline)
+            {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[draw.pipeline]);    // graphics or compute?
+                boundPipeline = draw.pipeline;
+            }
+            if (draw.material != boundMaterial)
+            {
+                // compatible pipeline layouts keep the sets bound across pipeline changes
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &materials[draw.material], 0, nullptr);
+                boundMaterial = draw.material;
+            }
+            if (draw.mesh != boundMesh)
+            {
+                const DrawMesh& mesh = m_meshes[draw.mesh];
+                VkDeviceSize offset = 0;
+                vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.vertexBuffer, &offset);
+                vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                boundMesh = draw.mesh;
+            }
+
+            // (index count, instance count, first index, vertex offset, first instance)
+            vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, instance);
         }
+        m_gpuStats.endOcclusion(commandBuffer);
     }
 
-    if (result == true)
-        PRINTLN("Created Command Buffers");
+    // on top of the scene, same viewport and scissor
+    if (m_spritePipeline != VK_NULL_HANDLE && m_graphicsPipeline != VK_NULL_HANDLE)
+    {
+        m_gpuStats.beginOcclusion(commandBuffer, "sprites");
+        recordSpriteDraws(commandBuffer);
+        m_gpuStats.endOcclusion(commandBuffer);
+    }
 
-    return result;
+    vkCmdEndRenderPass(commandBuffer);
+    m_gpuStats.endPass(commandBuffer);
 }
 
 void VulkanManager::setFrameBufferResized(bool isResized)
@@ -2361,6 +3666,8 @@ void VulkanManager::setFrameBufferResized(bool isResized)
 
 bool VulkanManager::createSyncObjects()
 {
+    PROFILE_FUNCTION();
+
     // Syncronizing swapchain events can be done in two ways - Fences or
     // Semaphores.
     // "Fences" states can be accessed from the program using "vkWaitForFences"
@@ -2368,34 +3675,96 @@ bool VulkanManager::createSyncObjects()
     // rendering.
     // "Semaphores" in the other hand, cannot be accessed by the program and it's
     // usage is mainly for syncronizing across the command queues.
+    // "Timeline Semaphores" (Vulkan 1.2) are both: a monotonically increasing
+    // 64-bit counter that the queue signals, and the host can wait on. We use a
+    // single one with the value of the frame number instead of per-frame fences.
 
-    m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);    // for command queue syncronization
-    m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);    // for command queue syncronization
-    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);  // for CPU-GPU syncronization
-    m_imagesInFlight.resize(m_swapchainImages.size(), VK_NULL_HANDLE);  // track images in flight
+    m_imageAvailableSemaphores.resize(m_maxFramesInFlight);     // for command queue syncronization
+    m_renderFinishedSemaphores.resize(m_maxFramesInFlight);     // for command queue syncronization
+    m_frameArenas.clear();                                      // transient CPU data of the frames
+    for (uint32_t i = 0; i < m_maxFramesInFlight; ++i)
+        m_frameArenas.emplace_back(FRAME_ARENA_SIZE);
+    m_imageFrameNumbers.assign(m_swapchainImages.size(), 0);    // track images in flight
 
     VkSemaphoreCreateInfo semaphoreCreateInfo{};
     semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    VkFenceCreateInfo fenceCreateInfo{};
-    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    for (size_t i = 0; i < m_maxFramesInFlight; ++i)
     {
-        if (vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS)
+        if (vkCreateSemaphore(m_device, &semaphoreCreateInfo, HostAllocator::getCallbacks(), &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
+            vkCreateSemaphore(m_device, &semaphoreCreateInfo, HostAllocator::getCallbacks(), &m_renderFinishedSemaphores[i]) != VK_SUCCESS)
         {
-            throw std::runtime_error("failed to create semaphores and fences!");
+            throw std::runtime_error("failed to create semaphores!");
             return false;
         }
     }
 
+    // for CPU-GPU syncronization
+    VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+    semaphoreTypeCreateInfo.sType           = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    semaphoreTypeCreateInfo.semaphoreType   = VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphoreTypeCreateInfo.initialValue    = m_frameCounter;
+    VkSemaphoreCreateInfo timelineCreateInfo{};
+    timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+    if (vkCreateSemaphore(m_device, &timelineCreateInfo, HostAllocator::getCallbacks(), &m_frameTimeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create frame timeline semaphore!");
+        return false;
+    }
+
     PRINTLN_VERBOSE("Created Semaphores");
 
     return true;
 }
 
+bool VulkanManager::isFrameComplete(uint64_t frameNumber)
+{
+    // Any subsystem (uploads, deferred deletion...) can ask for a frame without
+    // owning a fence. The cached value saves the query for the frames that are
+    // already known to be complete.
+    if (frameNumber <= m_completedFrame.load(std::memory_order_acquire))
+        return true;
+
+    return frameNumber <= getCompletedFrame();
+}
+
+uint64_t VulkanManager::getCompletedFrame()
+{
+    uint64_t completedFrame = m_completedFrame.load(std::memory_order_acquire);
+
+    uint64_t timelineValue = 0;
+    vkGetSemaphoreCounterValue(m_device, m_frameTimeline, &timelineValue);
+
+    // the timeline only moves forward, so keep the largest value
+    while (completedFrame < timelineValue &&
+           !m_completedFrame.compare_exchange_weak(completedFrame, timelineValue, std::memory_order_acq_rel))
+        ;
+
+    return std::max(completedFrame, timelineValue);
+}
+
+void VulkanManager::waitForFrame(uint64_t frameNumber)
+{
+    uint64_t completedFrame = m_completedFrame.load(std::memory_order_acquire);
+    if (frameNumber <= completedFrame)
+        return;
+
+    VkSemaphoreWaitInfo semaphoreWaitInfo{};
+    semaphoreWaitInfo.sType             = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    semaphoreWaitInfo.semaphoreCount    = 1;
+    semaphoreWaitInfo.pSemaphores       = &m_frameTimeline;
+    semaphoreWaitInfo.pValues           = &frameNumber;
+
+    if (vkWaitSemaphores(m_device, &semaphoreWaitInfo, UINT64_MAX) != VK_SUCCESS)
+        throw std::runtime_error("failed to wait for the frame timeline!");
+
+    while (completedFrame < frameNumber &&
+           !m_completedFrame.compare_exchange_weak(completedFrame, frameNumber, std::memory_order_acq_rel))
+        ;
+}
+
 bool VulkanManager::acquireNextImageIndex(const uint32_t frameIndex, uint32_t &nextImageIndex)
 {
     // Returns whether the swapchain is still adequate for the presentation
@@ -2406,7 +3775,11 @@ bool VulkanManager::acquireNextImageIndex(const uint32_t frameIndex, uint32_t &n
     //                           usually happens due to window resizing.
     //  VK_SUBOPTIMAL_KHR: swapchain can be still used but the properties no longer match.
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        // no image has been acquired, so there is nothing to draw into
         recreateSwapChain();
+        return false;
+    }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
     {
         throw std::runtime_error("failed to aquire swapchain images!");
@@ -2416,14 +3789,22 @@ bool VulkanManager::acquireNextImageIndex(const uint32_t frameIndex, uint32_t &n
     return true;
 }
 
-bool VulkanManager::submitCommandBuffer(const uint32_t frameIndex, const uint32_t imageIndex)
+bool VulkanManager::submitCommandBuffer(const uint32_t frameIndex, const uint32_t imageIndex, const uint64_t frameNumber)
 {
-    VkSemaphore             signalSemaphores[] = {m_renderFinishedSemaphores[frameIndex]};
+    VkSemaphore             signalSemaphores[] = {m_renderFinishedSemaphores[frameIndex], m_frameTimeline};
     VkSemaphore             waitSemaphores[] = {m_imageAvailableSemaphores[frameIndex]};
     VkPipelineStageFlags    waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 
+    // the value to signal for each semaphore. Binary semaphores ignore it.
+    uint64_t                signalValues[] = {0, frameNumber};
+    VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+    timelineSubmitInfo.sType                        = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineSubmitInfo.signalSemaphoreValueCount    = 2;
+    timelineSubmitInfo.pSignalSemaphoreValues       = signalValues;
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineSubmitInfo;
     // Semaphore information. In this case, we would like to wait until the
     // graphics pipeline stage where color attachment is available.
     submitInfo.waitSemaphoreCount   = 1;
@@ -2433,11 +3814,12 @@ bool VulkanManager::submitCommandBuffer(const uint32_t frameIndex, const uint32_
     // acquired swapchain image
     submitInfo.commandBufferCount   = 1;
     submitInfo.pCommandBuffers      = &m_commandBuffers[imageIndex];
-    // Which semaphores to signal once command buffer has finised execution
-    submitInfo.signalSemaphoreCount = 1;
+    // Which semaphores to signal once command buffer has finised execution.
+    // The frame timeline reaching 'frameNumber' replaces the in-flight fence.
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores    = signalSemaphores;
 
-    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[frameIndex]) != VK_SUCCESS)
+    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to submit command buffer!");
         return false;
@@ -2485,12 +3867,14 @@ void VulkanManager::updateUniformBuffer(uint32_t currentImangeIdx)
     static auto startTime = std::chrono::high_resolution_clock::now();
     auto        currentTime = std::chrono::high_resolution_clock::now();
     float       dt = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    if (m_animationTime >= 0.0f)
+        dt = m_animationTime;
 
-    UniformBufferObject ubo{};
-    ubo.model = glm::rotate(glm::mat4(1.0f), dt * glm::radians(90.f), glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.view = glm::lookAt(glm::vec3(2.0f), glm::vec3(0.0), glm::vec3(0.0f, 0.0f, 1.0f));
-    ubo.proj = glm::perspective(glm::radians(30.f), m_swapchainExtent.width / (float)m_swapchainExtent.height, 0.1f, 10.f);
-    ubo.proj[1][1] *= -1;   // flip Y-axis (because glm was designed for OpenGL)
+    // the scene spins, its world matrices are updated along with the transforms
+    m_transforms.setRotation(m_sceneRoot, glm::angleAxis(dt * glm::radians(90.f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    UniformBufferObject ubo = UniformBufferObject::makeCamera(m_swapchainExtent.width / (float)m_swapchainExtent.height);
+    m_viewMatrix = ubo.view;    // for sorting the draws
 
     // apply transformation
     void* data;
@@ -2499,6 +3883,402 @@ void VulkanManager::updateUniformBuffer(uint32_t currentImangeIdx)
     vkUnmapMemory(m_device, m_uniformBuffersMemory[currentImangeIdx]);
 }
 
+void VulkanManager::sortOpaqueDraws(LinearArena& frameArena)
+{
+    // By state first (see DrawSort.h) to skip the redundant binds, then
+    // front-to-back by the view depth of each draw's origin: close surfaces
+    // are drawn first, the fragments behind them fail the early depth test
+    // instead of being shaded and overwritten.
+    // The order and the sort scratch live in the frame's arena, until it is recorded.
+    const ArenaAllocator<SortedDraw> allocator(frameArena);
+    m_opaqueDrawOrder = FrameVector<SortedDraw>(allocator);
+    m_opaqueDrawOrder.reserve(m_opaqueDraws.size());
+    for (uint32_t i = 0; i < m_opaqueDraws.size(); i++)
+    {
+        DrawItem& draw = m_opaqueDraws[i];
+        draw.viewDepth = -(m_viewMatrix * m_transforms.getWorldMatrix(draw.transform)[3]).z;  // the camera looks down -Z
+
+        SortedDraw sortedDraw;
+        sortedDraw.key          = makeDrawKey(m_mainPass, draw.pipeline, draw.material, draw.mesh, draw.viewDepth);
+        sortedDraw.drawIndex    = i;
+        m_opaqueDrawOrder.push_back(sortedDraw);
+    }
+
+    FrameVector<SortedDraw> scratch(allocator);
+    radixSortDraws(m_opaqueDrawOrder, scratch);
+}
+
+void VulkanManager::updateInstanceBuffer(uint32_t currentImageIdx)
+{
+    // the world matrices of the draws, in the order they are recorded
+    glm::mat4* instances = m_instanceBuffersMapped[currentImageIdx];
+    for (const SortedDraw& sortedDraw : m_opaqueDrawOrder)
+        *instances++ = m_transforms.getWorldMatrix(m_opaqueDraws[sortedDraw.drawIndex].transform);
+}
+
+
+// ---------------------------<<  Sprites  >>--------------------------------
+//
+//  The sprites submitted to the SpriteBatch are drawn at the end of the
+//  main pass, with their own pipeline. The vertices are written straight
+//  into the transient buffer (see TransientBuffer.h), the ring keeps them
+//  until the GPU is done with the frame.
+//  The index buffer never changes, and each texture has its descriptor set,
+//  so a frame costs one draw per texture.
+//
+// ---------------------------------------------------------------------------
+
+bool VulkanManager::createSpriteResources()
+{
+    PROFILE_FUNCTION();
+
+    // 1. Layouts
+    //
+    // set 0: the texture, push constants: the pixel to clip space scale
+    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
+    samplerLayoutBinding.binding            = 0;
+    samplerLayoutBinding.descriptorCount    = 1;
+    samplerLayoutBinding.descriptorType     = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerLayoutBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+    descriptorSetLayoutInfo.sType           = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutInfo.bindingCount    = 1;
+    descriptorSetLayoutInfo.pBindings       = &samplerLayoutBinding;
+
+    if (vkCreateDescriptorSetLayout(m_device, &descriptorSetLayoutInfo, HostAllocator::getCallbacks(), &m_spriteSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create sprite descriptor set layout!");
+        return false;
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags    = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset        = 0;
+    pushConstantRange.size          = sizeof(float) * 2;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                    = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount           = 1;
+    pipelineLayoutInfo.pSetLayouts              = &m_spriteSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount   = 1;
+    pipelineLayoutInfo.pPushConstantRanges      = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, HostAllocator::getCallbacks(), &m_spritePipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create sprite pipeline layout!");
+        return false;
+    }
+
+    // 2. Texture descriptor sets, see addSpriteTexture()
+    //
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type               = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount    = MAX_SPRITE_TEXTURES;
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.poolSizeCount = 1;
+    descriptorPoolInfo.pPoolSizes    = &poolSize;
+    descriptorPoolInfo.maxSets       = MAX_SPRITE_TEXTURES;
+
+    if (vkCreateDescriptorPool(m_device, &descriptorPoolInfo, HostAllocator::getCallbacks(), &m_spriteDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create sprite descriptor pool!");
+        return false;
+    }
+
+    // 3. Index buffer, 2 triangles per sprite
+    //
+    const VkDeviceSize indexBufferSize = sizeof(uint32_t) * 6 * MAX_SPRITES_PER_FRAME;
+
+    VkBuffer        stagingBuffer;
+    VkDeviceMemory  stagingBufferMemory;
+    createBuffer(indexBufferSize,
+                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 MemoryCategory::Staging,
+                 stagingBuffer,
+                 stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(m_device, stagingBufferMemory, 0, indexBufferSize, 0, &data);
+    SpriteBatch::writeIndices(static_cast<uint32_t*>(data), MAX_SPRITES_PER_FRAME);
+    vkUnmapMemory(m_device, stagingBufferMemory);
+
+    createBuffer(indexBufferSize,
+                 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 MemoryCategory::Index,
+                 m_spriteIndexBuffer,
+                 m_spriteIndexBufferMemory);
+    copyBuffer(stagingBuffer, m_spriteIndexBuffer, indexBufferSize);
+
+    // still read by the copy, destroyed once it's done
+    m_deletionQueue.releaseBuffer(getReleaseFrame(), stagingBuffer, stagingBufferMemory);
+
+    // the vertices are allocated every frame, see updateSpriteBuffer()
+
+    PRINTLN("Created Sprite Resources");
+
+    return true;
+}
+
+bool VulkanManager::createSpriteTextures()
+{
+    // the loaded texture is the default one (see SPRITE_TEXTURE_DEFAULT)
+    return addSpriteTexture(m_textureImageView, m_textureSampler) == SPRITE_TEXTURE_DEFAULT;
+}
+
+SpriteTexture VulkanManager::addSpriteTexture(VkImageView imageView, VkSampler sampler)
+{
+    if (m_spriteTextures.size() >= MAX_SPRITE_TEXTURES)
+        throw std::runtime_error("too many sprite textures!");
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
+    descriptorSetAllocateInfo.sType                 = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocateInfo.descriptorPool        = m_spriteDescriptorPool;
+    descriptorSetAllocateInfo.descriptorSetCount    = 1;
+    descriptorSetAllocateInfo.pSetLayouts           = &m_spriteSetLayout;
+
+    VkDescriptorSet descriptorSet;
+    if (vkAllocateDescriptorSets(m_device, &descriptorSetAllocateInfo, &descriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate sprite descriptor set!");
+
+    VkDescriptorImageInfo descriptorImageInfo{};
+    descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    descriptorImageInfo.imageView   = imageView;
+    descriptorImageInfo.sampler     = sampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet          = descriptorSet;
+    descriptorWrite.dstBinding      = 0;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.pImageInfo      = &descriptorImageInfo;
+    vkUpdateDescriptorSets(m_device, 1, &descriptorWrite, 0, nullptr);
+
+    m_spriteTextures.push_back(descriptorSet);
+    return static_cast<SpriteTexture>(m_spriteTextures.size() - 1);
+}
+
+void VulkanManager::updateSpriteBuffer()
+{
+    // sorted, the dropped ones are the last textures and the farthest sprites
+    if (m_spriteBatch.getSpriteCount() > MAX_SPRITES_PER_FRAME)
+        PRINTLN_VERBOSE("Sprites) " << m_spriteBatch.getSpriteCount() - MAX_SPRITES_PER_FRAME << " sprites dropped");
+
+    const uint32_t spriteCount = std::min<uint32_t>(m_spriteBatch.getSpriteCount(), MAX_SPRITES_PER_FRAME);
+    SpriteVertex* vertices = m_transientBuffer.allocate<SpriteVertex>(spriteCount * 4, TransientUsage::Vertex, m_spriteVertexOffset);
+    if (!vertices)
+    {
+        // the frames in flight use the whole ring, the batch is still cleared
+        PRINTLN_VERBOSE("Sprites) transient buffer full, " << spriteCount << " sprites dropped");
+        m_spriteBatch.flush(nullptr, 0, m_spriteDraws);
+        return;
+    }
+
+    m_spriteBatch.flush(vertices, spriteCount, m_spriteDraws);
+}
+
+void VulkanManager::recordSpriteDraws(VkCommandBuffer commandBuffer)
+{
+    if (m_spriteDraws.empty())
+        return;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_spritePipeline);
+
+    const float pixelToClipScale[2] = { 2.0f / m_swapchainExtent.width, 2.0f / m_swapchainExtent.height };
+    vkCmdPushConstants(commandBuffer, m_spritePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pixelToClipScale), pixelToClipScale);
+
+    const VkBuffer vertexBuffer = m_transientBuffer.getBuffer();
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &m_spriteVertexOffset);
+    vkCmdBindIndexBuffer(commandBuffer, m_spriteIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // one draw per texture, the batch is sorted by texture
+    for (const SpriteDraw& draw : m_spriteDraws)
+    {
+        if (draw.texture >= m_spriteTextures.size())
+            continue;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_spritePipelineLayout,
+                                0, 1, &m_spriteTextures[draw.texture], 0, nullptr);
+        vkCmdDrawIndexed(commandBuffer, draw.spriteCount * 6, 1, draw.firstSprite * 6, 0, 0);
+    }
+}
+
+
+// ------------------------<<  Frame Capture  >>-------------------------
+//
+//  A captured frame copies its swapchain image into a host-visible
+//  readback buffer, right before presenting it. There is one readback per
+//  frame in flight, used by the frames of that slot: the copy is never
+//  waited for, it is picked up by a later frame once its frame is complete
+//  (see processCaptures), and written to a file by a job. A capture that
+//  can't get its readback yet (still being written) is simply deferred to
+//  the next frame.
+//
+// ----------------------------------------------------------------------
+
+bool VulkanManager::captureFrame(const std::string& path)
+{
+    // 8-bit RGBA/BGRA only, that's what the file is
+    const bool isSupportedFormat = m_swapchainImageFormat == VK_FORMAT_B8G8R8A8_SRGB || m_swapchainImageFormat == VK_FORMAT_B8G8R8A8_UNORM
+                                || m_swapchainImageFormat == VK_FORMAT_R8G8B8A8_SRGB || m_swapchainImageFormat == VK_FORMAT_R8G8B8A8_UNORM;
+    if (!m_isCaptureSupported || !isSupportedFormat)
+    {
+        PRINTLN("Frame capture is not supported by the swapchain");
+        return false;
+    }
+
+    m_captureRequests.push_back(path);
+    return true;
+}
+
+uint32_t VulkanManager::getPendingCaptureCount() const
+{
+    uint32_t count = static_cast<uint32_t>(m_captureRequests.size());
+    for (const auto& readback : m_captureReadbacks)
+    {
+        if (readback->frameNumber != 0 || !readback->writeCounter.isDone())
+            count++;
+    }
+    return count;
+}
+
+void VulkanManager::waitForCaptures()
+{
+    // the requests need frames to be copied
+    while (!m_captureRequests.empty())
+        drawFrame();
+
+    // the copies, then the files
+    waitForFrame(m_frameCounter);
+    processCaptures();
+    for (auto& readback : m_captureReadbacks)
+        m_jobSystem.wait(readback->writeCounter);
+}
+
+bool VulkanManager::beginCapture(uint32_t frameIndex)
+{
+    if (m_captureReadbacks.empty())
+    {
+        for (uint32_t i = 0; i < m_maxFramesInFlight; i++)
+            m_captureReadbacks.push_back(std::make_unique<CaptureReadback>());
+    }
+
+    // the slot's previous copy was completed by the frame wait, and handed
+    // to a job by processCaptures(). It may still be writing the file.
+    CaptureReadback& readback = *m_captureReadbacks[frameIndex];
+    if (readback.frameNumber != 0 || !readback.writeCounter.isDone())
+        return false;
+
+    // tightly packed pixels, 4 bytes each
+    const VkDeviceSize size = VkDeviceSize(m_swapchainExtent.width) * m_swapchainExtent.height * 4;
+    if (readback.size < size)
+    {
+        if (readback.buffer != VK_NULL_HANDLE)
+        {
+            m_deletionQueue.releaseBuffer(getReleaseFrame(), readback.buffer, readback.memory);
+            readback.buffer = VK_NULL_HANDLE;
+            readback.memory = VK_NULL_HANDLE;
+            readback.mapped = nullptr;
+            readback.size   = 0;
+        }
+
+        // cached: the CPU reads it back, when the device has such memory
+        VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        if (queryMemoryType(~0u, memoryProperties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+            memoryProperties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties,
+                     MemoryCategory::Readback, readback.buffer, readback.memory);
+
+        void* data;
+        if (vkMapMemory(m_device, readback.memory, 0, size, 0, &data) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map capture readback buffer!");
+            return false;
+        }
+        readback.mapped = static_cast<uint8_t*>(data);
+        readback.size   = size;
+    }
+
+    readback.width  = m_swapchainExtent.width;
+    readback.height = m_swapchainExtent.height;
+    readback.isBgra = m_swapchainImageFormat == VK_FORMAT_B8G8R8A8_SRGB || m_swapchainImageFormat == VK_FORMAT_B8G8R8A8_UNORM;
+    readback.path   = std::move(m_captureRequests.front());
+    m_captureRequests.pop_front();
+
+    m_recordingCapture = &readback;     // the frame number is set once submitted
+    return true;
+}
+
+void VulkanManager::processCaptures()
+{
+    for (auto& readbackPtr : m_captureReadbacks)
+    {
+        CaptureReadback* readback = readbackPtr.get();
+        if (readback->frameNumber == 0 || !isFrameComplete(readback->frameNumber))
+            continue;
+
+        // the readback is left alone until the job is done (see beginCapture)
+        readback->frameNumber = 0;
+        m_jobSystem.schedule([readback]() { writeCapture(*readback); }, &readback->writeCounter);
+    }
+}
+
+void VulkanManager::recordCapturePass(VkCommandBuffer commandBuffer)
+{
+    // the graph left the swapchain image in TRANSFER_SRC_OPTIMAL
+    const CaptureReadback& readback = *m_recordingCapture;
+
+    VkBufferImageCopy region{};
+    region.bufferOffset                     = 0;
+    region.bufferRowLength                  = 0;    // tightly packed
+    region.bufferImageHeight                = 0;
+    region.imageSubresource.aspectMask      = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel        = 0;
+    region.imageSubresource.baseArrayLayer  = 0;
+    region.imageSubresource.layerCount      = 1;
+    region.imageOffset                      = {0, 0, 0};
+    region.imageExtent                      = {readback.width, readback.height, 1};
+    vkCmdCopyImageToBuffer(commandBuffer, m_swapchainImages[m_recordingImageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           readback.buffer, 1, &region);
+
+    // made available to the host reads, once the frame is complete
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask         = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask         = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer                = readback.buffer;
+    bufferBarrier.offset                = 0;
+    bufferBarrier.size                  = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+void VulkanManager::writeCapture(CaptureReadback& readback)
+{
+    PROFILE_FUNCTION();
+
+    ImageWriteDesc image{};
+    image.width     = readback.width;
+    image.height    = readback.height;
+    image.rowPitch  = readback.width * 4;
+    image.isBgra    = readback.isBgra;
+    image.pixels    = readback.mapped;
+
+    if (!writePng(readback.path.c_str(), image))
+    {
+        PRINTLN("failed to write frame capture " << readback.path);
+        return;
+    }
+    PRINTLN_VERBOSE("Captured frame to " << readback.path);
+}
+
 
 // --------------------------<<  Exit  >>----------------------------
 //
@@ -2509,51 +4289,99 @@ void VulkanManager::updateUniformBuffer(uint32_t currentImangeIdx)
 void VulkanManager::cleanSwapChain()
 {
     for (auto framebuffer : m_swapchainFrameBuffers)
-        vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+        vkDestroyFramebuffer(m_device, framebuffer, HostAllocator::getCallbacks());
     vkFreeCommandBuffers(m_device, m_commandPool,   // free and reuse command buffers instead of creating a new one
                          static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-    vkDestroyPipeline(m_device, m_graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
-    vkDestroyRenderPass(m_device, m_renderPass, nullptr);
     for (auto imageView : m_swapchainImageViews)
-        vkDestroyImageView(m_device, imageView, nullptr);
-    vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+        vkDestroyImageView(m_device, imageView, HostAllocator::getCallbacks());
+    vkDestroySwapchainKHR(m_device, m_swapchain, HostAllocator::getCallbacks());
     for (size_t i = 0; i < m_swapchainImages.size(); ++i) {
-        vkDestroyBuffer(m_device, m_uniformBuffers[i], nullptr);
-        vkFreeMemory(m_device, m_uniformBuffersMemory[i], nullptr);
+        vkDestroyBuffer(m_device, m_uniformBuffers[i], HostAllocator::getCallbacks());
+        m_memoryTracker.free(m_device, m_uniformBuffersMemory[i]);
+    }
+    for (size_t i = 0; i < m_instanceBuffers.size(); ++i) {
+        vkDestroyBuffer(m_device, m_instanceBuffers[i], HostAllocator::getCallbacks());
+        m_memoryTracker.free(m_device, m_instanceBuffersMemory[i]);    // unmapped along
     }
-    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, HostAllocator::getCallbacks());
+    vkDestroyImageView(m_device, m_depthImageView, HostAllocator::getCallbacks());
+    vkDestroyImage(m_device, m_depthImage, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_depthImageMemory);
+    vkDestroyImageView(m_device, m_colorImageView, HostAllocator::getCallbacks());
+    vkDestroyImage(m_device, m_colorImage, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_colorImageMemory);
 }
 
 void VulkanManager::cleanVulkan()
 {
     // wait for any remaining asyncronous operations before cleanup
     vkDeviceWaitIdle(m_device);
+    m_deletionQueue.flushAll();
 
     cleanSwapChain();
 
-    vkDestroySampler(m_device, m_textureSampler, nullptr);
-    vkDestroyImageView(m_device, m_textureImageView, nullptr);
-    vkDestroyImage(m_device, m_textureImage, nullptr);
-    vkFreeMemory(m_device, m_textureImageMemory, nullptr);
-    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
-    vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
-    vkFreeMemory(m_device, m_vertexBufferMemory, nullptr);
-    vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
-    vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
+    // the files being written still read the readbacks
+    for (auto& readback : m_captureReadbacks)
+    {
+        m_jobSystem.wait(readback->writeCounter);
+        vkDestroyBuffer(m_device, readback->buffer, HostAllocator::getCallbacks());
+        m_memoryTracker.free(m_device, readback->memory);   // unmapped along
+    }
+    m_captureReadbacks.clear();
+
+    // finish the pending pipeline builds and save the pipeline cache
+    m_pipelineCompiler.clean();
+    if (m_pendingGraphicsPipeline.valid())
+    {
+        try { vkDestroyPipeline(m_device, m_pendingGraphicsPipeline.get(), HostAllocator::getCallbacks()); }
+        catch (const std::exception&) {}
+    }
+    if (m_pendingSpritePipeline.valid())
+    {
+        try { vkDestroyPipeline(m_device, m_pendingSpritePipeline.get(), HostAllocator::getCallbacks()); }
+        catch (const std::exception&) {}
+    }
+    vkDestroyPipeline(m_device, m_graphicsPipeline, HostAllocator::getCallbacks());
+    vkDestroyPipeline(m_device, m_spritePipeline, HostAllocator::getCallbacks());
+    vkDestroyRenderPass(m_device, m_renderPass, HostAllocator::getCallbacks());
+
+    vkDestroyBuffer(m_device, m_spriteIndexBuffer, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_spriteIndexBufferMemory);
+    vkDestroyBuffer(m_device, m_transientVkBuffer, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_transientBufferMemory);        // unmapped along
+    vkDestroyDescriptorPool(m_device, m_spriteDescriptorPool, HostAllocator::getCallbacks());
+    vkDestroyPipelineLayout(m_device, m_spritePipelineLayout, HostAllocator::getCallbacks());
+    vkDestroyDescriptorSetLayout(m_device, m_spriteSetLayout, HostAllocator::getCallbacks());
+
+    vkDestroyPipeline(m_device, m_imageProcessingPipeline, HostAllocator::getCallbacks());
+    vkDestroyPipelineLayout(m_device, m_imageProcessingPipelineLayout, HostAllocator::getCallbacks());
+    vkDestroyDescriptorSetLayout(m_device, m_imageProcessingSetLayout, HostAllocator::getCallbacks());
+    vkDestroySampler(m_device, m_imageProcessingSampler, HostAllocator::getCallbacks());
+
+    vkDestroySampler(m_device, m_textureSampler, HostAllocator::getCallbacks());
+    vkDestroyImageView(m_device, m_textureImageView, HostAllocator::getCallbacks());
+    vkDestroyImage(m_device, m_textureImage, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_textureImageMemory);
+    vkDestroyPipelineLayout(m_device, m_pipelineLayout, HostAllocator::getCallbacks());
+    vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, HostAllocator::getCallbacks());
+    vkDestroyBuffer(m_device, m_vertexBuffer, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_vertexBufferMemory);
+    vkDestroyBuffer(m_device, m_indexBuffer, HostAllocator::getCallbacks());
+    m_memoryTracker.free(m_device, m_indexBufferMemory);
     // extensions must be destroyed before vulkan instance
     if (enableValidationLayers)
-        destroyDebugUtilsMessengerEXT(m_VkInstance, &m_debugMessenger, nullptr);
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        destroyDebugUtilsMessengerEXT(m_VkInstance, &m_debugMessenger, HostAllocator::getCallbacks());
+    for (size_t i = 0; i < m_maxFramesInFlight; ++i)
     {
-        vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(m_device, m_inFlightFences[i], nullptr);
+        vkDestroySemaphore(m_device, m_renderFinishedSemaphores[i], HostAllocator::getCallbacks());
+        vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], HostAllocator::getCallbacks());
     }
-    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
-    vkDestroyDevice(m_device, nullptr);
-    vkDestroySurfaceKHR(m_VkInstance, m_windowSurface, nullptr);
-    vkDestroyInstance(m_VkInstance, nullptr);
+    vkDestroySemaphore(m_device, m_frameTimeline, HostAllocator::getCallbacks());
+    m_gpuStats.clean();
+    vkDestroyCommandPool(m_device, m_commandPool, HostAllocator::getCallbacks());
+    vkDestroyDevice(m_device, HostAllocator::getCallbacks());
+    vkDestroySurfaceKHR(m_VkInstance, m_windowSurface, HostAllocator::getCallbacks());
+    vkDestroyInstance(m_VkInstance, HostAllocator::getCallbacks());
 
     PRINTLN("Cleaned up Vulkan");
 }
@@ -1,16 +1,90 @@
 #include <iostream>
 #include <stdexcept>
 #include <cstdlib>
+#include <string>
+#include <cerrno>
+#include <cstdint>
 
 #include "MyApp.h"
 
-int main()
+// false (printed) if text is not a whole unsigned 32-bit number, at least minValue
+static bool parseUnsigned(const std::string& arg, const char* text, uint32_t& outValue, uint32_t minValue = 0)
+{
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || *text == '-' || errno == ERANGE || value > UINT32_MAX || value < minValue)
+    {
+        std::cerr << "invalid value for " << arg << ": " << text << '\n';
+        return false;
+    }
+
+    outValue = static_cast<uint32_t>(value);
+    return true;
+}
+
+int main(int argc, char** argv)
 {
     MyApp app;
 
+    // --golden <reference.png> [--golden-output <output.png>]: compares a rendered frame against the reference
+    // --golden-update <reference.png>: writes the reference
+    // --golden-results <results.csv>: appends the result and the frame time of the golden run
+    // --scene <name>: quads (default), quads_no_msaa, sprites, processed_texture, resized_texture
+    // --frames <n>: exits after n frames, printing the CPU frame time
+    // --frames-in-flight <n>: frames the CPU may record ahead of the GPU (default 2)
+    // --msaa <n>: samples per pixel, 1 to disable (default 4)
+    // --check-allocations: fails if a frame allocates from the heap after the warm up
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if ((arg == "--golden" || arg == "--golden-update") && i + 1 < argc)
+            app.setGoldenImage(argv[++i], arg == "--golden-update");
+        else if (arg == "--golden-output" && i + 1 < argc)
+            app.setGoldenOutput(argv[++i]);
+        else if (arg == "--golden-results" && i + 1 < argc)
+            app.setGoldenResults(argv[++i]);
+        else if (arg == "--scene" && i + 1 < argc)
+        {
+            if (!app.setScene(argv[++i]))
+            {
+                std::cerr << "unknown scene: " << argv[i] << '\n';
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--frames" && i + 1 < argc)
+        {
+            uint32_t frameCount;
+            if (!parseUnsigned(arg, argv[++i], frameCount))
+                return EXIT_FAILURE;
+            app.setFrameLimit(frameCount);
+        }
+        else if (arg == "--frames-in-flight" && i + 1 < argc)
+        {
+            uint32_t framesInFlight;
+            if (!parseUnsigned(arg, argv[++i], framesInFlight, 1))
+                return EXIT_FAILURE;
+            app.setMaxFramesInFlight(framesInFlight);
+        }
+        else if (arg == "--msaa" && i + 1 < argc)
+        {
+            uint32_t sampleCount;
+            if (!parseUnsigned(arg, argv[++i], sampleCount, 1))
+                return EXIT_FAILURE;
+            app.setMsaaSamples(sampleCount);
+        }
+        else if (arg == "--check-allocations")
+            app.setAllocationCheck(true);
+        else
+        {
+            std::cerr << "unknown argument: " << arg << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
     try
     {
-        app.run();
+        return app.run();
     }
     catch(const std::exception& e)
     {
@@ -12,15 +12,16 @@
 
 // gloabl
 layout(set = 0, binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
 // input/output variables
-layout(location = 0) in vec2 inPosition;
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+// per instance: world matrix of the draw (see InstanceData), locations 3-6
+layout(location = 3) in mat4 inWorld;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
@@ -30,7 +31,7 @@ layout(location = 1) out vec2 fragTexCoord;
 void main()
 {
     // The last component is 1, so that it can be directly used as NDC
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    gl_Position = ubo.proj * ubo.view * inWorld * vec4(inPosition, 1.0);
 
     fragColor = inColor;
     fragTexCoord = inTexCoord;
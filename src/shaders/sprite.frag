@@ -0,0 +1,23 @@
+#version 450
+
+// ---------------------------------------------------------------------
+//  Sprite Fragment Shader
+//
+//  Input: texture coord. and color of the sprite
+//  Output: the texture tinted by the color. Transparent texels are
+//          discarded (alpha test), the sprites are not sorted back-to-front.
+// ---------------------------------------------------------------------
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D spriteTexture;
+
+void main()
+{
+    outColor = texture(spriteTexture, fragTexCoord) * fragColor;
+    if (outColor.a < 0.5)
+        discard;
+}
@@ -0,0 +1,28 @@
+#version 450
+
+// ---------------------------------------------------------------------
+//  Sprite Vertex Shader
+//
+//  Input: sprite vertices (see SpriteVertex), in pixels
+//  Output: clip coordinates, the depth is passed as is
+// ---------------------------------------------------------------------
+
+layout(push_constant) uniform SpriteConstants {
+    vec2 pixelToClipScale;      // 2 / window size
+} constants;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inColor;       // RGBA8, normalized
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main()
+{
+    // (0, 0) is the top-left corner, y goes down as in the Vulkan clip space
+    gl_Position = vec4(inPosition.xy * constants.pixelToClipScale - 1.0, inPosition.z, 1.0);
+
+    fragColor = inColor;
+    fragTexCoord = inTexCoord;
+}